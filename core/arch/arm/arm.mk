@@ -179,6 +179,15 @@ CFG_CORE_IRQ_IS_NATIVE_INTR ?= n
 # Addresses CVE-2017-5715 (aka Meltdown) known to affect Arm Cortex-A75
 CFG_CORE_UNMAP_CORE_AT_EL0 ?= y
 
+# When switching between user mode contexts, only invalidate the TLB
+# entries tagged with the ASID of the context being mapped, and only if
+# its translation tables have changed since it was last mapped. Without
+# this the entire TLB is invalidated on each switch.
+CFG_CORE_LAZY_USER_TLBI ?= n
+ifeq ($(CFG_CORE_LAZY_USER_TLBI)-$(CFG_WITH_LPAE),y-n)
+$(error CFG_CORE_LAZY_USER_TLBI depends on CFG_WITH_LPAE)
+endif
+
 # Initialize PMCR.DP to 1 to prohibit cycle counting in secure state, and
 # save/restore PMCR during world switch.
 CFG_SM_NO_CYCLE_COUNTING ?= y
@@ -112,6 +112,9 @@ struct core_mmu_config {
  * struct core_mmu_user_map - current user mapping register state
  * @user_map:	physical address of user map translation table
  * @asid:	ASID for the user map
+ * @tlbi:	TLB entries tagged with @asid may be stale and must be
+ *		invalidated when the map is set, only used with
+ *		CFG_CORE_LAZY_USER_TLBI
  *
  * Note that this struct should be treated as an opaque struct since
  * the content depends on descriptor table format.
@@ -119,6 +122,9 @@ struct core_mmu_config {
 struct core_mmu_user_map {
 	uint64_t user_map;
 	uint32_t asid;
+#if defined(CFG_CORE_LAZY_USER_TLBI)
+	bool tlbi;
+#endif
 };
 #else
 /*
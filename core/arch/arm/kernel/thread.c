@@ -231,12 +231,19 @@ static void __thread_alloc_and_run(uint32_t a0, uint32_t a1, uint32_t a2,
 
 	for (n = 0; n < CFG_NUM_THREADS; n++) {
 		if (threads[n].state == THREAD_STATE_FREE) {
-			threads[n].state = THREAD_STATE_ACTIVE;
 			found_thread = true;
 			break;
 		}
 	}
 
+	/* Refused calls are retried by normal world */
+	if (IS_ENABLED(CFG_NS_VIRTUALIZATION) &&
+	    !virt_thread_admit(found_thread ? (int)n : THREAD_ID_INVALID))
+		found_thread = false;
+
+	if (found_thread)
+		threads[n].state = THREAD_STATE_ACTIVE;
+
 	thread_unlock_global();
 
 	if (!found_thread)
@@ -464,8 +471,10 @@ void thread_state_free(void)
 	threads[ct].flags = 0;
 	l->curr_thread = THREAD_ID_INVALID;
 
-	if (IS_ENABLED(CFG_NS_VIRTUALIZATION))
+	if (IS_ENABLED(CFG_NS_VIRTUALIZATION)) {
+		virt_thread_release(ct);
 		virt_unset_guest();
+	}
 	thread_unlock_global();
 }
 
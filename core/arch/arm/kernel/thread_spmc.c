@@ -1185,7 +1185,8 @@ static int add_mem_share(struct ffa_mem_transaction_x *mem_trans,
 
 	if (mem_trans->global_handle)
 		cookie = mem_trans->global_handle;
-	share.mf = mobj_ffa_sel1_spmc_new(cookie, share.page_count);
+	share.mf = mobj_ffa_sel1_spmc_new(cookie, share.page_count,
+					  share.region_count);
 	if (!share.mf)
 		return FFA_NO_MEMORY;
 
@@ -2076,7 +2077,8 @@ uint32_t __weak __thread_std_smc_entry(uint32_t a0, uint32_t a1,
 
 static bool set_fmem(struct optee_msg_param *param, struct thread_param *tpm)
 {
-	uint64_t offs = tpm->u.memref.offs;
+	uint64_t offs = tpm->u.memref.offs +
+			thread_rpc_arena_offs(tpm->u.memref.mobj);
 
 	param->attr = tpm->attr - THREAD_PARAM_ATTR_MEMREF_IN +
 		      OPTEE_MSG_ATTR_TYPE_FMEM_INPUT;
@@ -2194,7 +2196,10 @@ uint32_t thread_rpc_cmd(uint32_t cmd, size_t num_params,
 
 	thread_rpc(&rpc_arg);
 
-	return get_rpc_arg_res(arg, num_params, params);
+	ret = get_rpc_arg_res(arg, num_params, params);
+	thread_rpc_arena_check_res(num_params, params, ret);
+
+	return ret;
 }
 
 static void thread_rpc_free(unsigned int bt, uint64_t cookie, struct mobj *mobj)
@@ -2269,7 +2274,7 @@ static struct mobj *thread_rpc_alloc(size_t size, size_t align, unsigned int bt)
 	return mobj;
 }
 
-struct mobj *thread_rpc_alloc_payload(size_t size)
+struct mobj *thread_rpc_alloc_appl_payload(size_t size)
 {
 	return thread_rpc_alloc(size, 8, OPTEE_RPC_SHM_TYPE_APPL);
 }
@@ -2286,7 +2291,7 @@ void thread_rpc_free_kernel_payload(struct mobj *mobj)
 				mobj_get_cookie(mobj), mobj);
 }
 
-void thread_rpc_free_payload(struct mobj *mobj)
+void thread_rpc_free_appl_payload(struct mobj *mobj)
 {
 	if (mobj)
 		thread_rpc_free(OPTEE_RPC_SHM_TYPE_APPL, mobj_get_cookie(mobj),
@@ -2660,6 +2665,7 @@ struct mobj_ffa *thread_spmc_populate_mobj_from_rx(uint64_t cookie)
 	struct ffa_mem_access *descr_array = NULL;
 	struct ffa_mem_region *descr = NULL;
 	struct mobj_ffa *mf = NULL;
+	unsigned int num_regions = 0;
 	unsigned int num_pages = 0;
 	unsigned int offs = 0;
 	void *buf = NULL;
@@ -2683,12 +2689,13 @@ struct mobj_ffa *thread_spmc_populate_mobj_from_rx(uint64_t cookie)
 	descr = (struct ffa_mem_region *)((vaddr_t)buf + offs);
 
 	num_pages = READ_ONCE(descr->total_page_count);
-	mf = mobj_ffa_spmc_new(cookie, num_pages);
+	num_regions = READ_ONCE(descr->address_range_count);
+	mf = mobj_ffa_spmc_new(cookie, num_pages, num_regions);
 	if (!mf)
 		goto out;
 
-	if (set_pages(descr->address_range_array,
-		      READ_ONCE(descr->address_range_count), num_pages, mf)) {
+	if (set_pages(descr->address_range_array, num_regions, num_pages,
+		      mf)) {
 		mobj_ffa_spmc_delete(mf);
 		goto out;
 	}
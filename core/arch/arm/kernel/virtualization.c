@@ -4,9 +4,11 @@
  * Copyright (c) 2023-2024, Linaro Limited
  */
 
+#include <assert.h>
 #include <bitstring.h>
 #include <compiler.h>
 #include <kernel/boot.h>
+#include <kernel/delay.h>
 #include <kernel/linker.h>
 #include <kernel/misc.h>
 #include <kernel/mutex.h>
@@ -14,6 +16,7 @@
 #include <kernel/panic.h>
 #include <kernel/refcount.h>
 #include <kernel/spinlock.h>
+#include <kernel/thread.h>
 #include <kernel/thread_spmc.h>
 #include <kernel/virtualization.h>
 #include <mm/core_memprot.h>
@@ -36,6 +39,31 @@ static struct prtn_list_head prtn_list __nex_data =
 static struct prtn_list_head prtn_destroy_list __nex_data =
 	LIST_HEAD_INITIALIZER(prtn_destroy_list);
 
+/*
+ * The partitions in prtn_list are also in prtn_hash[], indexed by guest
+ * ID modulo PRTN_HASH_SIZE. Protected by prtn_list_lock.
+ */
+#define PRTN_HASH_SIZE		CFG_VIRT_GUEST_COUNT
+static struct prtn_list_head prtn_hash[PRTN_HASH_SIZE] __nex_bss;
+
+#ifdef CFG_CORE_SEL1_SPMC
+/*
+ * Cookies recorded in the partitions in prtn_list are also in cookie_hash[],
+ * an open addressing hash table with linear probing, a free slot has a
+ * NULL prtn. It has room for twice the cookies CFG_VIRT_GUEST_COUNT
+ * guests can have. Protected by prtn_list_lock.
+ */
+#define COOKIE_HASH_SIZE	(2 * CFG_VIRT_GUEST_COUNT * \
+				 SPMC_CORE_SEL1_MAX_SHM_COUNT)
+
+struct cookie_entry {
+	uint64_t cookie;
+	struct guest_partition *prtn;
+};
+
+static struct cookie_entry cookie_hash[COOKIE_HASH_SIZE] __nex_bss;
+#endif
+
 /* Memory used by OP-TEE core */
 struct memory_map *kmem_map __nex_bss;
 
@@ -44,12 +72,18 @@ struct guest_spec_data {
 	void (*destroy)(void *data);
 };
 
+/* Protects thread_stats of all partitions and thread_start[] */
+static unsigned int thread_stats_lock __nex_data = SPINLOCK_UNLOCK;
+/* Time the threads were admitted, in counter ticks */
+static uint64_t thread_start[CFG_NUM_THREADS] __nex_bss;
+
 static bool add_disabled __nex_bss;
 static unsigned gsd_count __nex_bss;
 static struct guest_spec_data *gsd_array __nex_bss;
 
 struct guest_partition {
 	LIST_ENTRY(guest_partition) link;
+	LIST_ENTRY(guest_partition) hash_link;
 	struct mmu_partition *mmu_prtn;
 	struct memory_map mem_map;
 	struct mutex mutex;
@@ -62,6 +96,7 @@ struct guest_partition {
 	bool shutting_down;
 	uint16_t id;
 	struct refcount refc;
+	struct virt_thread_stats thread_stats;
 #ifdef CFG_CORE_SEL1_SPMC
 	uint64_t cookies[SPMC_CORE_SEL1_MAX_SHM_COUNT];
 	uint8_t cookie_count;
@@ -317,6 +352,7 @@ TEE_Result virt_guest_created(uint16_t guest_id)
 		goto err_free_prtn;
 
 	prtn->id = guest_id;
+	prtn->thread_stats.max_threads = virt_guest_max_threads(guest_id);
 	mutex_init(&prtn->mutex);
 	refcount_set(&prtn->refc, 1);
 	res = configure_guest_prtn_mem(prtn);
@@ -340,6 +376,8 @@ TEE_Result virt_guest_created(uint16_t guest_id)
 
 	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
 	LIST_INSERT_HEAD(&prtn_list, prtn, link);
+	LIST_INSERT_HEAD(&prtn_hash[guest_id % PRTN_HASH_SIZE], prtn,
+			 hash_link);
 	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	IMSG("Added guest %d", guest_id);
@@ -356,6 +394,93 @@ err_free_prtn:
 	return res;
 }
 
+#ifdef CFG_CORE_SEL1_SPMC
+static size_t cookie_hash_slot(uint64_t cookie)
+{
+	uint64_t h = (cookie ^ (cookie >> 32)) * 0x9e3779b97f4a7c15ULL;
+
+	return (h >> 32) % COOKIE_HASH_SIZE;
+}
+
+/* Returns the slot of @cookie or -1 if it isn't in cookie_hash[] */
+static int cookie_hash_find(uint64_t cookie)
+{
+	size_t n = cookie_hash_slot(cookie);
+	size_t i = 0;
+
+	for (i = 0; i < COOKIE_HASH_SIZE; i++) {
+		if (!cookie_hash[n].prtn)
+			return -1;
+		if (cookie_hash[n].cookie == cookie)
+			return n;
+		n = (n + 1) % COOKIE_HASH_SIZE;
+	}
+
+	return -1;
+}
+
+static bool cookie_hash_add(uint64_t cookie, struct guest_partition *prtn)
+{
+	size_t n = cookie_hash_slot(cookie);
+	size_t i = 0;
+
+	for (i = 0; i < COOKIE_HASH_SIZE; i++) {
+		if (!cookie_hash[n].prtn) {
+			cookie_hash[n].cookie = cookie;
+			cookie_hash[n].prtn = prtn;
+			return true;
+		}
+		n = (n + 1) % COOKIE_HASH_SIZE;
+	}
+
+	return false;
+}
+
+/*
+ * Frees slot @n and moves back the entries after it that would otherwise
+ * no longer be found from their home slot.
+ */
+static void cookie_hash_del(size_t n)
+{
+	size_t next = n;
+	size_t home = 0;
+	size_t i = 0;
+
+	for (i = 1; i < COOKIE_HASH_SIZE; i++) {
+		next = (next + 1) % COOKIE_HASH_SIZE;
+		if (!cookie_hash[next].prtn)
+			break;
+		home = cookie_hash_slot(cookie_hash[next].cookie);
+		/* Move the entry unless its home slot is in (n, next] */
+		if ((next > n && (home <= n || home > next)) ||
+		    (next < n && home <= n && home > next)) {
+			cookie_hash[n] = cookie_hash[next];
+			n = next;
+		}
+	}
+
+	cookie_hash[n].cookie = 0;
+	cookie_hash[n].prtn = NULL;
+}
+
+/* Called with prtn_list_lock held when @prtn leaves prtn_list */
+static void remove_prtn_cookies(struct guest_partition *prtn)
+{
+	int i = 0;
+	int n = 0;
+
+	for (i = 0; i < prtn->cookie_count; i++) {
+		n = cookie_hash_find(prtn->cookies[i]);
+		if (n >= 0)
+			cookie_hash_del(n);
+	}
+}
+#else
+static void remove_prtn_cookies(struct guest_partition *prtn __unused)
+{
+}
+#endif
+
 static bool
 prtn_have_remaining_resources(struct guest_partition *prtn __maybe_unused)
 {
@@ -388,7 +513,7 @@ static struct guest_partition *find_guest_by_id_unlocked(uint16_t guest_id)
 {
 	struct guest_partition *prtn = NULL;
 
-	LIST_FOREACH(prtn, &prtn_list, link)
+	LIST_FOREACH(prtn, &prtn_hash[guest_id % PRTN_HASH_SIZE], hash_link)
 		if (!prtn->shutting_down && prtn->id == guest_id)
 			return prtn;
 
@@ -450,6 +575,8 @@ void virt_put_guest(struct guest_partition *prtn)
 
 		exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
 		LIST_REMOVE(prtn, link);
+		LIST_REMOVE(prtn, hash_link);
+		remove_prtn_cookies(prtn);
 		if (prtn_have_remaining_resources(prtn)) {
 			LIST_INSERT_HEAD(&prtn_destroy_list, prtn, link);
 			/*
@@ -558,6 +685,103 @@ void virt_on_stdcall(void)
 	}
 }
 
+unsigned int __weak virt_guest_max_threads(uint16_t guest_id __unused)
+{
+	if (CFG_VIRT_GUEST_MAX_THREADS)
+		return MIN(CFG_VIRT_GUEST_MAX_THREADS, CFG_NUM_THREADS);
+	return CFG_NUM_THREADS;
+}
+
+static uint64_t thread_stats_time(void)
+{
+#ifdef CFG_CORE_HAS_GENERIC_TIMER
+	return delay_cnt_read();
+#else
+	return 0;
+#endif
+}
+
+static uint64_t thread_stats_time_to_us(uint64_t t)
+{
+#ifdef CFG_CORE_HAS_GENERIC_TIMER
+	if (delay_cnt_freq())
+		return t * 1000000 / delay_cnt_freq();
+#endif
+	return t;
+}
+
+bool virt_thread_admit(short int thread_id)
+{
+	struct guest_partition *prtn = get_current_prtn();
+	struct virt_thread_stats *st = NULL;
+	uint32_t exceptions = 0;
+	bool admitted = false;
+
+	if (!prtn)
+		return thread_id != THREAD_ID_INVALID;
+
+	st = &prtn->thread_stats;
+	exceptions = cpu_spin_lock_xsave(&thread_stats_lock);
+	if (st->active >= st->max_threads) {
+		st->over_quota++;
+	} else if (thread_id == THREAD_ID_INVALID) {
+		st->no_thread++;
+	} else {
+		st->active++;
+		st->peak = MAX(st->peak, st->active);
+		st->admitted++;
+		thread_start[thread_id] = thread_stats_time();
+		admitted = true;
+	}
+	cpu_spin_unlock_xrestore(&thread_stats_lock, exceptions);
+
+	return admitted;
+}
+
+void virt_thread_release(short int thread_id)
+{
+	struct guest_partition *prtn = get_current_prtn();
+	struct virt_thread_stats *st = NULL;
+	uint32_t exceptions = 0;
+	uint64_t t = 0;
+
+	if (!prtn)
+		return;
+
+	st = &prtn->thread_stats;
+	exceptions = cpu_spin_lock_xsave(&thread_stats_lock);
+	assert(st->active);
+	st->active--;
+	t = thread_stats_time_to_us(thread_stats_time() -
+				    thread_start[thread_id]);
+	st->busy_us += t;
+	st->max_busy_us = MAX(st->max_busy_us, t);
+	cpu_spin_unlock_xrestore(&thread_stats_lock, exceptions);
+}
+
+TEE_Result virt_get_thread_stats(struct virt_thread_stats *stats)
+{
+	struct guest_partition *prtn = get_current_prtn();
+	struct virt_thread_stats *st = NULL;
+	uint32_t exceptions = 0;
+
+	if (!prtn)
+		return TEE_ERROR_BAD_STATE;
+
+	st = &prtn->thread_stats;
+	exceptions = cpu_spin_lock_xsave(&thread_stats_lock);
+	*stats = *st;
+	st->peak = st->active;
+	st->admitted = 0;
+	st->over_quota = 0;
+	st->no_thread = 0;
+	st->busy_us = 0;
+	st->max_busy_us = 0;
+	cpu_spin_unlock_xrestore(&thread_stats_lock, exceptions);
+
+	return TEE_SUCCESS;
+}
+
 struct memory_map *virt_get_memory_map(void)
 {
 	struct guest_partition *prtn;
@@ -584,18 +808,18 @@ static int find_cookie(struct guest_partition *prtn, uint64_t cookie)
 static struct guest_partition *find_prtn_cookie(uint64_t cookie, int *idx)
 {
 	struct guest_partition *prtn = NULL;
-	int i = 0;
+	int n = cookie_hash_find(cookie);
 
-	LIST_FOREACH(prtn, &prtn_list, link) {
-		i = find_cookie(prtn, cookie);
-		if (i >= 0) {
-			if (idx)
-				*idx = i;
-			return prtn;
-		}
+	if (n < 0)
+		return NULL;
+
+	prtn = cookie_hash[n].prtn;
+	if (idx) {
+		*idx = find_cookie(prtn, cookie);
+		assert(*idx >= 0);
 	}
 
-	return NULL;
+	return prtn;
 }
 
 TEE_Result virt_add_cookie_to_current_guest(uint64_t cookie)
@@ -609,7 +833,8 @@ TEE_Result virt_add_cookie_to_current_guest(uint64_t cookie)
 		goto out;
 
 	prtn = current_partition[get_core_pos()];
-	if (prtn->cookie_count < ARRAY_SIZE(prtn->cookies)) {
+	if (prtn->cookie_count < ARRAY_SIZE(prtn->cookies) &&
+	    cookie_hash_add(cookie, prtn)) {
 		prtn->cookies[prtn->cookie_count] = cookie;
 		prtn->cookie_count++;
 		res = TEE_SUCCESS;
@@ -629,6 +854,7 @@ void virt_remove_cookie(uint64_t cookie)
 	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
 	prtn = find_prtn_cookie(cookie, &i);
 	if (prtn) {
+		cookie_hash_del(cookie_hash_find(cookie));
 		memmove(prtn->cookies + i, prtn->cookies + i + 1,
 			sizeof(uint64_t) * (prtn->cookie_count - i - 1));
 		prtn->cookie_count--;
@@ -1268,6 +1268,19 @@ void core_mmu_create_user_map(struct user_mode_ctx *uctx,
 	core_mmu_populate_user_map(&dir_info, uctx);
 	map->user_map = virt_to_phys(dir_info.table) | TABLE_DESC;
 	map->asid = uctx->vm_info.asid;
+#if defined(CFG_CORE_LAZY_USER_TLBI)
+	/*
+	 * The ASID is owned by this context for its entire lifetime so
+	 * TLB entries tagged with it can only be stale if the translation
+	 * tables have changed or if another translation table is used as
+	 * user map, for instance when the context is mapped by another
+	 * thread.
+	 */
+	map->tlbi = uctx->vm_info.tlbi_pending ||
+		    uctx->vm_info.last_user_map != map->user_map;
+	uctx->vm_info.tlbi_pending = false;
+	uctx->vm_info.last_user_map = map->user_map;
+#endif
 }
 
 bool core_mmu_find_table(struct mmu_partition *prtn, vaddr_t va,
@@ -1449,6 +1462,26 @@ bool core_mmu_user_mapping_is_active(void)
 	return ret;
 }
 
+static void sync_user_map_tlb(struct core_mmu_user_map *map __maybe_unused)
+{
+#if defined(CFG_CORE_LAZY_USER_TLBI)
+	/*
+	 * User mappings are non-global and tagged with the ASID of the
+	 * owning context, while core mappings are global. Entries cached
+	 * with the reserved ASID 0 while the user map was updated are
+	 * removed when the user map is cleared. Entries tagged with the
+	 * ASID of the new map only need to be invalidated if they may be
+	 * stale.
+	 */
+	if (!map || !map->user_map)
+		tlbi_asid(0);
+	else if (map->tlbi)
+		tlbi_asid(map->asid);
+#else
+	tlbi_all();
+#endif
+}
+
 #ifdef ARM32
 void core_mmu_get_user_map(struct core_mmu_user_map *map)
 {
@@ -1464,6 +1497,13 @@ void core_mmu_get_user_map(struct core_mmu_user_map *map)
 	} else {
 		map->asid = 0;
 	}
+#if defined(CFG_CORE_LAZY_USER_TLBI)
+	/*
+	 * The map may be restored on another core, don't depend on what
+	 * that core may have cached.
+	 */
+	map->tlbi = true;
+#endif
 }
 
 void core_mmu_set_user_map(struct core_mmu_user_map *map)
@@ -1499,7 +1539,7 @@ void core_mmu_set_user_map(struct core_mmu_user_map *map)
 		dsb();	/* Make sure the write above is visible */
 	}
 
-	tlbi_all();
+	sync_user_map_tlb(map);
 	icache_inv_all();
 
 	thread_unmask_exceptions(exceptions);
@@ -1555,6 +1595,13 @@ void core_mmu_get_user_map(struct core_mmu_user_map *map)
 	} else {
 		map->asid = 0;
 	}
+#if defined(CFG_CORE_LAZY_USER_TLBI)
+	/*
+	 * The map may be restored on another core, don't depend on what
+	 * that core may have cached.
+	 */
+	map->tlbi = true;
+#endif
 }
 
 void core_mmu_set_user_map(struct core_mmu_user_map *map)
@@ -1590,7 +1637,7 @@ void core_mmu_set_user_map(struct core_mmu_user_map *map)
 		dsb();	/* Make sure the write above is visible */
 	}
 
-	tlbi_all();
+	sync_user_map_tlb(map);
 	icache_inv_all();
 
 	thread_unmask_exceptions(exceptions);
@@ -74,6 +74,23 @@
  * mobj_ffa_unregister_by_cookie() which only succeeds if the mobj is in
  * the inactive list and inactive_refs is 1
  */
+
+/*
+ * struct mobj_ffa_range - Physically contiguous pages of a mobj_ffa
+ * @pa:		Physical address of the first page
+ * @page_idx:	Index of the first page in the mobj_ffa
+ * @page_count:	Number of pages
+ *
+ * Constituents of a share that follow each other in physical memory are
+ * merged into one range, a large contiguous buffer needs a single range
+ * however many pages it has.
+ */
+struct mobj_ffa_range {
+	paddr_t pa;
+	unsigned int page_idx;
+	unsigned int page_count;
+};
+
 struct mobj_ffa {
 	struct mobj mobj;
 	SLIST_ENTRY(mobj_ffa) link;
@@ -85,7 +102,9 @@ struct mobj_ffa {
 #ifdef CFG_CORE_SEL1_SPMC
 	bool registered_by_cookie;
 #endif
-	paddr_t pages[];
+	unsigned int range_count;
+	unsigned int max_ranges;
+	struct mobj_ffa_range ranges[];
 };
 
 SLIST_HEAD(mobj_ffa_head, mobj_ffa);
@@ -120,32 +139,36 @@ static struct mobj_ffa *to_mobj_ffa(struct mobj *mobj)
 	return container_of(mobj, struct mobj_ffa, mobj);
 }
 
-static size_t shm_size(size_t num_pages)
+static size_t shm_size(size_t num_ranges)
 {
 	size_t s = 0;
 
-	if (MUL_OVERFLOW(sizeof(paddr_t), num_pages, &s))
+	if (MUL_OVERFLOW(sizeof(struct mobj_ffa_range), num_ranges, &s))
 		return 0;
 	if (ADD_OVERFLOW(sizeof(struct mobj_ffa), s, &s))
 		return 0;
 	return s;
 }
 
-static struct mobj_ffa *ffa_new(unsigned int num_pages)
+static struct mobj_ffa *ffa_new(unsigned int num_pages,
+			       unsigned int num_ranges)
 {
 	struct mobj_ffa *mf = NULL;
 	size_t s = 0;
 
-	if (!num_pages)
+	if (!num_pages || !num_ranges)
 		return NULL;
 
-	s = shm_size(num_pages);
+	/* Each range has at least one page */
+	num_ranges = MIN(num_ranges, num_pages);
+	s = shm_size(num_ranges);
 	if (!s)
 		return NULL;
 	mf = calloc(1, s);
 	if (!mf)
 		return NULL;
 
+	mf->max_ranges = num_ranges;
 	mf->mobj.ops = &mobj_ffa_ops;
 	mf->mobj.size = num_pages * SMALL_PAGE_SIZE;
 	mf->mobj.phys_granule = SMALL_PAGE_SIZE;
@@ -157,7 +180,8 @@ static struct mobj_ffa *ffa_new(unsigned int num_pages)
 
 #ifdef CFG_CORE_SEL1_SPMC
 struct mobj_ffa *mobj_ffa_sel1_spmc_new(uint64_t cookie,
-					unsigned int num_pages)
+					unsigned int num_pages,
+					unsigned int num_ranges)
 {
 	struct mobj_ffa *mf = NULL;
 	bitstr_t *shm_bits = NULL;
@@ -171,7 +195,7 @@ struct mobj_ffa *mobj_ffa_sel1_spmc_new(uint64_t cookie,
 			return NULL;
 	}
 
-	mf = ffa_new(num_pages);
+	mf = ffa_new(num_pages, num_ranges);
 	if (!mf) {
 		if (cookie != OPTEE_MSG_FMEM_INVALID_GLOBAL_ID)
 			virt_remove_cookie(cookie);
@@ -292,12 +316,13 @@ void mobj_ffa_sel1_spmc_delete(struct mobj_ffa *mf)
 	free(mf);
 }
 #else /* !defined(CFG_CORE_SEL1_SPMC) */
-struct mobj_ffa *mobj_ffa_spmc_new(uint64_t cookie, unsigned int num_pages)
+struct mobj_ffa *mobj_ffa_spmc_new(uint64_t cookie, unsigned int num_pages,
+				   unsigned int num_ranges)
 {
 	struct mobj_ffa *mf = NULL;
 
 	assert(cookie != OPTEE_MSG_FMEM_INVALID_GLOBAL_ID);
-	mf = ffa_new(num_pages);
+	mf = ffa_new(num_pages, num_ranges);
 	if (mf)
 		mf->cookie = cookie;
 	return mf;
@@ -312,6 +337,7 @@ void mobj_ffa_spmc_delete(struct mobj_ffa *mf)
 TEE_Result mobj_ffa_add_pages_at(struct mobj_ffa *mf, unsigned int *idx,
 				 paddr_t pa, unsigned int num_pages)
 {
+	struct mobj_ffa_range *r = NULL;
 	unsigned int n = 0;
 	size_t tot_page_count = get_page_count(mf);
 
@@ -322,10 +348,36 @@ TEE_Result mobj_ffa_add_pages_at(struct mobj_ffa *mf, unsigned int *idx,
 	    !core_pbuf_is(CORE_MEM_NON_SEC, pa, num_pages * SMALL_PAGE_SIZE))
 		return TEE_ERROR_BAD_PARAMETERS;
 
-	for (n = 0; n < num_pages; n++)
-		mf->pages[n + *idx] = pa + n * SMALL_PAGE_SIZE;
+	if (pa & SMALL_PAGE_MASK)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!num_pages)
+		return TEE_SUCCESS;
+
+	/* Pages are added in order */
+	if (mf->range_count) {
+		r = mf->ranges + mf->range_count - 1;
+		if (*idx != r->page_idx + r->page_count)
+			return TEE_ERROR_BAD_PARAMETERS;
+		if (r->pa + (paddr_t)r->page_count * SMALL_PAGE_SIZE == pa) {
+			r->page_count += num_pages;
+			*idx = n;
+			return TEE_SUCCESS;
+		}
+	} else if (*idx) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	if (mf->range_count == mf->max_ranges)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	r = mf->ranges + mf->range_count;
+	r->pa = pa;
+	r->page_idx = *idx;
+	r->page_count = num_pages;
+	mf->range_count++;
 
-	(*idx) += n;
+	*idx = n;
 	return TEE_SUCCESS;
 }
 
@@ -558,6 +610,30 @@ struct mobj *mobj_ffa_get_by_cookie(uint64_t cookie,
 	return &mf->mobj;
 }
 
+/* Returns the physical address of page @page_idx */
+static paddr_t get_page_pa(struct mobj_ffa *mf, unsigned int page_idx)
+{
+	const struct mobj_ffa_range *r = NULL;
+	unsigned int lo = 0;
+	unsigned int hi = mf->range_count;
+	unsigned int mid = 0;
+
+	/* Find the last range starting at or before @page_idx */
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		if (mf->ranges[mid].page_idx <= page_idx)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	r = mf->ranges + lo;
+	assert(page_idx >= r->page_idx &&
+	       page_idx - r->page_idx < r->page_count);
+
+	return r->pa + (paddr_t)(page_idx - r->page_idx) * SMALL_PAGE_SIZE;
+}
+
 static TEE_Result ffa_get_pa(struct mobj *mobj, size_t offset,
 			     size_t granule, paddr_t *pa)
 {
@@ -574,11 +650,11 @@ static TEE_Result ffa_get_pa(struct mobj *mobj, size_t offset,
 	full_offset = offset + mf->page_offset;
 	switch (granule) {
 	case 0:
-		p = mf->pages[full_offset / SMALL_PAGE_SIZE] +
+		p = get_page_pa(mf, full_offset / SMALL_PAGE_SIZE) +
 		    (full_offset & SMALL_PAGE_MASK);
 		break;
 	case SMALL_PAGE_SIZE:
-		p = mf->pages[full_offset / SMALL_PAGE_SIZE];
+		p = get_page_pa(mf, full_offset / SMALL_PAGE_SIZE);
 		break;
 	default:
 		return TEE_ERROR_GENERIC;
@@ -666,6 +742,29 @@ static uint64_t ffa_get_cookie(struct mobj *mobj)
 	return to_mobj_ffa(mobj)->cookie;
 }
 
+/* Maps the ranges of @mf at @va, one call per range */
+static TEE_Result map_ranges(struct mobj_ffa *mf, vaddr_t va)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct mobj_ffa_range *r = NULL;
+	unsigned int n = 0;
+
+	for (n = 0; n < mf->range_count; n++) {
+		r = mf->ranges + n;
+		res = core_mmu_map_contiguous_pages(va + (vaddr_t)r->page_idx *
+							 SMALL_PAGE_SIZE,
+						    r->pa, r->page_count,
+						    MEM_AREA_NSEC_SHM);
+		if (res) {
+			if (r->page_idx)
+				core_mmu_unmap_pages(va, r->page_idx);
+			return res;
+		}
+	}
+
+	return TEE_SUCCESS;
+}
+
 static TEE_Result ffa_inc_map(struct mobj *mobj)
 {
 	TEE_Result res = TEE_SUCCESS;
@@ -700,9 +799,8 @@ static TEE_Result ffa_inc_map(struct mobj *mobj)
 			goto out;
 		}
 
-		res = core_mmu_map_pages(tee_mm_get_smem(mf->mm), mf->pages,
-					 sz / SMALL_PAGE_SIZE,
-					 MEM_AREA_NSEC_SHM);
+		assert(sz / SMALL_PAGE_SIZE == get_page_count(mf));
+		res = map_ranges(mf, tee_mm_get_smem(mf->mm));
 		if (res) {
 			tee_mm_free(mf->mm);
 			mf->mm = NULL;
@@ -38,6 +38,8 @@ static struct vm_paged_region_head core_vm_regions =
 #define INVALID_PGIDX		UINT_MAX
 #define PMEM_FLAG_DIRTY		BIT(0)
 #define PMEM_FLAG_HIDDEN	BIT(1)
+#define PMEM_FLAG_REFERENCED	BIT(2)
+#define PMEM_FLAG_READ_AHEAD	BIT(3)
 
 /*
  * struct tee_pager_pmem - Represents a physical page used for paging.
@@ -48,6 +50,8 @@ static struct vm_paged_region_head core_vm_regions =
  * @va_alias	Virtual address where the physical page always is aliased.
  *		Used during remapping of the page when the content need to
  *		be updated before it's available at the new location.
+ * @link	Link in tee_pager_pmem_head or tee_pager_lock_pmem_head
+ * @fobj_link	Link in the list of pmems of @fobj
  */
 struct tee_pager_pmem {
 	unsigned int flags;
@@ -55,6 +59,7 @@ struct tee_pager_pmem {
 	struct fobj *fobj;
 	void *va_alias;
 	TAILQ_ENTRY(tee_pager_pmem) link;
+	TAILQ_ENTRY(tee_pager_pmem) fobj_link;
 };
 
 struct tblidx {
@@ -63,8 +68,6 @@ struct tblidx {
 };
 
 /* The list of physical pages. The first page in the list is the oldest */
-TAILQ_HEAD(tee_pager_pmem_head, tee_pager_pmem);
-
 static struct tee_pager_pmem_head tee_pager_pmem_head =
 	TAILQ_HEAD_INITIALIZER(tee_pager_pmem_head);
 
@@ -82,6 +85,56 @@ static struct vm_paged_region *pager_iv_region;
 /* Used by make_iv_available(), see make_iv_available() for details. */
 static struct tee_pager_pmem *pager_spare_pmem;
 
+/*
+ * struct pager_policy - Page replacement policy
+ * @id:			TEE_PAGER_POLICY_* identifier reported in statistics
+ * @get_victim:		Return the pmem to reuse for a new page, not removed
+ *			from the list
+ * @page_referenced:	Called when a hidden or unmapped page is accessed
+ * @page_added:		Called when a page has been loaded
+ * @hide_pages:		Called after each handled fault
+ */
+struct pager_policy {
+	unsigned int id;
+	struct tee_pager_pmem *(*get_victim)(void);
+	void (*page_referenced)(struct tee_pager_pmem *pmem);
+	void (*page_added)(struct tee_pager_pmem *pmem);
+	void (*hide_pages)(void);
+};
+
+static struct tee_pager_pmem *fifo_get_victim(void);
+static void fifo_page_referenced(struct tee_pager_pmem *pmem);
+static void fifo_page_added(struct tee_pager_pmem *pmem);
+static void fifo_hide_pages(void);
+static struct tee_pager_pmem *clock_get_victim(void);
+static void clock_page_referenced(struct tee_pager_pmem *pmem);
+static void clock_hide_pages(void);
+
+static const struct pager_policy pager_policy_fifo = {
+	.id = TEE_PAGER_POLICY_FIFO,
+	.get_victim = fifo_get_victim,
+	.page_referenced = fifo_page_referenced,
+	.page_added = fifo_page_added,
+	.hide_pages = fifo_hide_pages,
+};
+
+static const struct pager_policy pager_policy_clock = {
+	.id = TEE_PAGER_POLICY_CLOCK,
+	.get_victim = clock_get_victim,
+	.page_referenced = clock_page_referenced,
+	.page_added = clock_page_referenced,
+	.hide_pages = clock_hide_pages,
+};
+
+static const struct pager_policy *const pager_policy =
+	IS_ENABLED(CFG_CORE_PAGER_POLICY_CLOCK) ? &pager_policy_clock :
+						  &pager_policy_fifo;
+
+static unsigned int __maybe_unused pager_policy_id(void)
+{
+	return pager_policy->id;
+}
+
 #ifdef CFG_WITH_STATS
 static struct tee_pager_stats pager_stats;
 
@@ -115,14 +168,51 @@ static inline void set_npages(void)
 	pager_stats.npages = tee_pager_npages;
 }
 
+static inline void incr_faults(void)
+{
+	pager_stats.faults++;
+}
+
+static inline void incr_evictions(void)
+{
+	pager_stats.evictions++;
+}
+
+static inline void incr_second_chances(void)
+{
+	pager_stats.second_chances++;
+}
+
+static inline void incr_hides(void)
+{
+	pager_stats.hides++;
+}
+
+static inline void incr_readahead(void)
+{
+	pager_stats.readahead++;
+}
+
+static inline void incr_readahead_unused(void)
+{
+	pager_stats.readahead_unused++;
+}
+
 void tee_pager_get_stats(struct tee_pager_stats *stats)
 {
+	pager_stats.policy = pager_policy_id();
 	*stats = pager_stats;
 
 	pager_stats.hidden_hits = 0;
 	pager_stats.ro_hits = 0;
 	pager_stats.rw_hits = 0;
 	pager_stats.zi_released = 0;
+	pager_stats.faults = 0;
+	pager_stats.evictions = 0;
+	pager_stats.second_chances = 0;
+	pager_stats.hides = 0;
+	pager_stats.readahead = 0;
+	pager_stats.readahead_unused = 0;
 }
 
 #else /* CFG_WITH_STATS */
@@ -132,6 +222,12 @@ static inline void incr_hidden_hits(void) { }
 static inline void incr_zi_released(void) { }
 static inline void incr_npages_all(void) { }
 static inline void set_npages(void) { }
+static inline void incr_faults(void) { }
+static inline void incr_evictions(void) { }
+static inline void incr_second_chances(void) { }
+static inline void incr_hides(void) { }
+static inline void incr_readahead(void) { }
+static inline void incr_readahead_unused(void) { }
 
 void tee_pager_get_stats(struct tee_pager_stats *stats)
 {
@@ -488,15 +584,18 @@ static void pmem_assign_fobj_page(struct tee_pager_pmem *pmem,
 	assert(va >= reg->base && va < (reg->base + reg->size));
 	fobj_pgidx = (va - reg->base) / SMALL_PAGE_SIZE + reg->fobj_pgoffs;
 
-	TAILQ_FOREACH(p, &tee_pager_pmem_head, link)
-		assert(p->fobj != reg->fobj || p->fobj_pgidx != fobj_pgidx);
+	TAILQ_FOREACH(p, &reg->fobj->pmems, fobj_link)
+		assert(p->fobj_pgidx != fobj_pgidx);
 
 	pmem->fobj = reg->fobj;
 	pmem->fobj_pgidx = fobj_pgidx;
+	TAILQ_INSERT_TAIL(&pmem->fobj->pmems, pmem, fobj_link);
 }
 
 static void pmem_clear(struct tee_pager_pmem *pmem)
 {
+	if (pmem->fobj)
+		TAILQ_REMOVE(&pmem->fobj->pmems, pmem, fobj_link);
 	pmem->fobj = NULL;
 	pmem->fobj_pgidx = INVALID_PGIDX;
 	pmem->flags = 0;
@@ -1021,9 +1120,8 @@ static void rem_region(struct vm_paged_region_head *regions,
 	TAILQ_REMOVE(regions, reg, link);
 	TAILQ_REMOVE(&reg->fobj->regions, reg, fobj_link);
 
-	TAILQ_FOREACH(pmem, &tee_pager_pmem_head, link) {
-		if (pmem->fobj != reg->fobj ||
-		    pmem->fobj_pgidx < reg->fobj_pgoffs ||
+	TAILQ_FOREACH(pmem, &reg->fobj->pmems, fobj_link) {
+		if (pmem->fobj_pgidx < reg->fobj_pgoffs ||
 		    pmem->fobj_pgidx > last_pgoffs)
 			continue;
 
@@ -1124,7 +1222,7 @@ bool tee_pager_set_um_region_attr(struct user_mode_ctx *uctx, vaddr_t base,
 		if (reg->flags == f)
 			goto next_region;
 
-		TAILQ_FOREACH(pmem, &tee_pager_pmem_head, link) {
+		TAILQ_FOREACH(pmem, &reg->fobj->pmems, fobj_link) {
 			if (!pmem_is_covered_by_region(pmem, reg))
 				continue;
 
@@ -1187,9 +1285,12 @@ void tee_pager_invalidate_fobj(struct fobj *fobj)
 
 	exceptions = pager_lock_check_stack(64);
 
-	TAILQ_FOREACH(pmem, &tee_pager_pmem_head, link)
-		if (pmem->fobj == fobj)
-			pmem_clear(pmem);
+	while (true) {
+		pmem = TAILQ_FIRST(&fobj->pmems);
+		if (!pmem)
+			break;
+		pmem_clear(pmem);
+	}
 
 	pager_unlock(exceptions);
 }
@@ -1203,8 +1304,8 @@ static struct tee_pager_pmem *pmem_find(struct vm_paged_region *reg, vaddr_t va)
 	assert(va >= reg->base && va < (reg->base + reg->size));
 	fobj_pgidx = (va - reg->base) / SMALL_PAGE_SIZE + reg->fobj_pgoffs;
 
-	TAILQ_FOREACH(pmem, &tee_pager_pmem_head, link)
-		if (pmem->fobj == reg->fobj && pmem->fobj_pgidx == fobj_pgidx)
+	TAILQ_FOREACH(pmem, &reg->fobj->pmems, fobj_link)
+		if (pmem->fobj_pgidx == fobj_pgidx)
 			return pmem;
 
 	return NULL;
@@ -1275,13 +1376,25 @@ static bool tee_pager_unhide_page(struct vm_paged_region *reg, vaddr_t page_va)
 	}
 	pgt_inc_used_entries(tblidx.pgt);
 
-	TAILQ_REMOVE(&tee_pager_pmem_head, pmem, link);
-	TAILQ_INSERT_TAIL(&tee_pager_pmem_head, pmem, link);
+	pmem->flags &= ~PMEM_FLAG_READ_AHEAD;
+	pager_policy->page_referenced(pmem);
 	incr_hidden_hits();
 	return true;
 }
 
-static void tee_pager_hide_pages(void)
+static void pmem_hide(struct tee_pager_pmem *pmem)
+{
+	pmem->flags |= PMEM_FLAG_HIDDEN;
+	pmem_unmap(pmem, NULL);
+	incr_hides();
+}
+
+/*
+ * Default FIFO policy: the oldest page is evicted. Recency is
+ * approximated by hiding the oldest pages after each fault, a page
+ * accessed again while hidden is moved last in the list.
+ */
+static void fifo_hide_pages(void)
 {
 	struct tee_pager_pmem *pmem = NULL;
 	size_t n = 0;
@@ -1298,9 +1411,63 @@ static void tee_pager_hide_pages(void)
 		if (pmem_is_hidden(pmem))
 			continue;
 
-		pmem->flags |= PMEM_FLAG_HIDDEN;
-		pmem_unmap(pmem, NULL);
+		pmem_hide(pmem);
+	}
+}
+
+static struct tee_pager_pmem *fifo_get_victim(void)
+{
+	return TAILQ_FIRST(&tee_pager_pmem_head);
+}
+
+static void fifo_page_referenced(struct tee_pager_pmem *pmem)
+{
+	TAILQ_REMOVE(&tee_pager_pmem_head, pmem, link);
+	TAILQ_INSERT_TAIL(&tee_pager_pmem_head, pmem, link);
+}
+
+static void fifo_page_added(struct tee_pager_pmem *pmem __unused)
+{
+}
+
+/*
+ * CLOCK (second chance) policy: the head of the list is the clock hand.
+ * A referenced page passed by the hand has its referenced bit cleared,
+ * is hidden and moved last in the list. A page accessed while hidden
+ * gets its referenced bit set again, a page still unreferenced when
+ * reached by the hand is evicted. Pages are only hidden when passed by
+ * the hand so frequently used pages aren't repeatedly refaulted.
+ */
+static struct tee_pager_pmem *clock_get_victim(void)
+{
+	struct tee_pager_pmem *pmem = NULL;
+	size_t n = 0;
+
+	/* All referenced bits are cleared after one revolution */
+	for (n = 0; n <= tee_pager_npages; n++) {
+		pmem = TAILQ_FIRST(&tee_pager_pmem_head);
+		if (!pmem || !pmem->fobj ||
+		    !(pmem->flags & PMEM_FLAG_REFERENCED))
+			return pmem;
+
+		pmem->flags &= ~PMEM_FLAG_REFERENCED;
+		if (!pmem_is_hidden(pmem))
+			pmem_hide(pmem);
+		TAILQ_REMOVE(&tee_pager_pmem_head, pmem, link);
+		TAILQ_INSERT_TAIL(&tee_pager_pmem_head, pmem, link);
+		incr_second_chances();
 	}
+
+	return TAILQ_FIRST(&tee_pager_pmem_head);
+}
+
+static void clock_page_referenced(struct tee_pager_pmem *pmem)
+{
+	pmem->flags |= PMEM_FLAG_REFERENCED;
+}
+
+static void clock_hide_pages(void)
+{
 }
 
 static unsigned int __maybe_unused
@@ -1331,8 +1498,12 @@ static bool tee_pager_release_one_phys(struct vm_paged_region *reg,
 	fobj_pgidx = (page_va - reg->base) / SMALL_PAGE_SIZE +
 		     reg->fobj_pgoffs;
 
-	TAILQ_FOREACH(pmem, &tee_pager_lock_pmem_head, link) {
-		if (pmem->fobj != reg->fobj || pmem->fobj_pgidx != fobj_pgidx)
+	/* Only pages of locked regions are in tee_pager_lock_pmem_head */
+	if (reg->type != PAGED_REGION_TYPE_LOCK)
+		return false;
+
+	TAILQ_FOREACH(pmem, &reg->fobj->pmems, fobj_link) {
+		if (pmem->fobj_pgidx != fobj_pgidx)
 			continue;
 
 		/*
@@ -1357,45 +1528,61 @@ static bool tee_pager_release_one_phys(struct vm_paged_region *reg,
 	return false;
 }
 
-static void pager_deploy_page(struct tee_pager_pmem *pmem,
-			      struct vm_paged_region *reg, vaddr_t page_va,
-			      bool clean_user_cache, bool writable)
+/* Allow or forbid writes to the aliased virtual page of @pmem */
+static void pmem_set_alias_writable(struct tee_pager_pmem *pmem,
+				    bool writable)
 {
-	struct tblidx tblidx = region_va2tblidx(reg, page_va);
-	uint32_t attr = get_region_mattr(reg->flags);
-	struct core_mmu_table_info *ti = NULL;
-	uint8_t *va_alias = pmem->va_alias;
-	paddr_t pa = get_pmem_pa(pmem);
-	unsigned int idx_alias = 0;
+	vaddr_t va_alias = (vaddr_t)pmem->va_alias;
+	struct core_mmu_table_info *ti = find_table_info(va_alias);
+	unsigned int idx_alias = core_mmu_va2idx(ti, va_alias);
 	uint32_t attr_alias = 0;
 	paddr_t pa_alias = 0;
 
-	/* Ensure we are allowed to write to aliased virtual page */
-	ti = find_table_info((vaddr_t)va_alias);
-	idx_alias = core_mmu_va2idx(ti, (vaddr_t)va_alias);
 	core_mmu_get_entry(ti, idx_alias, &pa_alias, &attr_alias);
-	if (!(attr_alias & TEE_MATTR_PW)) {
+	if (!(attr_alias & TEE_MATTR_PW) == !writable)
+		return;
+
+	if (writable)
 		attr_alias |= TEE_MATTR_PW;
-		core_mmu_set_entry(ti, idx_alias, pa_alias, attr_alias);
-		tlbi_va_allasid((vaddr_t)va_alias);
-	}
+	else
+		attr_alias &= ~TEE_MATTR_PW;
+	core_mmu_set_entry(ti, idx_alias, pa_alias, attr_alias);
+	tlbi_va_allasid(va_alias);
+}
 
+/* Prepare the aliased virtual page of @pmem to load its content */
+static void pmem_prepare_load(struct tee_pager_pmem *pmem)
+{
+	uint8_t *va_alias = pmem->va_alias;
+
+	pmem_set_alias_writable(pmem, true);
 	asan_tag_access(va_alias, va_alias + SMALL_PAGE_SIZE);
-	if (fobj_load_page(pmem->fobj, pmem->fobj_pgidx, va_alias)) {
-		EMSG("PH 0x%" PRIxVA " failed", page_va);
-		panic();
-	}
+}
+
+/*
+ * Adds @pmem, loaded with the content of the page at @page_va, to the
+ * pmems in use and maps it at @page_va.
+ */
+static void pager_map_loaded_page(struct tee_pager_pmem *pmem,
+				  struct vm_paged_region *reg, vaddr_t page_va,
+				  bool clean_user_cache, bool writable)
+{
+	struct tblidx tblidx = region_va2tblidx(reg, page_va);
+	uint32_t attr = get_region_mattr(reg->flags);
+	uint8_t *va_alias = pmem->va_alias;
+	paddr_t pa = get_pmem_pa(pmem);
+
 	switch (reg->type) {
 	case PAGED_REGION_TYPE_RO:
 		TAILQ_INSERT_TAIL(&tee_pager_pmem_head, pmem, link);
+		pager_policy->page_added(pmem);
 		incr_ro_hits();
 		/* Forbid write to aliases for read-only (maybe exec) pages */
-		attr_alias &= ~TEE_MATTR_PW;
-		core_mmu_set_entry(ti, idx_alias, pa_alias, attr_alias);
-		tlbi_va_allasid((vaddr_t)va_alias);
+		pmem_set_alias_writable(pmem, false);
 		break;
 	case PAGED_REGION_TYPE_RW:
 		TAILQ_INSERT_TAIL(&tee_pager_pmem_head, pmem, link);
+		pager_policy->page_added(pmem);
 		if (writable && (attr & (TEE_MATTR_PW | TEE_MATTR_UW)))
 			pmem->flags |= PMEM_FLAG_DIRTY;
 		incr_rw_hits();
@@ -1469,6 +1656,19 @@ static void pager_deploy_page(struct tee_pager_pmem *pmem,
 	FMSG("Mapped 0x%" PRIxVA " -> 0x%" PRIxPA, page_va, pa);
 }
 
+static void pager_deploy_page(struct tee_pager_pmem *pmem,
+			      struct vm_paged_region *reg, vaddr_t page_va,
+			      bool clean_user_cache, bool writable)
+{
+	pmem_prepare_load(pmem);
+	if (fobj_load_page(pmem->fobj, pmem->fobj_pgidx, pmem->va_alias)) {
+		EMSG("PH 0x%" PRIxVA " failed", page_va);
+		panic();
+	}
+
+	pager_map_loaded_page(pmem, reg, page_va, clean_user_cache, writable);
+}
+
 static void make_dirty_page(struct tee_pager_pmem *pmem,
 			    struct vm_paged_region *reg, struct tblidx tblidx,
 			    paddr_t pa)
@@ -1551,15 +1751,17 @@ static void pager_get_page(struct vm_paged_region *reg, struct abort_info *ai,
 	vaddr_t page_va = ai->va & ~SMALL_PAGE_MASK;
 	struct tblidx tblidx = region_va2tblidx(reg, page_va);
 	struct tee_pager_pmem *pmem = NULL;
+	size_t num_kept = 0;
 	bool writable = false;
 	uint32_t attr = 0;
+	TEE_Result res = TEE_SUCCESS;
 
 	/*
 	 * Get a pmem to load code and data into, also make sure
 	 * the corresponding IV page is available.
 	 */
 	while (true) {
-		pmem = TAILQ_FIRST(&tee_pager_pmem_head);
+		pmem = pager_policy->get_victim();
 		if (!pmem) {
 			EMSG("No pmem entries");
 			abort_print(ai);
@@ -1567,6 +1769,9 @@ static void pager_get_page(struct vm_paged_region *reg, struct abort_info *ai,
 		}
 
 		if (pmem->fobj) {
+			incr_evictions();
+			if (pmem->flags & PMEM_FLAG_READ_AHEAD)
+				incr_readahead_unused();
 			pmem_unmap(pmem, NULL);
 			if (pmem_is_dirty(pmem)) {
 				uint8_t *va = pmem->va_alias;
@@ -1574,10 +1779,27 @@ static void pager_get_page(struct vm_paged_region *reg, struct abort_info *ai,
 				make_iv_available(pmem->fobj, pmem->fobj_pgidx,
 						  true /*writable*/);
 				asan_tag_access(va, va + SMALL_PAGE_SIZE);
-				if (fobj_save_page(pmem->fobj, pmem->fobj_pgidx,
-						   pmem->va_alias))
-					panic("fobj_save_page");
+				res = fobj_save_page(pmem->fobj,
+						     pmem->fobj_pgidx,
+						     pmem->va_alias);
 				asan_tag_no_access(va, va + SMALL_PAGE_SIZE);
+				if (res == TEE_ERROR_OUT_OF_MEMORY &&
+				    num_kept < tee_pager_npages) {
+					/*
+					 * The backing store is full, keep
+					 * the page hidden and try another
+					 * one.
+					 */
+					pmem->flags |= PMEM_FLAG_HIDDEN;
+					TAILQ_REMOVE(&tee_pager_pmem_head,
+						     pmem, link);
+					TAILQ_INSERT_TAIL(&tee_pager_pmem_head,
+							  pmem, link);
+					num_kept++;
+					continue;
+				}
+				if (res)
+					panic("fobj_save_page");
 
 				pmem_clear(pmem);
 
@@ -1653,6 +1875,112 @@ static void pager_get_page(struct vm_paged_region *reg, struct abort_info *ai,
 	pager_deploy_page(pmem, reg, page_va, clean_user_cache, writable);
 }
 
+/*
+ * Returns a pmem which can be used to load a page ahead without evicting
+ * a page likely to be in use: either an unused pmem or a clean page which
+ * hasn't been accessed since it was hidden.
+ */
+static struct tee_pager_pmem *get_readahead_pmem(void)
+{
+	struct tee_pager_pmem *pmem = TAILQ_FIRST(&tee_pager_pmem_head);
+
+	if (!pmem)
+		return NULL;
+
+	if (pmem->fobj) {
+		if (!pmem_is_hidden(pmem) || pmem_is_dirty(pmem) ||
+		    (pmem->flags & PMEM_FLAG_REFERENCED))
+			return NULL;
+
+		incr_evictions();
+		if (pmem->flags & PMEM_FLAG_READ_AHEAD)
+			incr_readahead_unused();
+		pmem_unmap(pmem, NULL);
+	}
+
+	TAILQ_REMOVE(&tee_pager_pmem_head, pmem, link);
+	pmem_clear(pmem);
+
+	return pmem;
+}
+
+#if CFG_CORE_PAGER_FAULT_AROUND_PAGES
+/* Pages loaded ahead are tracked on the stack, keep them few */
+static_assert(CFG_CORE_PAGER_FAULT_AROUND_PAGES <= 32);
+
+/*
+ * Read-only pages tend to be accessed in sequence, load and map the
+ * pages following @page_va in @reg while it can be done without evicting
+ * pages in use. The pages are loaded and their hashes checked in one
+ * batch, this saves one abort per page loaded ahead.
+ *
+ * A page loaded ahead is added like any loaded page. The policy hides it
+ * when it becomes a candidate for eviction and it's only counted as
+ * unused if it's evicted without being accessed after that.
+ */
+static void pager_fault_around(struct vm_paged_region *reg, vaddr_t page_va,
+			       bool clean_user_cache)
+{
+	struct tee_pager_pmem *pmems[CFG_CORE_PAGER_FAULT_AROUND_PAGES] = { };
+	void *va_alias[CFG_CORE_PAGER_FAULT_AROUND_PAGES] = { };
+	size_t max_pages = MIN((size_t)CFG_CORE_PAGER_FAULT_AROUND_PAGES,
+			       tee_pager_npages / 4);
+	struct tee_pager_pmem *pmem = NULL;
+	vaddr_t reg_end = reg->base + reg->size;
+	vaddr_t va = page_va;
+	size_t num_pages = 0;
+	uint32_t attr = 0;
+	size_t n = 0;
+
+	if (reg->type != PAGED_REGION_TYPE_RO)
+		return;
+
+	for (n = 0; n < max_pages; n++) {
+		va += SMALL_PAGE_SIZE;
+		if (va >= reg_end)
+			break;
+
+		/* Stop at the first page already loaded */
+		tblidx_get_entry(region_va2tblidx(reg, va), NULL, &attr);
+		if ((attr & TEE_MATTR_VALID_BLOCK) || pmem_find(reg, va))
+			break;
+
+		pmem = get_readahead_pmem();
+		if (!pmem)
+			break;
+
+		pmem_assign_fobj_page(pmem, reg, va);
+		pmem_prepare_load(pmem);
+		pmems[num_pages] = pmem;
+		va_alias[num_pages] = pmem->va_alias;
+		num_pages++;
+	}
+
+	if (!num_pages)
+		return;
+
+	if (fobj_load_pages(reg->fobj, pmems[0]->fobj_pgidx, va_alias,
+			    num_pages)) {
+		EMSG("PH 0x%" PRIxVA " failed", page_va + SMALL_PAGE_SIZE);
+		panic();
+	}
+
+	for (n = 0; n < num_pages; n++) {
+		va = page_va + (n + 1) * SMALL_PAGE_SIZE;
+		pager_map_loaded_page(pmems[n], reg, va, clean_user_cache,
+				      false /*!writable*/);
+		pmems[n]->flags |= PMEM_FLAG_READ_AHEAD;
+		incr_readahead();
+	}
+}
+#else
+static void pager_fault_around(struct vm_paged_region *reg __unused,
+			       vaddr_t page_va __unused,
+			       bool clean_user_cache __unused)
+{
+}
+#endif /*CFG_CORE_PAGER_FAULT_AROUND_PAGES*/
+
 static bool pager_update_permissions(struct vm_paged_region *reg,
 				     struct abort_info *ai, bool *handled)
 {
@@ -1779,6 +2107,7 @@ bool tee_pager_handle_fault(struct abort_info *ai)
 	exceptions = pager_lock(ai);
 
 	stat_handle_fault();
+	incr_faults();
 
 	/* check if the access is valid */
 	if (abort_is_user_exception(ai)) {
@@ -1815,8 +2144,11 @@ bool tee_pager_handle_fault(struct abort_info *ai)
 
 	pager_get_page(reg, ai, clean_user_cache);
 
+	if (CFG_CORE_PAGER_FAULT_AROUND_PAGES)
+		pager_fault_around(reg, page_va, clean_user_cache);
+
 out_success:
-	tee_pager_hide_pages();
+	pager_policy->hide_pages();
 	ret = true;
 out:
 	pager_unlock(exceptions);
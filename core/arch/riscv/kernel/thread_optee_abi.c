@@ -421,7 +421,8 @@ static bool set_rmem(struct optee_msg_param *param,
 {
 	param->attr = tpm->attr - THREAD_PARAM_ATTR_MEMREF_IN +
 		      OPTEE_MSG_ATTR_TYPE_RMEM_INPUT;
-	param->u.rmem.offs = tpm->u.memref.offs;
+	param->u.rmem.offs = tpm->u.memref.offs +
+			     thread_rpc_arena_offs(tpm->u.memref.mobj);
 	param->u.rmem.size = tpm->u.memref.size;
 	if (tpm->u.memref.mobj) {
 		param->u.rmem.shm_ref = mobj_get_cookie(tpm->u.memref.mobj);
@@ -578,7 +579,10 @@ uint32_t thread_rpc_cmd(uint32_t cmd, size_t num_params,
 	reg_pair_from_64(carg, rpc_args + 1, rpc_args + 2);
 	thread_rpc(rpc_args);
 
-	return get_rpc_arg_res(arg, num_params, params);
+	ret = get_rpc_arg_res(arg, num_params, params);
+	thread_rpc_arena_check_res(num_params, params, ret);
+
+	return ret;
 }
 
 /**
@@ -674,7 +678,7 @@ static struct mobj *thread_rpc_alloc(size_t size, size_t align, unsigned int bt)
 	return get_rpc_alloc_res(arg, bt, size);
 }
 
-struct mobj *thread_rpc_alloc_payload(size_t size)
+struct mobj *thread_rpc_alloc_appl_payload(size_t size)
 {
 	return thread_rpc_alloc(size, 8, OPTEE_RPC_SHM_TYPE_APPL);
 }
@@ -697,7 +701,7 @@ void thread_rpc_free_kernel_payload(struct mobj *mobj)
 	thread_rpc_free(OPTEE_RPC_SHM_TYPE_KERNEL, mobj_get_cookie(mobj), mobj);
 }
 
-void thread_rpc_free_payload(struct mobj *mobj)
+void thread_rpc_free_appl_payload(struct mobj *mobj)
 {
 	thread_rpc_free(OPTEE_RPC_SHM_TYPE_APPL, mobj_get_cookie(mobj),
 			mobj);
@@ -79,6 +79,12 @@ endif
 # Otherwise, you need to implement hw_get_random_bytes() for your platform
 CFG_WITH_SOFTWARE_PRNG ?= y
 
+# With CFG_WITH_SOFTWARE_PRNG, small requests from TAs are served from a
+# per-CPU buffer of CFG_CRYPTO_RNG_CPU_BUFFER_SIZE bytes of PRNG output
+# refilled in bulk instead of taking the PRNG lock each time. Consumed bytes
+# are wiped from the buffer. 0 disables the buffers, the maximum is 4096.
+CFG_CRYPTO_RNG_CPU_BUFFER_SIZE ?= 0
+
 # Define the maximum size, in bits, for big numbers in the TEE core (privileged
 # layer).
 # This value is an upper limit for the key size in any cryptographic algorithm
@@ -0,0 +1,337 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+/*
+ * Iterated HMAC, HMAC(K, m) = H((K ^ opad) || H((K ^ ipad) || m)).
+ *
+ * The states of H after absorbing the padded key blocks K ^ ipad and
+ * K ^ opad don't depend on the message, they're computed once and each
+ * iteration resumes from copies of them. From the second iteration the
+ * message is the previous digest, so the remaining input of both the inner
+ * and the outer hash, including the final padding, fits in one block. With
+ * an accelerated compression function an iteration is then two calls to
+ * it on a block prepared in advance.
+ */
+
+#include <crypto/crypto.h>
+#include <crypto/crypto_accel.h>
+#include <io.h>
+#include <string.h>
+#include <string_ext.h>
+#include <types_ext.h>
+#include <utee_defines.h>
+
+#define MAX_BLOCK_SIZE	128
+
+static TEE_Result get_sizes(uint32_t hash_algo, size_t *block_size,
+			    size_t *hash_len)
+{
+	switch (hash_algo) {
+	case TEE_ALG_MD5:
+	case TEE_ALG_SHA1:
+	case TEE_ALG_SHA224:
+	case TEE_ALG_SHA256:
+	case TEE_ALG_SM3:
+		*block_size = 64;
+		break;
+	case TEE_ALG_SHA384:
+	case TEE_ALG_SHA512:
+		*block_size = 128;
+		break;
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+
+	*hash_len = __tee_alg_get_digest_size(hash_algo);
+	return TEE_SUCCESS;
+}
+
+static void xor_into(uint8_t *out, const uint8_t *u, size_t len)
+{
+	size_t n = 0;
+
+	for (n = 0; n < len; n++)
+		out[n] ^= u[n];
+}
+
+#if defined(CFG_CORE_CRYPTO_SHA1_ACCEL) || \
+	defined(CFG_CORE_CRYPTO_SHA256_ACCEL)
+static void iterate32(void (*compress)(uint32_t *state, const void *src,
+				       unsigned int block_count),
+		      const uint32_t *iv, size_t state_words,
+		      const uint8_t *ipad, const uint8_t *opad, uint8_t *u,
+		      size_t hash_len, uint32_t count, uint8_t *out,
+		      size_t out_len)
+{
+	uint32_t istate[8] = { };
+	uint32_t ostate[8] = { };
+	uint32_t state[8] = { };
+	uint8_t block[64] = { };
+	size_t state_size = state_words * sizeof(uint32_t);
+	size_t n = 0;
+
+	memcpy(istate, iv, state_size);
+	compress(istate, ipad, 1);
+	memcpy(ostate, iv, state_size);
+	compress(ostate, opad, 1);
+
+	/* Both hashes end with a hash_len message after one key block */
+	block[hash_len] = 0x80;
+	put_be64(block + sizeof(block) - sizeof(uint64_t),
+		 (sizeof(block) + hash_len) * 8);
+
+	while (--count) {
+		memcpy(block, u, hash_len);
+		memcpy(state, istate, state_size);
+		compress(state, block, 1);
+		for (n = 0; n < hash_len / sizeof(uint32_t); n++)
+			put_be32(block + n * sizeof(uint32_t), state[n]);
+
+		memcpy(state, ostate, state_size);
+		compress(state, block, 1);
+		for (n = 0; n < hash_len / sizeof(uint32_t); n++)
+			put_be32(u + n * sizeof(uint32_t), state[n]);
+
+		xor_into(out, u, out_len);
+	}
+
+	memzero_explicit(istate, sizeof(istate));
+	memzero_explicit(ostate, sizeof(ostate));
+	memzero_explicit(state, sizeof(state));
+	memzero_explicit(block, sizeof(block));
+}
+#endif
+
+#if defined(CFG_CORE_CRYPTO_SHA512_ACCEL)
+static void iterate64(const uint64_t *iv, const uint8_t *ipad,
+		      const uint8_t *opad, uint8_t *u, size_t hash_len,
+		      uint32_t count, uint8_t *out, size_t out_len)
+{
+	uint64_t istate[8] = { };
+	uint64_t ostate[8] = { };
+	uint64_t state[8] = { };
+	uint8_t block[128] = { };
+	size_t n = 0;
+
+	memcpy(istate, iv, sizeof(istate));
+	crypto_accel_sha512_compress(istate, ipad, 1);
+	memcpy(ostate, iv, sizeof(ostate));
+	crypto_accel_sha512_compress(ostate, opad, 1);
+
+	/* The length field is 128 bits, the upper half stays zero */
+	block[hash_len] = 0x80;
+	put_be64(block + sizeof(block) - sizeof(uint64_t),
+		 (sizeof(block) + hash_len) * 8);
+
+	while (--count) {
+		memcpy(block, u, hash_len);
+		memcpy(state, istate, sizeof(state));
+		crypto_accel_sha512_compress(state, block, 1);
+		for (n = 0; n < hash_len / sizeof(uint64_t); n++)
+			put_be64(block + n * sizeof(uint64_t), state[n]);
+
+		memcpy(state, ostate, sizeof(state));
+		crypto_accel_sha512_compress(state, block, 1);
+		for (n = 0; n < hash_len / sizeof(uint64_t); n++)
+			put_be64(u + n * sizeof(uint64_t), state[n]);
+
+		xor_into(out, u, out_len);
+	}
+
+	memzero_explicit(istate, sizeof(istate));
+	memzero_explicit(ostate, sizeof(ostate));
+	memzero_explicit(state, sizeof(state));
+	memzero_explicit(block, sizeof(block));
+}
+#endif
+
+/*
+ * Runs iterations 2 to @count on the accelerated compression function of
+ * @hash_algo. Returns false if there's none.
+ */
+static bool iterate_accel(uint32_t hash_algo, const uint8_t *ipad,
+			  const uint8_t *opad, uint8_t *u, size_t hash_len,
+			  uint32_t count, uint8_t *out, size_t out_len)
+{
+#if defined(CFG_CORE_CRYPTO_SHA1_ACCEL)
+	static const uint32_t sha1_iv[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+	};
+#endif
+#if defined(CFG_CORE_CRYPTO_SHA256_ACCEL)
+	static const uint32_t sha224_iv[8] = {
+		0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+		0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+	};
+	static const uint32_t sha256_iv[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+#endif
+#if defined(CFG_CORE_CRYPTO_SHA512_ACCEL)
+	static const uint64_t sha384_iv[8] = {
+		0xcbbb9d5dc1059ed8, 0x629a292a367cd507,
+		0x9159015a3070dd17, 0x152fecd8f70e5939,
+		0x67332667ffc00b31, 0x8eb44a8768581511,
+		0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4
+	};
+	static const uint64_t sha512_iv[8] = {
+		0x6a09e667f3bcc908, 0xbb67ae8584caa73b,
+		0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+		0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+		0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+	};
+#endif
+
+	switch (hash_algo) {
+#if defined(CFG_CORE_CRYPTO_SHA1_ACCEL)
+	case TEE_ALG_SHA1:
+		iterate32(crypto_accel_sha1_compress, sha1_iv,
+			  ARRAY_SIZE(sha1_iv), ipad, opad, u, hash_len, count,
+			  out, out_len);
+		return true;
+#endif
+#if defined(CFG_CORE_CRYPTO_SHA256_ACCEL)
+	case TEE_ALG_SHA224:
+		iterate32(crypto_accel_sha256_compress, sha224_iv,
+			  ARRAY_SIZE(sha224_iv), ipad, opad, u, hash_len,
+			  count, out, out_len);
+		return true;
+	case TEE_ALG_SHA256:
+		iterate32(crypto_accel_sha256_compress, sha256_iv,
+			  ARRAY_SIZE(sha256_iv), ipad, opad, u, hash_len,
+			  count, out, out_len);
+		return true;
+#endif
+#if defined(CFG_CORE_CRYPTO_SHA512_ACCEL)
+	case TEE_ALG_SHA384:
+		iterate64(sha384_iv, ipad, opad, u, hash_len, count, out,
+			  out_len);
+		return true;
+	case TEE_ALG_SHA512:
+		iterate64(sha512_iv, ipad, opad, u, hash_len, count, out,
+			  out_len);
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+/* Computes HMAC(@msg) into @u from the precomputed states */
+static TEE_Result hmac_once(void *ctx, void *ictx, void *octx,
+			    const uint8_t *msg, size_t msg_len, uint8_t *u,
+			    size_t hash_len)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	crypto_hash_copy_state(ctx, ictx);
+	res = crypto_hash_update(ctx, msg, msg_len);
+	if (res)
+		return res;
+	res = crypto_hash_final(ctx, u, hash_len);
+	if (res)
+		return res;
+
+	crypto_hash_copy_state(ctx, octx);
+	res = crypto_hash_update(ctx, u, hash_len);
+	if (res)
+		return res;
+	return crypto_hash_final(ctx, u, hash_len);
+}
+
+TEE_Result crypto_hmac_iterate(uint32_t hash_algo, const uint8_t *key,
+			       size_t key_len, const uint8_t *msg,
+			       size_t msg_len, uint32_t count, uint8_t *out,
+			       size_t out_len)
+{
+	uint8_t ipad[MAX_BLOCK_SIZE] = { };
+	uint8_t opad[MAX_BLOCK_SIZE] = { };
+	uint8_t u[TEE_MAX_HASH_SIZE] = { };
+	TEE_Result res = TEE_SUCCESS;
+	size_t block_size = 0;
+	size_t hash_len = 0;
+	void *ictx = NULL;
+	void *octx = NULL;
+	void *ctx = NULL;
+	size_t n = 0;
+
+	res = get_sizes(hash_algo, &block_size, &hash_len);
+	if (res)
+		return res;
+	if (out_len > hash_len)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	memset(out, 0, out_len);
+	if (!count)
+		return TEE_SUCCESS;
+
+	res = crypto_hash_alloc_ctx(&ctx, hash_algo);
+	if (res)
+		return res;
+	res = crypto_hash_alloc_ctx(&ictx, hash_algo);
+	if (res)
+		goto out;
+	res = crypto_hash_alloc_ctx(&octx, hash_algo);
+	if (res)
+		goto out;
+
+	/* Keys longer than a block are replaced by their digest */
+	if (key_len > block_size) {
+		res = crypto_hash_init(ctx);
+		if (res)
+			goto out;
+		res = crypto_hash_update(ctx, key, key_len);
+		if (res)
+			goto out;
+		res = crypto_hash_final(ctx, ipad, hash_len);
+		if (res)
+			goto out;
+	} else if (key_len) {
+		memcpy(ipad, key, key_len);
+	}
+	for (n = 0; n < block_size; n++) {
+		opad[n] = ipad[n] ^ 0x5c;
+		ipad[n] ^= 0x36;
+	}
+
+	res = crypto_hash_init(ictx);
+	if (res)
+		goto out;
+	res = crypto_hash_update(ictx, ipad, block_size);
+	if (res)
+		goto out;
+	res = crypto_hash_init(octx);
+	if (res)
+		goto out;
+	res = crypto_hash_update(octx, opad, block_size);
+	if (res)
+		goto out;
+
+	res = hmac_once(ctx, ictx, octx, msg, msg_len, u, hash_len);
+	if (res)
+		goto out;
+	xor_into(out, u, out_len);
+
+	if (iterate_accel(hash_algo, ipad, opad, u, hash_len, count, out,
+			  out_len))
+		goto out;
+
+	while (--count) {
+		res = hmac_once(ctx, ictx, octx, u, hash_len, u, hash_len);
+		if (res)
+			goto out;
+		xor_into(out, u, out_len);
+	}
+
+out:
+	memzero_explicit(ipad, sizeof(ipad));
+	memzero_explicit(opad, sizeof(opad));
+	memzero_explicit(u, sizeof(u));
+	crypto_hash_free_ctx(octx);
+	crypto_hash_free_ctx(ictx);
+	crypto_hash_free_ctx(ctx);
+	return res;
+}
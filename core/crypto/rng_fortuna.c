@@ -9,11 +9,14 @@
 
 #include <assert.h>
 #include <crypto/crypto.h>
+#include <kernel/misc.h>
 #include <kernel/mutex.h>
 #include <kernel/refcount.h>
 #include <kernel/spinlock.h>
 #include <kernel/tee_time.h>
+#include <kernel/thread.h>
 #include <string.h>
+#include <string_ext.h>
 #include <types_ext.h>
 #include <utee_defines.h>
 #include <util.h>
@@ -529,3 +532,95 @@ TEE_Result crypto_rng_read(void *buf, size_t blen)
 		offs += n;
 	}
 }
+
+#if CFG_CRYPTO_RNG_CPU_BUFFER_SIZE
+/* Buffers are static, one per CPU, keep them small */
+static_assert(CFG_CRYPTO_RNG_CPU_BUFFER_SIZE <= 4096);
+
+/* Larger requests aren't worth draining the buffers */
+#define CPU_BUF_MAX_READ	(CFG_CRYPTO_RNG_CPU_BUFFER_SIZE / 4)
+
+/*
+ * struct rng_cpu_buf - Per-CPU buffer of Fortuna output
+ * @data:	Generated bytes, the first @avail bytes are unused
+ * @avail:	Number of bytes available in @data
+ *
+ * Bytes are served from the end of the unused ones and wiped once
+ * served, so a compromise of the buffer doesn't reveal past output. A
+ * buffer is only accessed by its CPU with foreign interrupts masked.
+ */
+static struct rng_cpu_buf {
+	uint8_t data[CFG_CRYPTO_RNG_CPU_BUFFER_SIZE];
+	size_t avail;
+} rng_cpu_buf[CFG_TEE_CORE_NB_CORE];
+
+/*
+ * Staging buffer for refills: the PRNG is read with foreign interrupts
+ * unmasked, so not directly into a CPU buffer. Refills are serialized by
+ * the PRNG lock anyway.
+ */
+static uint8_t rng_refill[CFG_CRYPTO_RNG_CPU_BUFFER_SIZE];
+static struct mutex rng_refill_mu = MUTEX_INITIALIZER;
+
+static void cpu_buf_take(struct rng_cpu_buf *cb, void *buf, size_t blen)
+{
+	assert(cb->avail >= blen);
+
+	cb->avail -= blen;
+	memcpy(buf, cb->data + cb->avail, blen);
+	memzero_explicit(cb->data + cb->avail, blen);
+}
+
+TEE_Result crypto_rng_read_buffered(void *buf, size_t blen)
+{
+	struct rng_cpu_buf *cb = NULL;
+	uint32_t exceptions = 0;
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	if (!blen || blen > CPU_BUF_MAX_READ)
+		return crypto_rng_read(buf, blen);
+
+	exceptions = thread_mask_exceptions(THREAD_EXCP_FOREIGN_INTR);
+	cb = rng_cpu_buf + get_core_pos();
+	if (cb->avail >= blen) {
+		cpu_buf_take(cb, buf, blen);
+		thread_unmask_exceptions(exceptions);
+		return TEE_SUCCESS;
+	}
+	thread_unmask_exceptions(exceptions);
+
+	/*
+	 * Refill outside of the CPU buffer access since the PRNG lock may
+	 * sleep. Fortuna rekeys after the read so the buffered bytes can't
+	 * be recomputed from a later state.
+	 */
+	mutex_lock(&rng_refill_mu);
+	res = crypto_rng_read(rng_refill, sizeof(rng_refill));
+	if (res)
+		goto out;
+
+	/*
+	 * The thread may have migrated meanwhile. Bytes still available are
+	 * kept, the refill only tops the buffer up after them.
+	 */
+	exceptions = thread_mask_exceptions(THREAD_EXCP_FOREIGN_INTR);
+	cb = rng_cpu_buf + get_core_pos();
+	n = sizeof(cb->data) - cb->avail;
+	memcpy(cb->data + cb->avail, rng_refill, n);
+	cb->avail += n;
+	cpu_buf_take(cb, buf, blen);
+	thread_unmask_exceptions(exceptions);
+
+out:
+	memzero_explicit(rng_refill, sizeof(rng_refill));
+	mutex_unlock(&rng_refill_mu);
+
+	return res;
+}
+#else
+TEE_Result crypto_rng_read_buffered(void *buf, size_t blen)
+{
+	return crypto_rng_read(buf, blen);
+}
+#endif /*CFG_CRYPTO_RNG_CPU_BUFFER_SIZE*/
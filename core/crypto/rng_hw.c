@@ -29,3 +29,8 @@ TEE_Result crypto_rng_read(void *buf, size_t blen)
 
 	return hw_get_random_bytes(buf, blen);
 }
+
+TEE_Result crypto_rng_read_buffered(void *buf, size_t blen)
+{
+	return crypto_rng_read(buf, blen);
+}
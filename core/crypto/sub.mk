@@ -11,6 +11,7 @@ endif
 endif
 
 srcs-$(CFG_WITH_USER_TA) += signed_hdr.c
+srcs-y += hmac-iter.c
 
 ifeq ($(CFG_WITH_SOFTWARE_PRNG),y)
 srcs-y += rng_fortuna.c
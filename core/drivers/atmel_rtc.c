@@ -325,5 +325,6 @@ DEFINE_DT_DRIVER(atmel_rtc_dt_driver) = {
 	.type = DT_DRIVER_NOTYPE,
 	.match_table = atmel_rtc_match_table,
 	.probe = atmel_rtc_probe,
+	.async_probe = true,
 };
 
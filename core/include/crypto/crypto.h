@@ -57,6 +57,17 @@ TEE_Result crypto_mac_final(void *ctx, uint8_t *digest, size_t digest_len);
 void crypto_mac_free_ctx(void *ctx);
 void crypto_mac_copy_state(void *dst_ctx, void *src_ctx);
 
+/*
+ * Iterated HMAC keyed with @key on the hash @hash_algo (TEE_ALG_SHA1 etc):
+ * U_1 = HMAC(@msg), U_i = HMAC(U_i-1). @out receives the first @out_len
+ * bytes of U_1 ^ ... ^ U_@count, that is the function F of PBKDF2 (RFC
+ * 8018). @out_len is at most the digest size.
+ */
+TEE_Result crypto_hmac_iterate(uint32_t hash_algo, const uint8_t *key,
+			       size_t key_len, const uint8_t *msg,
+			       size_t msg_len, uint32_t count, uint8_t *out,
+			       size_t out_len);
+
 /* Authenticated encryption */
 TEE_Result crypto_authenc_alloc_ctx(void **ctx, uint32_t algo);
 TEE_Result crypto_authenc_init(void *ctx, TEE_OperationMode mode,
@@ -401,6 +412,17 @@ void crypto_rng_add_event(enum crypto_rng_src sid, unsigned int *pnum,
  */
 TEE_Result crypto_rng_read(void *buf, size_t len);
 
+/*
+ * crypto_rng_read_buffered() - read cryptograhically secure RNG, small
+ * requests being served from a per-CPU buffer of RNG output
+ * @buf:	Buffer to hold the data
+ * @len:	Length of buffer.
+ *
+ * Same as crypto_rng_read() for large requests or if the RNG isn't
+ * buffered.
+ */
+TEE_Result crypto_rng_read_buffered(void *buf, size_t len);
+
 /*
  * crypto_aes_expand_enc_key() - Expand an AES key
  * @key:	AES key buffer
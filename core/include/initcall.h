@@ -18,18 +18,38 @@ struct initcall {
 #endif
 };
 
+/*
+ * With CFG_CORE_BOOT_PROFILE the names of initcall functions are kept in
+ * the separate scattered array initcall_name to leave struct initcall as
+ * is.
+ */
+struct initcall_name {
+	TEE_Result (*func)(void);
+	const char *func_name;
+};
+
 #if TRACE_LEVEL >= TRACE_DEBUG
-#define __define_initcall(type, lvl, fn) \
+#define __define_initcall_item(type, lvl, fn) \
 	SCATTERED_ARRAY_DEFINE_PG_ITEM_ORDERED(type ## call, lvl, \
 					       struct initcall) = \
 		{ .func = (fn), .level = (lvl), .func_name = #fn, }
 #else
-#define __define_initcall(type, lvl, fn) \
+#define __define_initcall_item(type, lvl, fn) \
 	SCATTERED_ARRAY_DEFINE_PG_ITEM_ORDERED(type ## call, lvl, \
 					       struct initcall) = \
 		{ .func = (fn), }
 #endif
 
+#ifdef CFG_CORE_BOOT_PROFILE
+#define __define_initcall(type, lvl, fn) \
+	SCATTERED_ARRAY_DEFINE_PG_ITEM(initcall_name, \
+				       struct initcall_name) = \
+		{ .func = (fn), .func_name = #fn, }; \
+	__define_initcall_item(type, lvl, fn)
+#else
+#define __define_initcall(type, lvl, fn) __define_initcall_item(type, lvl, fn)
+#endif
+
 #define preinitcall_begin \
 			SCATTERED_ARRAY_BEGIN(preinitcall, struct initcall)
 #define preinitcall_end SCATTERED_ARRAY_END(preinitcall, struct initcall)
@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#ifndef __KERNEL_BOOT_PROF_H
+#define __KERNEL_BOOT_PROF_H
+
+#include <compiler.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tee_api_types.h>
+
+/*
+ * Kind of boot event recorded, values match STATS_BOOT_PROF_* exported by
+ * the stats PTA
+ */
+enum boot_prof_type {
+	BOOT_PROF_PREINITCALL = 0,
+	BOOT_PROF_EARLY_INITCALL = 1,
+	BOOT_PROF_SERVICE_INITCALL = 2,
+	BOOT_PROF_DRIVER_INITCALL = 3,
+	BOOT_PROF_FINALCALL = 4,
+	BOOT_PROF_DT_PROBE = 5,
+	BOOT_PROF_DT_REPROBE = 6,
+};
+
+#ifdef CFG_CORE_BOOT_PROFILE
+/* Returns a timestamp to be passed to boot_prof_record() */
+uint64_t boot_prof_start(void);
+
+/*
+ * boot_prof_record() - Record a boot event started at @start
+ * @type:	Kind of event
+ * @name:	Initcall function or driver name, may be NULL
+ * @node:	DT node name for a probe, may be NULL
+ * @start:	Value returned by boot_prof_start() when the event started
+ * @res:	Result of the event
+ * @deferrals:	Number of times a probe was deferred so far
+ *
+ * Events past CFG_CORE_BOOT_PROFILE_ENTRIES are only counted as dropped.
+ */
+void boot_prof_record(enum boot_prof_type type, const char *name,
+		      const char *node, uint64_t start, TEE_Result res,
+		      unsigned int deferrals);
+
+/* Print recorded boot events not yet printed */
+void boot_prof_dump(void);
+
+/*
+ * boot_prof_get_entries() - Copy recorded events as an array of struct
+ * pta_stats_boot_prof
+ * @buf:	Output buffer, may be NULL to query the size
+ * @size:	[in] size of @buf, [out] size needed for all events
+ *
+ * Returns TEE_ERROR_SHORT_BUFFER with @size updated if @buf is too small.
+ */
+TEE_Result boot_prof_get_entries(void *buf, size_t *size);
+
+/* Returns the number of events not recorded for lack of room */
+unsigned int boot_prof_get_dropped(void);
+#else
+static inline uint64_t boot_prof_start(void)
+{
+	return 0;
+}
+
+static inline void boot_prof_record(enum boot_prof_type type __unused,
+				    const char *name __unused,
+				    const char *node __unused,
+				    uint64_t start __unused,
+				    TEE_Result res __unused,
+				    unsigned int deferrals __unused)
+{
+}
+
+static inline void boot_prof_dump(void)
+{
+}
+
+static inline TEE_Result boot_prof_get_entries(void *buf __unused,
+					       size_t *size __unused)
+{
+	return TEE_ERROR_NOT_SUPPORTED;
+}
+
+static inline unsigned int boot_prof_get_dropped(void)
+{
+	return 0;
+}
+#endif /*CFG_CORE_BOOT_PROFILE*/
+
+#endif /*__KERNEL_BOOT_PROF_H*/
@@ -9,6 +9,7 @@
 #define __KERNEL_DT_DRIVER_H
 
 #include <kernel/dt.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <sys/queue.h>
 #include <tee_api_types.h>
@@ -65,6 +66,11 @@ typedef TEE_Result (*dt_driver_probe_func)(const void *fdt, int nodeoffset,
  * @match_table: Compatible matching identifiers, null terminated
  * @driver: Driver private reference or NULL
  * @probe: Probe callback (see dt_driver_probe_func) or NULL
+ * @async_probe: With CFG_DT_DRIVER_ASYNC_PROBE, probe is not run in the
+ *	probe sequence but once the other driver initcalls are done. Only for
+ *	drivers providing no device to other drivers and whose device is not
+ *	used by driver initcalls. Failing to probe, deferral included, is
+ *	fatal.
  */
 struct dt_driver {
 	const char *name;
@@ -72,6 +78,7 @@ struct dt_driver {
 	const struct dt_device_match *match_table; /* null-terminated */
 	const void *driver;
 	TEE_Result (*probe)(const void *fdt, int node, const void *compat_data);
+	bool async_probe;
 };
 
 #define DEFINE_DT_DRIVER(name) \
@@ -263,6 +270,23 @@ TEE_Result dt_driver_probe_device_by_node(const void *fdt, int nodeoffset,
 int fdt_get_dt_driver_cells(const void *fdt, int nodeoffset,
 			    enum dt_driver_type type);
 
+/*
+ * dt_driver_next_compatible() - Find the next driver matching a compatible
+ *
+ * @compat: Compatible string to match
+ * @prev: Driver returned by the previous call or NULL to get the first one
+ * @match: Output match table entry of the returned driver or NULL
+ *
+ * Drivers are returned in registration order. Lookups use an index of the
+ * compatible strings of all registered drivers until boot resources are
+ * released.
+ *
+ * Return a matching driver or NULL if there are no more
+ */
+const struct dt_driver *
+dt_driver_next_compatible(const char *compat, const struct dt_driver *prev,
+			  const struct dt_device_match **match);
+
 /*
  * Called by bus like nodes to propose a node for dt_driver probing
  *
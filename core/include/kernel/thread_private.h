@@ -94,5 +94,27 @@ void thread_unlock_global(void);
 
 /* Frees the cache of allocated FS RPC memory */
 void thread_rpc_shm_cache_clear(struct thread_shm_cache *cache);
+
+/*
+ * Allocates and frees payload memory with an RPC each, provided by the
+ * ABI. thread_rpc_alloc_payload() uses them for what the RPC payload
+ * arena can't serve.
+ */
+struct mobj *thread_rpc_alloc_appl_payload(size_t size);
+void thread_rpc_free_appl_payload(struct mobj *mobj);
+
+/*
+ * Returns the offset of @mobj in the RPC payload arena buffer, or 0 if
+ * @mobj isn't from the arena. Memory references in RPCs are relative to
+ * the buffer since that's what normal world knows.
+ */
+size_t thread_rpc_arena_offs(struct mobj *mobj);
+
+/*
+ * Checks the result @res of an RPC with parameters @params, retires the
+ * RPC payload arena if the RPC failed to use memory from it.
+ */
+void thread_rpc_arena_check_res(size_t num_params,
+				struct thread_param *params, uint32_t res);
 #endif /*__ASSEMBLER__*/
 #endif /*__KERNEL_THREAD_PRIVATE_H*/
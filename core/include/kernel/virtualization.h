@@ -17,6 +17,32 @@
 
 struct guest_partition;
 
+/**
+ * struct virt_thread_stats - thread usage of a guest
+ * @active:		threads currently allocated to the guest
+ * @max_threads:	threads the guest may have allocated at the same time
+ * @peak:		highest value of @active
+ * @admitted:		threads allocated to the guest
+ * @over_quota:		calls refused since the guest had @max_threads
+ * @no_thread:		calls refused since all threads were in use
+ * @busy_us:		time threads were held by the guest in microseconds
+ * @max_busy_us:	longest time a thread was held by the guest
+ *
+ * All but @active and @max_threads count since statistics were last read.
+ * A thread is held from the start of a call until the call returns,
+ * including the time spent in RPCs to normal world.
+ */
+struct virt_thread_stats {
+	unsigned int active;
+	unsigned int max_threads;
+	unsigned int peak;
+	uint32_t admitted;
+	uint32_t over_quota;
+	uint32_t no_thread;
+	uint64_t busy_us;
+	uint64_t max_busy_us;
+};
+
 #if defined(CFG_NS_VIRTUALIZATION)
 /**
  * virt_guest_created() - create new VM partition
@@ -67,6 +93,45 @@ void virt_unset_guest(void);
  */
 void virt_on_stdcall(void);
 
+/**
+ * virt_guest_max_threads() - thread quota of a guest
+ * @guest_id: VM id provided by hypervisor
+ *
+ * Returns the number of threads the guest may have allocated at the same
+ * time. Called once when the guest is created. The default returns
+ * CFG_VIRT_GUEST_MAX_THREADS, or CFG_NUM_THREADS if that is 0. Platforms
+ * may override it to weight guests with different quotas.
+ */
+unsigned int virt_guest_max_threads(uint16_t guest_id);
+
+/**
+ * virt_thread_admit() - account a thread allocation to the current guest
+ * @thread_id: free thread found for the call or THREAD_ID_INVALID
+ *
+ * Called with the thread global lock held when a call from the current
+ * guest is about to be allocated thread @thread_id. Returns false if the
+ * guest already uses its quota of threads or if @thread_id is
+ * THREAD_ID_INVALID, the call is then refused. Calls not made on behalf
+ * of a guest are always admitted.
+ */
+bool virt_thread_admit(short int thread_id);
+
+/**
+ * virt_thread_release() - account the freeing of a thread
+ * @thread_id: thread previously admitted with virt_thread_admit()
+ *
+ * Called with the thread global lock held.
+ */
+void virt_thread_release(short int thread_id);
+
+/**
+ * virt_get_thread_stats() - get thread usage of the current guest
+ * @stats: returned statistics
+ *
+ * Counters in @stats are reset once read.
+ */
+TEE_Result virt_get_thread_stats(struct virt_thread_stats *stats);
+
 /*
  * Next function are needed because virtualization subsystem manages
  * memory in own way. There is no one static memory map, instead
@@ -193,6 +258,16 @@ static inline TEE_Result virt_set_guest(uint16_t guest_id __unused)
 
 static inline void virt_unset_guest(void) { }
 static inline void virt_on_stdcall(void) { }
+static inline bool virt_thread_admit(short int thread_id)
+{
+	return thread_id >= 0;
+}
+static inline void virt_thread_release(short int thread_id __unused) { }
+static inline TEE_Result
+virt_get_thread_stats(struct virt_thread_stats *stats __unused)
+{
+	return TEE_ERROR_NOT_SUPPORTED;
+}
 static inline struct memory_map *virt_get_memory_map(void) { return NULL; }
 static inline void virt_init_memory(struct memory_map *mem_map __unused,
 				    paddr_t secmem0_base __unused,
@@ -18,6 +18,9 @@
  * @ops:	Operations pointer
  * @num_pages:	Number of pages covered
  * @refc:	Reference counter
+ * @regions:	Paged regions mapping this fobj
+ * @pmems:	Physical pages holding pages of this fobj, managed by the
+ *		pager
  */
 struct fobj {
 	const struct fobj_ops *ops;
@@ -25,6 +28,7 @@ struct fobj {
 	struct refcount refc;
 #ifdef CFG_WITH_PAGER
 	struct vm_paged_region_head regions;
+	struct tee_pager_pmem_head pmems;
 #endif
 };
 
@@ -42,6 +46,8 @@ struct fobj_ops {
 #ifdef CFG_WITH_PAGER
 	TEE_Result (*load_page)(struct fobj *fobj, unsigned int page_idx,
 				void *va);
+	TEE_Result (*load_pages)(struct fobj *fobj, unsigned int page_idx,
+				 void * const *va, size_t num_pages);
 	TEE_Result (*save_page)(struct fobj *fobj, unsigned int page_idx,
 				const void *va);
 	vaddr_t (*get_iv_vaddr)(struct fobj *fobj, unsigned int page_idx);
@@ -49,6 +55,49 @@ struct fobj_ops {
 	paddr_t (*get_pa)(struct fobj *fobj, unsigned int page_idx);
 };
 
+/*
+ * struct fobj_comp_stats - Statistics of the compressed read/write store
+ * @store_size:		Size of the compressed store in bytes
+ * @store_used:		Bytes of the compressed store in use
+ * @stored_pages:	Number of pages held in the compressed store
+ * @saves:		Pages saved since last call
+ * @loads:		Pages loaded since last call
+ * @zero_saves:		Zero filled pages saved without storage since
+ *			last call
+ * @raw_saves:		Incompressible pages saved since last call
+ * @store_full:		Saves failed due to a full store since last call
+ * @save_time:		Time in microseconds spent saving pages since last
+ *			call
+ * @load_time:		Time in microseconds spent loading pages since last
+ *			call
+ */
+struct fobj_comp_stats {
+	size_t store_size;
+	size_t store_used;
+	size_t stored_pages;
+	size_t saves;
+	size_t loads;
+	size_t zero_saves;
+	size_t raw_saves;
+	size_t store_full;
+	uint64_t save_time;
+	uint64_t load_time;
+};
+
+#ifdef CFG_CORE_PAGER_RWP_COMPRESS
+/*
+ * fobj_get_comp_stats() - Get and reset statistics of the compressed store
+ * used by fobj_rw_paged_alloc() objects
+ * @stats:	Output statistics
+ */
+void fobj_get_comp_stats(struct fobj_comp_stats *stats);
+#else
+static inline void fobj_get_comp_stats(struct fobj_comp_stats *stats)
+{
+	*stats = (struct fobj_comp_stats){ };
+}
+#endif
+
 #ifdef CFG_WITH_PAGER
 /*
  * fobj_locked_paged_alloc() - Allocate storage which is locked in memory
@@ -66,7 +115,9 @@ struct fobj *fobj_locked_paged_alloc(unsigned int num_pages);
  * @num_pages:	Number of pages covered
  *
  * This object supports both load and saving of pages. Pages are zero
- * initialized the first time they are loaded.
+ * initialized the first time they are loaded. With
+ * CFG_CORE_PAGER_RWP_COMPRESS saving a page may fail with
+ * TEE_ERROR_OUT_OF_MEMORY when the compressed store is full.
  *
  * Returns a valid pointer on success or NULL on failure.
  */
@@ -125,6 +176,38 @@ static inline TEE_Result fobj_load_page(struct fobj *fobj,
 	return TEE_ERROR_GENERIC;
 }
 
+/*
+ * fobj_load_pages() - Load consecutive pages into memory
+ * @fobj:	Fobj pointer
+ * @page_index:	Index of the first page in @fobj
+ * @va:		Addresses where content of each page should be stored and
+ *		verified
+ * @num_pages:	Number of pages to load
+ *
+ * Returns TEE_SUCCESS on success or TEE_ERROR_* on failure.
+ */
+static inline TEE_Result fobj_load_pages(struct fobj *fobj,
+					 unsigned int page_idx,
+					 void * const *va, size_t num_pages)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	if (!fobj)
+		return TEE_ERROR_GENERIC;
+
+	if (fobj->ops->load_pages)
+		return fobj->ops->load_pages(fobj, page_idx, va, num_pages);
+
+	for (n = 0; n < num_pages; n++) {
+		res = fobj->ops->load_page(fobj, page_idx + n, va[n]);
+		if (res)
+			return res;
+	}
+
+	return TEE_SUCCESS;
+}
+
 /*
  * fobj_save_page() - Save a page into storage
  * @fobj:	Fobj pointer
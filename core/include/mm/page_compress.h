@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#ifndef __MM_PAGE_COMPRESS_H
+#define __MM_PAGE_COMPRESS_H
+
+#include <tee_api_types.h>
+#include <types_ext.h>
+#include <util.h>
+
+#define PAGE_COMPRESS_HASH_BITS	10
+
+/*
+ * struct page_compress_ctx - Working area of page_compress()
+ * @hash_table:	Offsets in the page indexed by hash of the bytes found there
+ */
+struct page_compress_ctx {
+	uint16_t hash_table[BIT(PAGE_COMPRESS_HASH_BITS)];
+};
+
+/*
+ * page_compress() - Compress a page
+ * @ctx:	Working area, only used for the duration of the call
+ * @src:	Page to compress
+ * @dst:	Output buffer
+ * @dst_size:	Size of the output buffer
+ *
+ * The output uses the LZ4 block format. Concurrent calls must use
+ * different @ctx.
+ *
+ * Returns the size of the compressed data or 0 if it doesn't fit in
+ * @dst_size bytes.
+ */
+size_t page_compress(struct page_compress_ctx *ctx, const void *src,
+		     void *dst, size_t dst_size);
+
+/*
+ * page_decompress() - Decompress a page
+ * @src:	Data compressed with page_compress()
+ * @src_size:	Size of the compressed data
+ * @dst:	Output page
+ *
+ * Returns TEE_SUCCESS if exactly one page was decompressed or
+ * TEE_ERROR_CORRUPT_OBJECT if @src is malformed.
+ */
+TEE_Result page_decompress(const void *src, size_t src_size, void *dst);
+
+#endif /*__MM_PAGE_COMPRESS_H*/
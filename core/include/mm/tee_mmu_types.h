@@ -7,6 +7,7 @@
 #ifndef __MM_TEE_MMU_TYPES_H
 #define __MM_TEE_MMU_TYPES_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <sys/queue.h>
 #include <util.h>
@@ -125,11 +126,27 @@ struct vm_paged_region {
 };
 
 TAILQ_HEAD(vm_paged_region_head, vm_paged_region);
+TAILQ_HEAD(tee_pager_pmem_head, tee_pager_pmem);
 TAILQ_HEAD(vm_region_head, vm_region);
 
+/*
+ * struct vm_info - virtual memory map of a user mode context
+ * @regions:		Mapped regions, sorted on virtual address
+ * @asid:		ASID allocated for the lifetime of the context
+ * @tlbi_pending:	Translation tables have been changed or released
+ *			since the context was last mapped
+ * @last_user_map:	User map last installed with @asid
+ *
+ * @tlbi_pending and @last_user_map are used by CFG_CORE_LAZY_USER_TLBI
+ * to tell if TLB entries tagged with @asid may be stale.
+ */
 struct vm_info {
 	struct vm_region_head regions;
 	unsigned int asid;
+#if defined(CFG_CORE_LAZY_USER_TLBI)
+	bool tlbi_pending;
+	uint64_t last_user_map;
+#endif
 };
 
 static inline void mattr_perm_to_str(char *str, size_t size, uint32_t attr)
@@ -256,6 +256,10 @@ static inline void tee_pager_release_phys(void *addr __unused,
 /*
  * Statistics on the pager
  */
+/* Page replacement policies, selected with CFG_CORE_PAGER_POLICY_* */
+#define TEE_PAGER_POLICY_FIFO	0
+#define TEE_PAGER_POLICY_CLOCK	1
+
 struct tee_pager_stats {
 	size_t hidden_hits;
 	size_t ro_hits;
@@ -263,6 +267,13 @@ struct tee_pager_stats {
 	size_t zi_released;
 	size_t npages;		/* number of load pages */
 	size_t npages_all;	/* number of pages */
+	unsigned int policy;	/* TEE_PAGER_POLICY_* */
+	size_t faults;		/* number of faults */
+	size_t evictions;	/* number of loaded pages evicted */
+	size_t second_chances;	/* referenced pages spared by the policy */
+	size_t hides;		/* number of pages hidden */
+	size_t readahead;	/* number of pages loaded by fault-around */
+	size_t readahead_unused; /* pages loaded ahead evicted unused */
 };
 
 #ifdef CFG_WITH_PAGER
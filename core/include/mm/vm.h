@@ -95,6 +95,20 @@ TEE_Result vm_check_access_rights(const struct user_mode_ctx *uctx,
 /* Set user context @ctx or core privileged context if @ctx is NULL */
 void vm_set_ctx(struct ts_ctx *ctx);
 
+/*
+ * Records that the translation tables of @uctx have changed in a way that
+ * requires the TLB entries tagged with its ASID to be invalidated the next
+ * time it's mapped. Only needed with CFG_CORE_LAZY_USER_TLBI, otherwise
+ * the entire TLB is invalidated on each switch.
+ */
+static inline void
+vm_set_tlbi_pending(struct user_mode_ctx *uctx __maybe_unused)
+{
+#if defined(CFG_CORE_LAZY_USER_TLBI)
+	uctx->vm_info.tlbi_pending = true;
+#endif
+}
+
 struct mobj *vm_get_mobj(struct user_mode_ctx *uctx, vaddr_t va, size_t *len,
 			 uint16_t *prot, size_t *offs);
 #endif /*__MM_VM_H*/
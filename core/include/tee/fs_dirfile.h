@@ -59,6 +59,30 @@ struct tee_fs_dirfile_operations {
 TEE_Result tee_fs_dirfile_open(bool create, uint8_t *hash, uint32_t min_counter,
 			       const struct tee_fs_dirfile_operations *fops,
 			       struct tee_fs_dirfile_dirh **dirh);
+
+/**
+ * tee_fs_dirfile_open_numbered() - opens a dirfile handle allocating file
+ * numbers from a range
+ * @create:	true if a new dirfile is to be created, else the dirfile
+ *		is read opened and verified
+ * @hash:	hash of underlying file
+ * @min_counter: the smallest accepted value in struct htree_image.counter
+ * @dfh:	file handle of the underlying file, NULL for "dirf.db"
+ * @first_number: first file number returned by tee_fs_dirfile_get_tmp()
+ * @num_numbers: number of file numbers available to
+ *		tee_fs_dirfile_get_tmp()
+ * @fops:	file interface
+ * @dirh:	returned dirfile handle
+ *
+ * Entries may refer to file numbers outside the range, those are left
+ * alone when allocating file numbers.
+ */
+TEE_Result
+tee_fs_dirfile_open_numbered(bool create, uint8_t *hash, uint32_t min_counter,
+			     struct tee_fs_dirfile_fileh *dfh,
+			     uint32_t first_number, uint32_t num_numbers,
+			     const struct tee_fs_dirfile_operations *fops,
+			     struct tee_fs_dirfile_dirh **dirh);
 /**
  * tee_fs_dirfile_close() - closes a dirfile handle
  * @dirh:	dirfile handle
@@ -155,4 +179,50 @@ TEE_Result tee_fs_dirfile_get_next(struct tee_fs_dirfile_dirh *dirh,
 				   const TEE_UUID *uuid, int *idx, void *oid,
 				   size_t *oidlen);
 
+/**
+ * tee_fs_dirfile_get_next_any() - get next file of any TA
+ * @dirh:	dirfile handle
+ * @idx:	pointer to index
+ * @uuid:	returned uuid of the TA owning the file
+ * @oid:	object id
+ * @oidlen:	length of object id
+ * @dfh:	returned file handle
+ *
+ * If @idx contains -1 the first file is returned, *@idx is updated with
+ * the index of the file.
+ */
+TEE_Result tee_fs_dirfile_get_next_any(struct tee_fs_dirfile_dirh *dirh,
+				       int *idx, TEE_UUID *uuid, void *oid,
+				       size_t *oidlen,
+				       struct tee_fs_dirfile_fileh *dfh);
+
+/**
+ * tee_fs_dirfile_copy_entries() - copy entries to another dirfile
+ * @src:	dirfile handle the entries are copied from
+ * @dst:	dirfile handle the entries are copied to
+ * @select:	returns true for the UUIDs of the entries to copy
+ * @arg:	argument passed to @select
+ * @count:	incremented for each entry copied
+ *
+ * Copied entries keep their file number and hash, the files are shared
+ * until the entries are removed from @src with
+ * tee_fs_dirfile_remove_entries(). An entry already in @dst is replaced.
+ */
+TEE_Result tee_fs_dirfile_copy_entries(struct tee_fs_dirfile_dirh *src,
+				       struct tee_fs_dirfile_dirh *dst,
+				       bool (*select)(const TEE_UUID *uuid,
+						      void *arg),
+				       void *arg, size_t *count);
+
+/**
+ * tee_fs_dirfile_remove_entries() - remove entries without their files
+ * @dirh:	dirfile handle
+ * @select:	returns true for the UUIDs of the entries to remove
+ * @arg:	argument passed to @select
+ */
+TEE_Result tee_fs_dirfile_remove_entries(struct tee_fs_dirfile_dirh *dirh,
+					 bool (*select)(const TEE_UUID *uuid,
+							void *arg),
+					 void *arg);
+
 #endif /*__TEE_FS_DIRFILE_H*/
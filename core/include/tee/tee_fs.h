@@ -48,6 +48,13 @@ struct tee_file_operations {
 			     bool overwrite);
 	TEE_Result (*remove)(struct tee_pobj *po);
 	TEE_Result (*truncate)(struct tee_file_handle *fh, size_t size);
+	/*
+	 * Optional, once begin_writes() is called write() and truncate()
+	 * aren't committed to storage until commit_writes() is called.
+	 * Changes not committed when the file is closed are discarded.
+	 */
+	TEE_Result (*begin_writes)(struct tee_file_handle *fh);
+	TEE_Result (*commit_writes)(struct tee_file_handle *fh);
 
 	TEE_Result (*opendir)(const TEE_UUID *uuid, struct tee_fs_dir **d);
 	TEE_Result (*readdir)(struct tee_fs_dir *d, struct tee_fs_dirent **ent);
@@ -59,6 +59,9 @@ TEE_Result syscall_storage_obj_trunc(unsigned long obj, size_t len);
 TEE_Result syscall_storage_obj_seek(unsigned long obj, int32_t offset,
 				    unsigned long whence);
 
+TEE_Result syscall_storage_obj_transaction(unsigned long obj,
+					   unsigned long op);
+
 void tee_svc_storage_close_all_enum(struct user_ta_ctx *utc);
 TEE_Result tee_svc_storage_write_usage(struct tee_obj *o, uint32_t usage);
 
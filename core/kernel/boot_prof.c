@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <assert.h>
+#include <compiler.h>
+#include <config.h>
+#include <inttypes.h>
+#include <kernel/boot_prof.h>
+#include <kernel/delay.h>
+#include <kernel/spinlock.h>
+#include <pta_stats.h>
+#include <string.h>
+#include <string_ext.h>
+#include <trace.h>
+#include <util.h>
+
+static_assert(BOOT_PROF_PREINITCALL == STATS_BOOT_PROF_PREINITCALL);
+static_assert(BOOT_PROF_EARLY_INITCALL == STATS_BOOT_PROF_EARLY_INITCALL);
+static_assert(BOOT_PROF_SERVICE_INITCALL ==
+	      STATS_BOOT_PROF_SERVICE_INITCALL);
+static_assert(BOOT_PROF_DRIVER_INITCALL == STATS_BOOT_PROF_DRIVER_INITCALL);
+static_assert(BOOT_PROF_FINALCALL == STATS_BOOT_PROF_FINALCALL);
+static_assert(BOOT_PROF_DT_PROBE == STATS_BOOT_PROF_DT_PROBE);
+static_assert(BOOT_PROF_DT_REPROBE == STATS_BOOT_PROF_DT_REPROBE);
+
+/*
+ * Events are kept in nexus memory since, with virtualization, partitions
+ * run their initcalls and probes after the nexus boot final calls.
+ */
+static struct pta_stats_boot_prof
+	boot_prof_entries[CFG_CORE_BOOT_PROFILE_ENTRIES] __nex_bss;
+static size_t boot_prof_count __nex_bss;
+static size_t boot_prof_dumped __nex_bss;
+static unsigned int boot_prof_dropped __nex_bss;
+static unsigned int boot_prof_lock __nex_data = SPINLOCK_UNLOCK;
+
+static const char * const boot_prof_type_name[] __maybe_unused = {
+	[BOOT_PROF_PREINITCALL] = "preinit",
+	[BOOT_PROF_EARLY_INITCALL] = "early",
+	[BOOT_PROF_SERVICE_INITCALL] = "service",
+	[BOOT_PROF_DRIVER_INITCALL] = "driver",
+	[BOOT_PROF_FINALCALL] = "final",
+	[BOOT_PROF_DT_PROBE] = "probe",
+	[BOOT_PROF_DT_REPROBE] = "reprobe",
+};
+
+static uint64_t boot_prof_to_us(uint64_t cnt)
+{
+#ifdef CFG_CORE_HAS_GENERIC_TIMER
+	if (delay_cnt_freq())
+		return cnt * 1000000 / delay_cnt_freq();
+#endif
+	return cnt;
+}
+
+uint64_t boot_prof_start(void)
+{
+#ifdef CFG_CORE_HAS_GENERIC_TIMER
+	return delay_cnt_read();
+#else
+	return 0;
+#endif
+}
+
+void boot_prof_record(enum boot_prof_type type, const char *name,
+		      const char *node, uint64_t start, TEE_Result res,
+		      unsigned int deferrals)
+{
+	uint64_t duration = boot_prof_start() - start;
+	struct pta_stats_boot_prof *e = NULL;
+	uint32_t exceptions = 0;
+
+	exceptions = cpu_spin_lock_xsave(&boot_prof_lock);
+
+	if (boot_prof_count == ARRAY_SIZE(boot_prof_entries)) {
+		boot_prof_dropped++;
+		goto out;
+	}
+
+	e = boot_prof_entries + boot_prof_count;
+	e->start_us = boot_prof_to_us(start);
+	e->duration_us = MIN(boot_prof_to_us(duration), (uint64_t)UINT32_MAX);
+	e->type = type;
+	e->result = res;
+	e->deferrals = deferrals;
+	if (name)
+		strlcpy(e->name, name, sizeof(e->name));
+	if (node)
+		strlcpy(e->node, node, sizeof(e->node));
+	boot_prof_count++;
+
+out:
+	cpu_spin_unlock_xrestore(&boot_prof_lock, exceptions);
+}
+
+void boot_prof_dump(void)
+{
+	struct pta_stats_boot_prof __maybe_unused *e = NULL;
+	size_t count = 0;
+	size_t n = 0;
+
+	count = boot_prof_count;
+	if (boot_prof_dumped >= count)
+		return;
+
+	IMSG("Boot profile: %zu events, %u dropped", count - boot_prof_dumped,
+	     boot_prof_dropped);
+	IMSG("%-8s %12s %10s %-4s %s", "type", "start(us)", "time(us)",
+	     "defr", "name [node] result");
+
+	for (n = boot_prof_dumped; n < count; n++) {
+		e = boot_prof_entries + n;
+		IMSG("%-8s %12"PRIu64" %10"PRIu32" %4"PRIu32" %s%s%s%s %#"PRIx32,
+		     boot_prof_type_name[e->type], e->start_us,
+		     e->duration_us, e->deferrals, e->name,
+		     e->node[0] ? " [" : "", e->node, e->node[0] ? "]" : "",
+		     e->result);
+	}
+
+	boot_prof_dumped = count;
+}
+
+TEE_Result boot_prof_get_entries(void *buf, size_t *size)
+{
+	uint32_t exceptions = 0;
+	size_t sz = 0;
+
+	exceptions = cpu_spin_lock_xsave(&boot_prof_lock);
+	sz = boot_prof_count * sizeof(struct pta_stats_boot_prof);
+	cpu_spin_unlock_xrestore(&boot_prof_lock, exceptions);
+
+	if (!buf || *size < sz) {
+		*size = sz;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	/* Entries are complete and never modified once counted in */
+	memcpy(buf, boot_prof_entries, sz);
+	*size = sz;
+
+	return TEE_SUCCESS;
+}
+
+unsigned int boot_prof_get_dropped(void)
+{
+	return boot_prof_dropped;
+}
@@ -14,8 +14,10 @@
 #include <mm/core_mmu.h>
 #include <mm/phys_mem.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <trace.h>
+#include <util.h>
 
 static struct dt_descriptor external_dt __nex_bss;
 
@@ -26,22 +28,26 @@ static size_t manifest_max_size __nex_bss;
 
 const struct dt_driver *dt_find_compatible_driver(const void *fdt, int offs)
 {
-	const struct dt_device_match *dm;
-	const struct dt_driver *drv;
-
-	for_each_dt_driver(drv) {
-		for (dm = drv->match_table; dm; dm++) {
-			if (!dm->compatible) {
-				break;
-			}
-			if (!fdt_node_check_compatible(fdt, offs,
-						       dm->compatible)) {
-				return drv;
-			}
-		}
+	const struct dt_driver *found = NULL;
+	const struct dt_driver *drv = NULL;
+	const char *compat = NULL;
+	int count = 0;
+	int idx = 0;
+
+	count = fdt_stringlist_count(fdt, offs, "compatible");
+
+	/* First registered driver matching any of the node compatibles */
+	for (idx = 0; idx < count; idx++) {
+		compat = fdt_stringlist_get(fdt, offs, "compatible", idx, NULL);
+		if (!compat)
+			break;
+
+		drv = dt_driver_next_compatible(compat, NULL, NULL);
+		if (drv && (!found || drv < found))
+			found = drv;
 	}
 
-	return NULL;
+	return found;
 }
 
 bool dt_have_prop(const void *fdt, int offs, const char *propname)
@@ -478,15 +484,19 @@ struct cached_node {
 /*
  * struct dt_node_cache - Reference to cached information of DT nodes
  *
- * @array: Array of the cached node
+ * @array: Array of the cached node, sorted by node offset
  * @count: Number of initialized cells in @array
  * @alloced_count: Number of allocated cells in @array
+ * @phandle_index: Cells of @array with a phandle, sorted by phandle
+ * @phandle_count: Number of cells in @phandle_index
  * @fdt: Reference to the FDT for which node information are cached
  */
 struct dt_node_cache {
 	struct cached_node *array;
 	size_t count;
 	size_t alloced_count;
+	struct cached_node **phandle_index;
+	size_t phandle_count;
 	const void *fdt;
 };
 
@@ -501,16 +511,29 @@ static struct cached_node *find_cached_parent_node(const void *fdt,
 						   int node_offset)
 {
 	struct cached_node *cell = NULL;
+	size_t first = 0;
+	size_t last = 0;
 	size_t n = 0;
 
 	if (!fdt_node_info_are_cached(fdt))
 		return NULL;
 
-	for (n = 0; n < dt_node_cache->count; n++)
-		if (dt_node_cache->array[n].node_offset == node_offset)
-			cell = dt_node_cache->array + n;
+	/* Nodes are cached in structure order hence by increasing offset */
+	last = dt_node_cache->count;
+	while (first < last) {
+		n = first + (last - first) / 2;
+		cell = dt_node_cache->array + n;
 
-	return cell;
+		if (cell->node_offset == node_offset)
+			return cell;
+
+		if (cell->node_offset < node_offset)
+			first = n + 1;
+		else
+			last = n;
+	}
+
+	return NULL;
 }
 
 int fdt_find_cached_parent_node(const void *fdt, int node_offset,
@@ -558,21 +581,30 @@ int fdt_find_cached_node_phandle(const void *fdt, uint32_t phandle,
 				 int *node_offset)
 {
 	struct cached_node *cell = NULL;
+	size_t first = 0;
+	size_t last = 0;
 	size_t n = 0;
 
 	if (!fdt_node_info_are_cached(fdt))
 		return -FDT_ERR_NOTFOUND;
 
-	for (n = 0; n < dt_node_cache->count; n++)
-		if (dt_node_cache->array[n].phandle == phandle)
-			cell = dt_node_cache->array + n;
+	last = dt_node_cache->phandle_count;
+	while (first < last) {
+		n = first + (last - first) / 2;
+		cell = dt_node_cache->phandle_index[n];
 
-	if (!cell)
-		return -FDT_ERR_NOTFOUND;
+		if (cell->phandle == phandle) {
+			*node_offset = cell->node_offset;
+			return 0;
+		}
 
-	*node_offset = cell->node_offset;
+		if (cell->phandle < phandle)
+			first = n + 1;
+		else
+			last = n;
+	}
 
-	return 0;
+	return -FDT_ERR_NOTFOUND;
 }
 
 static TEE_Result realloc_cached_node_array(void)
@@ -608,6 +640,11 @@ static TEE_Result add_cached_node(int parent_offset,
 	if (res)
 		return res;
 
+	/* Lookups by offset rely on nodes being added in structure order */
+	assert(!dt_node_cache->count ||
+	       dt_node_cache->array[dt_node_cache->count - 1].node_offset <
+	       node_offset);
+
 	dt_node_cache->array[dt_node_cache->count] = (struct cached_node){
 		.node_offset = node_offset,
 		.parent_offset = parent_offset,
@@ -653,9 +690,48 @@ static TEE_Result add_cached_node_subtree(int node_offset)
 	return TEE_SUCCESS;
 }
 
+static int cmp_cached_node_phandle(const void *a, const void *b)
+{
+	const struct cached_node *cell_a = *(struct cached_node * const *)a;
+	const struct cached_node *cell_b = *(struct cached_node * const *)b;
+
+	return CMP_TRILEAN(cell_a->phandle, cell_b->phandle);
+}
+
+static TEE_Result init_phandle_index(void)
+{
+	struct cached_node **index = NULL;
+	size_t count = 0;
+	size_t n = 0;
+
+	for (n = 0; n < dt_node_cache->count; n++)
+		if (dt_node_cache->array[n].phandle)
+			count++;
+
+	if (!count)
+		return TEE_SUCCESS;
+
+	index = calloc(count, sizeof(*index));
+	if (!index)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	count = 0;
+	for (n = 0; n < dt_node_cache->count; n++)
+		if (dt_node_cache->array[n].phandle)
+			index[count++] = dt_node_cache->array + n;
+
+	qsort(index, count, sizeof(*index), cmp_cached_node_phandle);
+
+	dt_node_cache->phandle_index = index;
+	dt_node_cache->phandle_count = count;
+
+	return TEE_SUCCESS;
+}
+
 static TEE_Result release_node_cache_info(void)
 {
 	if (dt_node_cache) {
+		free(dt_node_cache->phandle_index);
 		free(dt_node_cache->array);
 		free(dt_node_cache);
 		dt_node_cache = NULL;
@@ -676,6 +752,8 @@ static void init_node_cache_info(const void *fdt)
 	if (dt_node_cache) {
 		dt_node_cache->fdt = fdt;
 		res = add_cached_node_subtree(0);
+		if (!res)
+			res = init_phandle_index();
 	} else {
 		res = TEE_ERROR_OUT_OF_MEMORY;
 	}
@@ -10,13 +10,18 @@
 #include <config.h>
 #include <initcall.h>
 #include <kernel/boot.h>
+#include <kernel/boot_prof.h>
 #include <kernel/dt.h>
 #include <kernel/dt_driver.h>
+#include <kernel/panic.h>
 #include <libfdt.h>
 #include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/queue.h>
 #include <tee_api_defines_extensions.h>
 #include <tee_api_types.h>
+#include <util.h>
 
 /*
  * struct dt_driver_probe - Node instance in secure FDT to probe a driver for
@@ -488,6 +493,8 @@ static TEE_Result probe_driver_node(const void *fdt,
 	TEE_Result res = TEE_ERROR_GENERIC;
 	const char __maybe_unused *drv_name = NULL;
 	const char __maybe_unused *node_name = NULL;
+	enum boot_prof_type prof_type = BOOT_PROF_DT_PROBE;
+	uint64_t start = 0;
 
 	node_name = fdt_get_name(fdt, elt->nodeoffset, NULL);
 	drv_name = elt->dt_drv->name;
@@ -499,6 +506,11 @@ static TEE_Result probe_driver_node(const void *fdt,
 
 	FMSG("Probing %s on node %s", drv_name, node_name);
 
+	if (elt->deferrals)
+		prof_type = BOOT_PROF_DT_REPROBE;
+
+	if (IS_ENABLED(CFG_CORE_BOOT_PROFILE))
+		start = boot_prof_start();
 	res = elt->dt_drv->probe(fdt, elt->nodeoffset, elt->dm->compat_data);
 	switch (res) {
 	case TEE_SUCCESS:
@@ -524,6 +536,10 @@ static TEE_Result probe_driver_node(const void *fdt,
 		break;
 	}
 
+	if (IS_ENABLED(CFG_CORE_BOOT_PROFILE))
+		boot_prof_record(prof_type, drv_name, node_name, start, res,
+				 elt->deferrals);
+
 	return res;
 }
 
@@ -546,23 +562,195 @@ static TEE_Result alloc_elt_and_probe(const void *fdt, int node,
 	return probe_driver_node(fdt, elt);
 }
 
-/* Lookup a compatible driver, possibly of a specific @type, for the FDT node */
-static TEE_Result probe_device_by_compat(const void *fdt, int node,
-					 const char *compat,
-					 enum dt_driver_type type)
+/*
+ * struct dt_compat_ref - Compatible string of a registered DT driver
+ *
+ * @hash: Hash of @dm->compatible
+ * @dt_drv: Driver
+ * @dm: Entry of @dt_drv match table
+ */
+struct dt_compat_ref {
+	uint32_t hash;
+	const struct dt_driver *dt_drv;
+	const struct dt_device_match *dm;
+};
+
+/*
+ * Compatible strings of all DT drivers sorted by hash, then by string and
+ * then in driver registration order. Built on first lookup and released
+ * with other boot time resources, lookups then scan the driver section.
+ */
+static struct dt_compat_ref *dt_compat_index;
+static size_t dt_compat_index_count;
+static bool dt_compat_index_released;
+
+/* FNV-1a */
+static uint32_t compat_hash(const char *str)
 {
+	uint32_t hash = 2166136261U;
+
+	while (*str) {
+		hash ^= (uint8_t)*str++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static int cmp_compat_key(uint32_t hash, const char *compat,
+			  const struct dt_compat_ref *ref)
+{
+	if (hash != ref->hash)
+		return CMP_TRILEAN(hash, ref->hash);
+
+	return strcmp(compat, ref->dm->compatible);
+}
+
+static int cmp_compat_ref(const void *a, const void *b)
+{
+	const struct dt_compat_ref *ref_a = a;
+	const struct dt_compat_ref *ref_b = b;
+	int rc = 0;
+
+	rc = cmp_compat_key(ref_a->hash, ref_a->dm->compatible, ref_b);
+	if (rc)
+		return rc;
+
+	if (ref_a->dt_drv != ref_b->dt_drv)
+		return CMP_TRILEAN((vaddr_t)ref_a->dt_drv,
+				   (vaddr_t)ref_b->dt_drv);
+
+	return CMP_TRILEAN((vaddr_t)ref_a->dm, (vaddr_t)ref_b->dm);
+}
+
+static void init_compat_index(void)
+{
+	const struct dt_device_match *dm = NULL;
 	const struct dt_driver *drv = NULL;
+	struct dt_compat_ref *index = NULL;
+	size_t count = 0;
+
+	for_each_dt_driver(drv)
+		for (dm = drv->match_table; dm && dm->compatible; dm++)
+			count++;
+
+	if (!count)
+		return;
+
+	index = calloc(count, sizeof(*index));
+	if (!index) {
+		DMSG("No memory for DT compatible index");
+		return;
+	}
+
+	count = 0;
+	for_each_dt_driver(drv) {
+		for (dm = drv->match_table; dm && dm->compatible; dm++) {
+			index[count] = (struct dt_compat_ref){
+				.hash = compat_hash(dm->compatible),
+				.dt_drv = drv,
+				.dm = dm,
+			};
+			count++;
+		}
+	}
+
+	qsort(index, count, sizeof(*index), cmp_compat_ref);
+
+	dt_compat_index = index;
+	dt_compat_index_count = count;
+}
+
+static TEE_Result release_compat_index(void)
+{
+	free(dt_compat_index);
+	dt_compat_index = NULL;
+	dt_compat_index_count = 0;
+	dt_compat_index_released = true;
+
+	return TEE_SUCCESS;
+}
+
+release_init_resource(release_compat_index);
+
+static const struct dt_driver *
+scan_next_compatible(const char *compat, const struct dt_driver *prev,
+		     const struct dt_device_match **match)
+{
 	const struct dt_device_match *dm = NULL;
+	const struct dt_driver *drv = NULL;
 
 	for_each_dt_driver(drv) {
-		if (drv->type != type)
+		if (prev && drv <= prev)
 			continue;
 
-		for (dm = drv->match_table; dm && dm->compatible; dm++)
-			if (strcmp(dm->compatible, compat) == 0)
-				return alloc_elt_and_probe(fdt, node, drv, dm);
+		for (dm = drv->match_table; dm && dm->compatible; dm++) {
+			if (!strcmp(dm->compatible, compat)) {
+				if (match)
+					*match = dm;
+				return drv;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+const struct dt_driver *
+dt_driver_next_compatible(const char *compat, const struct dt_driver *prev,
+			  const struct dt_device_match **match)
+{
+	const struct dt_compat_ref *ref = NULL;
+	uint32_t hash = 0;
+	size_t first = 0;
+	size_t last = 0;
+	size_t n = 0;
+
+	if (!dt_compat_index && !dt_compat_index_released)
+		init_compat_index();
+
+	if (!dt_compat_index)
+		return scan_next_compatible(compat, prev, match);
+
+	/* Lower bound of the references to @compat */
+	hash = compat_hash(compat);
+	last = dt_compat_index_count;
+	while (first < last) {
+		n = first + (last - first) / 2;
+		if (cmp_compat_key(hash, compat, dt_compat_index + n) > 0)
+			first = n + 1;
+		else
+			last = n;
 	}
 
+	for (n = first; n < dt_compat_index_count; n++) {
+		ref = dt_compat_index + n;
+
+		if (cmp_compat_key(hash, compat, ref))
+			break;
+
+		if (!prev || ref->dt_drv > prev) {
+			if (match)
+				*match = ref->dm;
+			return ref->dt_drv;
+		}
+	}
+
+	return NULL;
+}
+
+/* Lookup a compatible driver, possibly of a specific @type, for the FDT node */
+static TEE_Result probe_device_by_compat(const void *fdt, int node,
+					 const char *compat,
+					 enum dt_driver_type type)
+{
+	const struct dt_driver *drv = NULL;
+	const struct dt_device_match *dm = NULL;
+
+	while ((drv = dt_driver_next_compatible(compat, drv, &dm)))
+		if (drv->type == type)
+			return alloc_elt_and_probe(fdt, node, drv, dm);
+
 	return TEE_ERROR_ITEM_NOT_FOUND;
 }
 
@@ -600,6 +788,81 @@ TEE_Result dt_driver_probe_device_by_node(const void *fdt, int nodeoffset,
 	return TEE_ERROR_ITEM_NOT_FOUND;
 }
 
+#ifdef CFG_DT_DRIVER_ASYNC_PROBE
+/*
+ * Nodes of drivers with the async_probe flag found by the probe sequence.
+ * They are probed once the other driver initcalls are done, before the
+ * boot resources used by probes are released.
+ */
+static TAILQ_HEAD(, dt_driver_probe) dt_driver_async_list =
+	TAILQ_HEAD_INITIALIZER(dt_driver_async_list);
+
+static bool queue_async_probe(struct dt_driver_probe *elt)
+{
+	if (!elt->dt_drv->async_probe || !elt->dt_drv->probe)
+		return false;
+
+	TAILQ_INSERT_TAIL(&dt_driver_async_list, elt, link);
+
+	return true;
+}
+
+static void async_probe(const void *fdt, struct dt_driver_probe *elt)
+{
+	const char __maybe_unused *node_name = NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+	uint64_t start = 0;
+
+	node_name = fdt_get_name(fdt, elt->nodeoffset, NULL);
+
+	if (IS_ENABLED(CFG_CORE_BOOT_PROFILE))
+		start = boot_prof_start();
+	res = elt->dt_drv->probe(fdt, elt->nodeoffset, elt->dm->compat_data);
+	if (IS_ENABLED(CFG_CORE_BOOT_PROFILE))
+		boot_prof_record(BOOT_PROF_DT_PROBE, elt->dt_drv->name,
+				 node_name, start, res, elt->deferrals);
+
+	switch (res) {
+	case TEE_SUCCESS:
+		DMSG("element: %s on node %s initialized", elt->dt_drv->name,
+		     node_name);
+		break;
+	case TEE_ERROR_NODE_DISABLED:
+		DMSG("element: %s on node %s is disabled", elt->dt_drv->name,
+		     node_name);
+		break;
+	default:
+		/* Dependencies are all probed, a deferral is a failure */
+		EMSG("Failed to probe %s on node %s: %#"PRIx32,
+		     elt->dt_drv->name, node_name, res);
+		panic();
+	}
+
+	free(elt);
+}
+
+static TEE_Result probe_async_dt_drivers(void)
+{
+	struct dt_driver_probe *elt = NULL;
+	const void *fdt = get_secure_dt();
+
+	while (!TAILQ_EMPTY(&dt_driver_async_list)) {
+		elt = TAILQ_FIRST(&dt_driver_async_list);
+		TAILQ_REMOVE(&dt_driver_async_list, elt, link);
+		async_probe(fdt, elt);
+	}
+
+	return TEE_SUCCESS;
+}
+
+driver_init_late(probe_async_dt_drivers);
+#else
+static bool queue_async_probe(struct dt_driver_probe *elt __unused)
+{
+	return false;
+}
+#endif /*CFG_DT_DRIVER_ASYNC_PROBE*/
+
 static TEE_Result process_probe_list(const void *fdt)
 {
 	struct dt_driver_probe *elt = NULL;
@@ -634,6 +897,11 @@ static TEE_Result process_probe_list(const void *fdt)
 					   dt_driver_probe_head, link, prev) {
 			TAILQ_REMOVE(&dt_driver_probe_list, elt, link);
 
+			if (queue_async_probe(elt)) {
+				one_probed_ok = true;
+				continue;
+			}
+
 			switch (probe_driver_node(fdt, elt)) {
 			case TEE_SUCCESS:
 				one_probed_ok = true;
@@ -735,26 +1003,19 @@ static TEE_Result add_probe_node_by_compat(const void *fdt, int node,
 	const struct dt_device_match *dm = NULL;
 	uint32_t found_types = 0;
 
-	for_each_dt_driver(dt_drv) {
-		for (dm = dt_drv->match_table; dm && dm->compatible; dm++) {
-			if (strcmp(dm->compatible, compat) == 0) {
-				assert(dt_drv->type < 32);
-
-				res = add_node_to_probe(fdt, node, dt_drv, dm);
-				if (res)
-					return res;
+	while ((dt_drv = dt_driver_next_compatible(compat, dt_drv, &dm))) {
+		assert(dt_drv->type < 32);
 
-				if (found_types & BIT(dt_drv->type)) {
-					EMSG("Driver %s multi hit on type %u",
-					     dt_drv->name, dt_drv->type);
-					panic();
-				}
-				found_types |= BIT(dt_drv->type);
+		res = add_node_to_probe(fdt, node, dt_drv, dm);
+		if (res)
+			return res;
 
-				/* Matching found for this driver, try next */
-				break;
-			}
+		if (found_types & BIT(dt_drv->type)) {
+			EMSG("Driver %s multi hit on type %u",
+			     dt_drv->name, dt_drv->type);
+			panic();
 		}
+		found_types |= BIT(dt_drv->type);
 	}
 
 	return res;
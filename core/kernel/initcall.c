@@ -4,20 +4,40 @@
  * Copyright (c) 2014, STMicroelectronics International N.V.
  */
 
+#include <config.h>
 #include <initcall.h>
-#include <trace.h>
+#include <kernel/boot_prof.h>
 #include <kernel/linker.h>
+#include <trace.h>
+
+static const char *initcall_func_name(const struct initcall *call)
+{
+	const struct initcall_name *n = NULL;
+
+	SCATTERED_ARRAY_FOREACH(n, initcall_name, struct initcall_name)
+		if (n->func == call->func)
+			return n->func_name;
+
+	return NULL;
+}
 
 static void do_init_calls(const char *type __maybe_unused,
+			  enum boot_prof_type prof_type,
 			  const struct initcall *begin,
 			  const struct initcall *end)
 {
 	const struct initcall *call = NULL;
 	TEE_Result ret = TEE_SUCCESS;
+	uint64_t start = 0;
 
 	for (call = begin; call < end; call++) {
 		DMSG("%s level %d %s()", type, call->level, call->func_name);
+		if (IS_ENABLED(CFG_CORE_BOOT_PROFILE))
+			start = boot_prof_start();
 		ret = call->func();
+		if (IS_ENABLED(CFG_CORE_BOOT_PROFILE))
+			boot_prof_record(prof_type, initcall_func_name(call),
+					 NULL, start, ret, 0);
 		if (ret) {
 			EMSG("%s __text_start + 0x%08"PRIxVA" failed",
 			     type, (vaddr_t)call - VCORE_START_VA);
@@ -25,8 +45,8 @@ static void do_init_calls(const char *type __maybe_unused,
 	}
 }
 
-#define DO_INIT_CALLS(name) \
-	do_init_calls(#name, name##_begin, name##_end)
+#define DO_INIT_CALLS(name, prof_type) \
+	do_init_calls(#name, prof_type, name##_begin, name##_end)
 
 /*
  * Note: this function is weak just to make it possible to exclude it from
@@ -34,7 +54,7 @@ static void do_init_calls(const char *type __maybe_unused,
  */
 void __weak call_preinitcalls(void)
 {
-	DO_INIT_CALLS(preinitcall);
+	DO_INIT_CALLS(preinitcall, BOOT_PROF_PREINITCALL);
 }
 
 /*
@@ -43,7 +63,7 @@ void __weak call_preinitcalls(void)
  */
 void __weak call_early_initcalls(void)
 {
-	DO_INIT_CALLS(early_initcall);
+	DO_INIT_CALLS(early_initcall, BOOT_PROF_EARLY_INITCALL);
 }
 
 /*
@@ -52,7 +72,7 @@ void __weak call_early_initcalls(void)
  */
 void __weak call_service_initcalls(void)
 {
-	DO_INIT_CALLS(service_initcall);
+	DO_INIT_CALLS(service_initcall, BOOT_PROF_SERVICE_INITCALL);
 }
 
 /*
@@ -61,7 +81,11 @@ void __weak call_service_initcalls(void)
  */
 void __weak call_driver_initcalls(void)
 {
-	DO_INIT_CALLS(driver_initcall);
+	DO_INIT_CALLS(driver_initcall, BOOT_PROF_DRIVER_INITCALL);
+
+	/* Partitions probe their drivers after the nexus final calls */
+	if (IS_ENABLED(CFG_NS_VIRTUALIZATION))
+		boot_prof_dump();
 }
 
 /*
@@ -70,5 +94,6 @@ void __weak call_driver_initcalls(void)
  */
 void __weak call_finalcalls(void)
 {
-	DO_INIT_CALLS(finalcall);
+	DO_INIT_CALLS(finalcall, BOOT_PROF_FINALCALL);
+	boot_prof_dump();
 }
@@ -35,6 +35,7 @@ srcs-$(CFG_SHOW_CONF_ON_BOOT) += show_conf.c
 srcs-y += user_mode_ctx.c
 srcs-$(CFG_CORE_TPM_EVENT_LOG) += tpm.c
 srcs-y += initcall.c
+srcs-$(CFG_CORE_BOOT_PROFILE) += boot_prof.c
 srcs-$(CFG_WITH_USER_TA) += user_access.c
 srcs-y += mutex.c
 srcs-$(CFG_LOCKDEP) += mutex_lockdep.c
@@ -42,6 +43,7 @@ srcs-y += wait_queue.c
 srcs-y += notif.c
 srcs-$(_CFG_CORE_ASYNC_NOTIF_DEFAULT_IMPL) += notif_default.c
 srcs-y += thread.c
+srcs-y += thread_rpc_arena.c
 
 ifeq ($(CFG_WITH_USER_TA),y)
 srcs-y += user_ta.c
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+/*
+ * RPC payload memory served from an arena.
+ *
+ * Without it each thread_rpc_alloc_payload() and thread_rpc_free_payload()
+ * is an OPTEE_RPC_CMD_SHM_ALLOC or OPTEE_RPC_CMD_SHM_FREE round trip to
+ * normal world. With CFG_CORE_RPC_ARENA_SIZE > 0 a buffer of that size is
+ * allocated from normal world the first time payload memory is needed and
+ * is kept from then on. Allocations are carved out of it, in pages, without
+ * any RPC. Only those that don't fit get memory of their own with an RPC.
+ *
+ * An allocation from the arena is a mobj covering a range of the arena
+ * buffer. The mobj has the cookie of the buffer, the ABI adds
+ * thread_rpc_arena_offs() to the offset of memory references to it.
+ *
+ * The buffer is application shared memory allocated by tee-supplicant,
+ * which a restarted tee-supplicant doesn't know. An RPC with a memory
+ * reference to the arena failing as it would with an unknown buffer or no
+ * tee-supplicant retires the arena: new allocations don't use it and it's
+ * freed once its last allocation is. The next allocation then allocates a
+ * new arena.
+ *
+ * With CFG_NS_VIRTUALIZATION each guest has an arena of its own.
+ */
+
+#include <assert.h>
+#include <kernel/mutex.h>
+#include <kernel/thread.h>
+#include <kernel/thread_private.h>
+#include <mm/mobj.h>
+#include <mm/tee_mm.h>
+#include <stdlib.h>
+#include <trace.h>
+#include <util.h>
+
+#define ARENA_SIZE	ROUNDUP(CFG_CORE_RPC_ARENA_SIZE, SMALL_PAGE_SIZE)
+
+/*
+ * struct mobj_arena - Range of the arena buffer
+ * @mobj:	Memory object of the range
+ * @mm:		Pages of the range in @arena_pool
+ * @offs:	Offset of the range in @arena_mobj
+ */
+struct mobj_arena {
+	struct mobj mobj;
+	tee_mm_entry_t *mm;
+	size_t offs;
+};
+
+/* Protects the variables below */
+static struct mutex arena_mu = MUTEX_INITIALIZER;
+static struct mobj *arena_mobj;
+static tee_mm_pool_t arena_pool;
+/* Number of allocations from @arena_pool */
+static size_t arena_users;
+static bool arena_tried;
+static bool arena_retired;
+
+static const struct mobj_ops mobj_arena_ops;
+
+static struct mobj_arena *to_mobj_arena(struct mobj *mobj)
+{
+	assert(mobj->ops == &mobj_arena_ops);
+	return container_of(mobj, struct mobj_arena, mobj);
+}
+
+static void *mobj_arena_get_va(struct mobj *mobj, size_t offs, size_t len)
+{
+	if (!mobj_check_offset_and_len(mobj, offs, len))
+		return NULL;
+
+	return mobj_get_va(arena_mobj, to_mobj_arena(mobj)->offs + offs, len);
+}
+
+static TEE_Result mobj_arena_get_pa(struct mobj *mobj, size_t offs,
+				    size_t granule, paddr_t *pa)
+{
+	if (offs >= mobj->size)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	return mobj_get_pa(arena_mobj, to_mobj_arena(mobj)->offs + offs,
+			   granule, pa);
+}
+
+static size_t mobj_arena_get_phys_offs(struct mobj *mobj, size_t granule)
+{
+	assert(IS_POWER_OF_TWO(granule));
+
+	return (mobj_get_phys_offs(arena_mobj, granule) +
+		to_mobj_arena(mobj)->offs) & (granule - 1);
+}
+
+static TEE_Result mobj_arena_get_mem_type(struct mobj *mobj __unused,
+					  uint32_t *mt)
+{
+	return mobj_get_mem_type(arena_mobj, mt);
+}
+
+static bool mobj_arena_matches(struct mobj *mobj __unused,
+			       enum buf_is_attr attr)
+{
+	return mobj_matches(arena_mobj, attr);
+}
+
+static uint64_t mobj_arena_get_cookie(struct mobj *mobj __unused)
+{
+	return mobj_get_cookie(arena_mobj);
+}
+
+/* Called with arena_mu held */
+static void arena_release(void)
+{
+	assert(!arena_users);
+
+	thread_rpc_free_appl_payload(arena_mobj);
+	tee_mm_final(&arena_pool);
+	arena_mobj = NULL;
+	arena_retired = false;
+	arena_tried = false;
+}
+
+static void mobj_arena_free(struct mobj *mobj)
+{
+	struct mobj_arena *m = to_mobj_arena(mobj);
+
+	mutex_lock(&arena_mu);
+	tee_mm_free(m->mm);
+	arena_users--;
+	if (arena_retired && !arena_users)
+		arena_release();
+	mutex_unlock(&arena_mu);
+
+	free(m);
+}
+
+static const struct mobj_ops mobj_arena_ops = {
+	.get_va = mobj_arena_get_va,
+	.get_pa = mobj_arena_get_pa,
+	.get_phys_offs = mobj_arena_get_phys_offs,
+	.get_mem_type = mobj_arena_get_mem_type,
+	.matches = mobj_arena_matches,
+	.get_cookie = mobj_arena_get_cookie,
+	.free = mobj_arena_free,
+};
+
+/* Called with arena_mu held */
+static void arena_init(void)
+{
+	struct mobj *mobj = NULL;
+
+	mobj = thread_rpc_alloc_appl_payload(ARENA_SIZE);
+	if (!mobj) {
+		EMSG("Can't allocate RPC payload arena of %zu bytes",
+		     (size_t)ARENA_SIZE);
+		return;
+	}
+
+	if (!tee_mm_init(&arena_pool, 0, ARENA_SIZE, SMALL_PAGE_SHIFT,
+			 TEE_MM_POOL_NO_FLAGS)) {
+		thread_rpc_free_appl_payload(mobj);
+		return;
+	}
+
+	arena_mobj = mobj;
+	DMSG("RPC payload arena of %zu bytes", (size_t)ARENA_SIZE);
+}
+
+static struct mobj *arena_alloc(size_t size)
+{
+	struct mobj_arena *m = NULL;
+	tee_mm_entry_t *mm = NULL;
+
+	if (!ARENA_SIZE || !size || size > ARENA_SIZE)
+		return NULL;
+
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return NULL;
+
+	mutex_lock(&arena_mu);
+	/* Tried once per arena, later allocations get memory of their own */
+	if (!arena_tried) {
+		arena_tried = true;
+		arena_init();
+	}
+	if (arena_mobj && !arena_retired) {
+		mm = tee_mm_alloc(&arena_pool, size);
+		if (mm)
+			arena_users++;
+	}
+	mutex_unlock(&arena_mu);
+
+	if (!mm) {
+		free(m);
+		return NULL;
+	}
+
+	m->mm = mm;
+	m->offs = tee_mm_get_smem(mm);
+	m->mobj.ops = &mobj_arena_ops;
+	m->mobj.size = tee_mm_get_bytes(mm);
+	m->mobj.phys_granule = SMALL_PAGE_SIZE;
+	refcount_set(&m->mobj.refc, 1);
+
+	return &m->mobj;
+}
+
+static void arena_retire(void)
+{
+	mutex_lock(&arena_mu);
+	if (arena_mobj && !arena_retired) {
+		DMSG("Retiring RPC payload arena");
+		arena_retired = true;
+		if (!arena_users)
+			arena_release();
+	}
+	mutex_unlock(&arena_mu);
+}
+
+void thread_rpc_arena_check_res(size_t num_params,
+				struct thread_param *params, uint32_t res)
+{
+	size_t n = 0;
+
+	/*
+	 * tee-supplicant fails with TEE_ERROR_BAD_PARAMETERS if it doesn't
+	 * know the buffer, the driver with TEE_ERROR_COMMUNICATION if
+	 * there's no tee-supplicant.
+	 */
+	if (res != TEE_ERROR_BAD_PARAMETERS && res != TEE_ERROR_COMMUNICATION)
+		return;
+
+	for (n = 0; n < num_params; n++) {
+		if (params[n].attr != THREAD_PARAM_ATTR_MEMREF_IN &&
+		    params[n].attr != THREAD_PARAM_ATTR_MEMREF_OUT &&
+		    params[n].attr != THREAD_PARAM_ATTR_MEMREF_INOUT)
+			continue;
+
+		if (params[n].u.memref.mobj &&
+		    params[n].u.memref.mobj->ops == &mobj_arena_ops) {
+			arena_retire();
+			return;
+		}
+	}
+}
+
+size_t thread_rpc_arena_offs(struct mobj *mobj)
+{
+	if (mobj && mobj->ops == &mobj_arena_ops)
+		return to_mobj_arena(mobj)->offs;
+
+	return 0;
+}
+
+struct mobj *thread_rpc_alloc_payload(size_t size)
+{
+	struct mobj *mobj = arena_alloc(size);
+
+	if (mobj)
+		return mobj;
+
+	return thread_rpc_alloc_appl_payload(size);
+}
+
+void thread_rpc_free_payload(struct mobj *mobj)
+{
+	if (mobj && mobj->ops == &mobj_arena_ops)
+		mobj_put(mobj);
+	else
+		thread_rpc_free_appl_payload(mobj);
+}
@@ -3,16 +3,20 @@
  * Copyright (c) 2019-2022, Linaro Limited
  */
 
+#include <bitstring.h>
 #include <config.h>
 #include <crypto/crypto.h>
 #include <crypto/internal_aes-gcm.h>
 #include <initcall.h>
 #include <kernel/boot.h>
+#include <kernel/delay.h>
 #include <kernel/panic.h>
+#include <kernel/spinlock.h>
 #include <memtag.h>
 #include <mm/core_memprot.h>
 #include <mm/core_mmu.h>
 #include <mm/fobj.h>
+#include <mm/page_compress.h>
 #include <mm/phys_mem.h>
 #include <mm/tee_mm.h>
 #include <stdlib.h>
@@ -72,6 +76,7 @@ static void fobj_init(struct fobj *fobj, const struct fobj_ops *ops,
 	fobj->num_pages = num_pages;
 	refcount_set(&fobj->refc, 1);
 	TAILQ_INIT(&fobj->regions);
+	TAILQ_INIT(&fobj->pmems);
 }
 
 static void fobj_uninit(struct fobj *fobj)
@@ -79,10 +84,11 @@ static void fobj_uninit(struct fobj *fobj)
 	assert(!refcount_val(&fobj->refc));
 	assert(TAILQ_EMPTY(&fobj->regions));
 	tee_pager_invalidate_fobj(fobj);
+	assert(TAILQ_EMPTY(&fobj->pmems));
 }
 
-static TEE_Result rwp_load_page(void *va, struct rwp_state *state,
-				const uint8_t *src)
+static TEE_Result rwp_load_data(void *va, size_t size,
+				struct rwp_state *state, const uint8_t *src)
 {
 	struct rwp_aes_gcm_iv iv = {
 		.iv = { (vaddr_t)state, state->iv >> 32, state->iv }
@@ -93,17 +99,23 @@ static TEE_Result rwp_load_page(void *va, struct rwp_state *state,
 		 * IV still zero which means that this is previously unused
 		 * page.
 		 */
-		memset(va, 0, SMALL_PAGE_SIZE);
+		memset(va, 0, size);
 		return TEE_SUCCESS;
 	}
 
 	return internal_aes_gcm_dec(&rwp_ae_key, &iv, sizeof(iv),
-				    NULL, 0, src, SMALL_PAGE_SIZE, va,
+				    NULL, 0, src, size, va,
 				    state->tag, sizeof(state->tag));
 }
 
-static TEE_Result rwp_save_page(const void *va, struct rwp_state *state,
-				uint8_t *dst)
+static TEE_Result rwp_load_page(void *va, struct rwp_state *state,
+				const uint8_t *src)
+{
+	return rwp_load_data(va, SMALL_PAGE_SIZE, state, src);
+}
+
+static TEE_Result rwp_save_data(const void *va, size_t size,
+				struct rwp_state *state, uint8_t *dst)
 {
 	size_t tag_len = sizeof(state->tag);
 	struct rwp_aes_gcm_iv iv = { };
@@ -123,10 +135,16 @@ static TEE_Result rwp_save_page(const void *va, struct rwp_state *state,
 	iv.iv[2] = state->iv;
 
 	return internal_aes_gcm_enc(&rwp_ae_key, &iv, sizeof(iv),
-				    NULL, 0, va, SMALL_PAGE_SIZE, dst,
+				    NULL, 0, va, size, dst,
 				    state->tag, &tag_len);
 }
 
+static TEE_Result rwp_save_page(const void *va, struct rwp_state *state,
+				uint8_t *dst)
+{
+	return rwp_save_data(va, SMALL_PAGE_SIZE, state, dst);
+}
+
 static struct rwp_state_padded *idx_to_state_padded(size_t idx)
 {
 	assert(rwp_state_base);
@@ -357,6 +375,347 @@ __weak __relrodata_unpaged("ops_rwp_unpaged_iv") = {
 	.save_page = rwp_unpaged_iv_save_page,
 };
 
+#ifdef CFG_CORE_PAGER_RWP_COMPRESS
+/* Allocation granule of the compressed store */
+#define RWP_COMP_CHUNK_SIZE	128
+
+/*
+ * struct rwp_comp_slot - Stored state of a page of a compressed fobj
+ * @state:	IV and tag of the encrypted data
+ * @chunk:	Index of the first chunk of the data in the store
+ * @num_chunks:	Number of chunks used, 0 if no data is stored
+ * @size:	Size of the stored data, 0 for a zero filled page and
+ *		SMALL_PAGE_SIZE if the page is stored uncompressed
+ */
+struct rwp_comp_slot {
+	struct rwp_state state;
+	uint32_t chunk;
+	uint16_t num_chunks;
+	uint16_t size;
+};
+
+struct fobj_rwp_comp {
+	struct rwp_comp_slot *slots;
+	struct fobj fobj;
+};
+
+const struct fobj_ops ops_rwp_comp;
+
+static uint8_t *rwp_comp_store;
+static bitstr_t *rwp_comp_map;
+static size_t rwp_comp_num_chunks;
+static size_t rwp_comp_next_chunk;
+/* Protects the chunk allocation and the statistics */
+static unsigned int rwp_comp_lock = SPINLOCK_UNLOCK;
+static struct fobj_comp_stats rwp_comp_stats;
+/* Protects the compression working area and compressed page buffer */
+static unsigned int rwp_comp_buf_lock = SPINLOCK_UNLOCK;
+static struct page_compress_ctx rwp_comp_ctx;
+static uint8_t rwp_comp_buf[SMALL_PAGE_SIZE];
+
+static uint64_t rwp_comp_time(void)
+{
+#ifdef CFG_CORE_HAS_GENERIC_TIMER
+	return delay_cnt_read();
+#else
+	return 0;
+#endif
+}
+
+static uint64_t rwp_comp_time_to_us(uint64_t t)
+{
+#ifdef CFG_CORE_HAS_GENERIC_TIMER
+	if (delay_cnt_freq())
+		return t * 1000000 / delay_cnt_freq();
+#endif
+	return t;
+}
+
+static bool rwp_comp_alloc_chunks(struct rwp_comp_slot *slot, size_t size)
+{
+	size_t num_chunks = ROUNDUP_DIV(size, RWP_COMP_CHUNK_SIZE);
+	size_t pos = rwp_comp_next_chunk;
+	uint32_t exceptions = 0;
+	size_t start = 0;
+	size_t run = 0;
+	size_t n = 0;
+	bool ret = false;
+
+	exceptions = cpu_spin_lock_xsave(&rwp_comp_lock);
+
+	/* Next fit search of a run of free chunks */
+	for (n = 0; n < rwp_comp_num_chunks + num_chunks; n++, pos++) {
+		if (pos >= rwp_comp_num_chunks) {
+			pos = 0;
+			run = 0;
+		}
+		if (bit_test(rwp_comp_map, pos)) {
+			run = 0;
+			continue;
+		}
+		if (!run)
+			start = pos;
+		run++;
+		if (run == num_chunks) {
+			bit_nset(rwp_comp_map, start, start + num_chunks - 1);
+			rwp_comp_next_chunk = start + num_chunks;
+			rwp_comp_stats.store_used += num_chunks *
+						     RWP_COMP_CHUNK_SIZE;
+			rwp_comp_stats.stored_pages++;
+			slot->chunk = start;
+			slot->num_chunks = num_chunks;
+			slot->size = size;
+			ret = true;
+			break;
+		}
+	}
+
+	cpu_spin_unlock_xrestore(&rwp_comp_lock, exceptions);
+
+	return ret;
+}
+
+static void rwp_comp_free_chunks(struct rwp_comp_slot *slot)
+{
+	uint32_t exceptions = 0;
+
+	if (slot->num_chunks) {
+		exceptions = cpu_spin_lock_xsave(&rwp_comp_lock);
+
+		bit_nclear(rwp_comp_map, slot->chunk,
+			   slot->chunk + slot->num_chunks - 1);
+		rwp_comp_stats.store_used -= slot->num_chunks *
+					     RWP_COMP_CHUNK_SIZE;
+		rwp_comp_stats.stored_pages--;
+
+		cpu_spin_unlock_xrestore(&rwp_comp_lock, exceptions);
+	}
+
+	slot->chunk = 0;
+	slot->num_chunks = 0;
+	slot->size = 0;
+}
+
+static bool page_is_zero(const void *va)
+{
+	const uint64_t *p = va;
+	size_t n = 0;
+
+	for (n = 0; n < SMALL_PAGE_SIZE / sizeof(*p); n++)
+		if (p[n])
+			return false;
+
+	return true;
+}
+
+static struct fobj *rwp_comp_alloc(unsigned int num_pages)
+{
+	struct fobj_rwp_comp *rwp = NULL;
+
+	if (!rwp_comp_store)
+		return NULL;
+
+	rwp = calloc(1, sizeof(*rwp));
+	if (!rwp)
+		return NULL;
+
+	rwp->slots = calloc(num_pages, sizeof(*rwp->slots));
+	if (!rwp->slots) {
+		free(rwp);
+		return NULL;
+	}
+
+	fobj_init(&rwp->fobj, &ops_rwp_comp, num_pages);
+
+	return &rwp->fobj;
+}
+
+static struct fobj_rwp_comp *to_rwp_comp(struct fobj *fobj)
+{
+	assert(fobj->ops == &ops_rwp_comp);
+
+	return container_of(fobj, struct fobj_rwp_comp, fobj);
+}
+
+static TEE_Result rwp_comp_load_page(struct fobj *fobj, unsigned int page_idx,
+				     void *va)
+{
+	struct fobj_rwp_comp *rwp = to_rwp_comp(fobj);
+	struct rwp_comp_slot *slot = rwp->slots + page_idx;
+	uint8_t *src = rwp_comp_store + slot->chunk * RWP_COMP_CHUNK_SIZE;
+	uint64_t t = rwp_comp_time();
+	TEE_Result res = TEE_SUCCESS;
+	uint32_t exceptions = 0;
+
+	assert(refcount_val(&fobj->refc));
+	assert(page_idx < fobj->num_pages);
+
+	if (!slot->size) {
+		/* Unused or zero filled page */
+		memset(va, 0, SMALL_PAGE_SIZE);
+	} else if (slot->size == SMALL_PAGE_SIZE) {
+		res = rwp_load_data(va, SMALL_PAGE_SIZE, &slot->state, src);
+	} else {
+		exceptions = cpu_spin_lock_xsave(&rwp_comp_buf_lock);
+		res = rwp_load_data(rwp_comp_buf, slot->size, &slot->state,
+				    src);
+		if (!res)
+			res = page_decompress(rwp_comp_buf, slot->size, va);
+		cpu_spin_unlock_xrestore(&rwp_comp_buf_lock, exceptions);
+	}
+
+	exceptions = cpu_spin_lock_xsave(&rwp_comp_lock);
+	rwp_comp_stats.loads++;
+	rwp_comp_stats.load_time += rwp_comp_time() - t;
+	cpu_spin_unlock_xrestore(&rwp_comp_lock, exceptions);
+
+	return res;
+}
+DECLARE_KEEP_PAGER(rwp_comp_load_page);
+
+static TEE_Result rwp_comp_save_page(struct fobj *fobj, unsigned int page_idx,
+				     const void *va)
+{
+	struct fobj_rwp_comp *rwp = to_rwp_comp(fobj);
+	struct rwp_comp_slot *slot = rwp->slots + page_idx;
+	uint64_t t = rwp_comp_time();
+	TEE_Result res = TEE_SUCCESS;
+	uint32_t exceptions = 0;
+	const void *data = va;
+	bool zero = false;
+	bool raw = false;
+	size_t size = 0;
+
+	assert(page_idx < fobj->num_pages);
+
+	if (!refcount_val(&fobj->refc)) {
+		/*
+		 * This fobj is being teared down, it just hasn't had the time
+		 * to call tee_pager_invalidate_fobj() yet.
+		 */
+		assert(TAILQ_EMPTY(&fobj->regions));
+		return TEE_SUCCESS;
+	}
+
+	/* The previously stored content is stale */
+	rwp_comp_free_chunks(slot);
+
+	zero = page_is_zero(va);
+	if (zero)
+		goto out;
+
+	exceptions = cpu_spin_lock_xsave(&rwp_comp_buf_lock);
+
+	/* Store uncompressed unless at least one chunk is saved */
+	size = page_compress(&rwp_comp_ctx, va, rwp_comp_buf,
+			     SMALL_PAGE_SIZE - RWP_COMP_CHUNK_SIZE);
+	if (size) {
+		data = rwp_comp_buf;
+	} else {
+		size = SMALL_PAGE_SIZE;
+		raw = true;
+	}
+
+	if (rwp_comp_alloc_chunks(slot, size)) {
+		res = rwp_save_data(data, size, &slot->state,
+				    rwp_comp_store +
+				    slot->chunk * RWP_COMP_CHUNK_SIZE);
+		if (res)
+			rwp_comp_free_chunks(slot);
+	} else {
+		/* The pager keeps the page until there's room in the store */
+		res = TEE_ERROR_OUT_OF_MEMORY;
+	}
+
+	cpu_spin_unlock_xrestore(&rwp_comp_buf_lock, exceptions);
+out:
+	exceptions = cpu_spin_lock_xsave(&rwp_comp_lock);
+	if (res == TEE_ERROR_OUT_OF_MEMORY) {
+		rwp_comp_stats.store_full++;
+	} else {
+		rwp_comp_stats.saves++;
+		rwp_comp_stats.zero_saves += zero;
+		rwp_comp_stats.raw_saves += raw;
+		rwp_comp_stats.save_time += rwp_comp_time() - t;
+	}
+	cpu_spin_unlock_xrestore(&rwp_comp_lock, exceptions);
+
+	return res;
+}
+DECLARE_KEEP_PAGER(rwp_comp_save_page);
+
+static void rwp_comp_free(struct fobj *fobj)
+{
+	struct fobj_rwp_comp *rwp = to_rwp_comp(fobj);
+	unsigned int n = 0;
+
+	fobj_uninit(fobj);
+	for (n = 0; n < fobj->num_pages; n++)
+		rwp_comp_free_chunks(rwp->slots + n);
+	free(rwp->slots);
+	free(rwp);
+}
+
+/*
+ * Note: this variable is weak just to ease breaking its dependency chain
+ * when added to the unpaged area.
+ */
+const struct fobj_ops ops_rwp_comp
+__weak __relrodata_unpaged("ops_rwp_comp") = {
+	.free = rwp_comp_free,
+	.load_page = rwp_comp_load_page,
+	.save_page = rwp_comp_save_page,
+};
+
+static void rwp_comp_init(void)
+{
+	size_t size = CFG_CORE_PAGER_RWP_COMPRESS_STORE_SIZE;
+	tee_mm_entry_t *mm = NULL;
+
+	mm = nex_phys_mem_ta_alloc(size);
+	if (!mm)
+		panic("Can't allocate compressed store");
+
+	rwp_comp_num_chunks = size / RWP_COMP_CHUNK_SIZE;
+	rwp_comp_map = bit_alloc(rwp_comp_num_chunks);
+	if (!rwp_comp_map)
+		panic();
+
+	rwp_comp_store = phys_to_virt(tee_mm_get_smem(mm),
+				      MEM_AREA_SEC_RAM_OVERALL, size);
+	assert(rwp_comp_store);
+	rwp_comp_stats.store_size = size;
+}
+
+void fobj_get_comp_stats(struct fobj_comp_stats *stats)
+{
+	uint32_t exceptions = cpu_spin_lock_xsave(&rwp_comp_lock);
+
+	*stats = rwp_comp_stats;
+	stats->save_time = rwp_comp_time_to_us(stats->save_time);
+	stats->load_time = rwp_comp_time_to_us(stats->load_time);
+
+	rwp_comp_stats.saves = 0;
+	rwp_comp_stats.loads = 0;
+	rwp_comp_stats.zero_saves = 0;
+	rwp_comp_stats.raw_saves = 0;
+	rwp_comp_stats.store_full = 0;
+	rwp_comp_stats.save_time = 0;
+	rwp_comp_stats.load_time = 0;
+
+	cpu_spin_unlock_xrestore(&rwp_comp_lock, exceptions);
+}
+#else
+static void rwp_comp_init(void)
+{
+}
+
+static struct fobj *rwp_comp_alloc(unsigned int num_pages __unused)
+{
+	return NULL;
+}
+#endif /*CFG_CORE_PAGER_RWP_COMPRESS*/
+
 static TEE_Result rwp_init(void)
 {
 	paddr_size_t ta_size = nex_phys_mem_get_ta_size();
@@ -372,6 +731,9 @@ static TEE_Result rwp_init(void)
 				      &rwp_ae_key.rounds))
 		panic("failed to expand key");
 
+	if (IS_ENABLED(CFG_CORE_PAGER_RWP_COMPRESS))
+		rwp_comp_init();
+
 	if (!IS_ENABLED(CFG_CORE_PAGE_TAG_AND_IV))
 		return TEE_SUCCESS;
 
@@ -409,6 +771,8 @@ struct fobj *fobj_rw_paged_alloc(unsigned int num_pages)
 
 	if (IS_ENABLED(CFG_CORE_PAGE_TAG_AND_IV))
 		return rwp_paged_iv_alloc(num_pages);
+	else if (IS_ENABLED(CFG_CORE_PAGER_RWP_COMPRESS))
+		return rwp_comp_alloc(num_pages);
 	else
 		return rwp_unpaged_iv_alloc(num_pages);
 }
@@ -487,6 +851,33 @@ static TEE_Result rop_load_page(struct fobj *fobj, unsigned int page_idx,
 }
 DECLARE_KEEP_PAGER(rop_load_page);
 
+static TEE_Result rop_load_pages(struct fobj *fobj, unsigned int page_idx,
+				 void * const *va, size_t num_pages)
+{
+	struct fobj_rop *rop = to_rop(fobj);
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	assert(refcount_val(&rop->fobj.refc));
+	assert(page_idx + num_pages <= rop->fobj.num_pages);
+
+	for (n = 0; n < num_pages; n++)
+		memcpy(va[n], rop->store + (page_idx + n) * SMALL_PAGE_SIZE,
+		       SMALL_PAGE_SIZE);
+
+	/* Hashes of consecutive pages are consecutive, check them in a row */
+	for (n = 0; n < num_pages; n++) {
+		res = hash_sha256_check(rop->hashes +
+					(page_idx + n) * TEE_SHA256_HASH_SIZE,
+					va[n], SMALL_PAGE_SIZE);
+		if (res)
+			return res;
+	}
+
+	return TEE_SUCCESS;
+}
+DECLARE_KEEP_PAGER(rop_load_pages);
+
 static TEE_Result rop_save_page(struct fobj *fobj __unused,
 				unsigned int page_idx __unused,
 				const void *va __unused)
@@ -503,6 +894,7 @@ const struct fobj_ops ops_ro_paged
 __weak __relrodata_unpaged("ops_ro_paged") = {
 	.free = rop_free,
 	.load_page = rop_load_page,
+	.load_pages = rop_load_pages,
 	.save_page = rop_save_page,
 };
 
@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <keep.h>
+#include <mm/core_mmu.h>
+#include <mm/page_compress.h>
+#include <string.h>
+#include <util.h>
+
+/*
+ * A page is compressed into a sequence of LZ4 block sequences:
+ * - a token, the upper nibble is the literal length and the lower nibble
+ *   the match length minus PC_MIN_MATCH, 15 means that more length bytes
+ *   follow
+ * - additional literal length bytes, literals
+ * - 16-bit little endian match offset, additional match length bytes
+ * The last sequence only has literals.
+ */
+#define PC_MIN_MATCH		4
+#define PC_LAST_LITERALS	5
+#define PC_MF_LIMIT		12
+#define PC_MAX_OFFSET		UINT16_MAX
+#define PC_RUN_MASK		15
+
+static uint32_t read32(const uint8_t *p)
+{
+	uint32_t v = 0;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static unsigned int pc_hash(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - PAGE_COMPRESS_HASH_BITS);
+}
+
+static size_t put_length(uint8_t *dst, size_t len)
+{
+	size_t n = 0;
+
+	while (len >= 255) {
+		dst[n++] = 255;
+		len -= 255;
+	}
+	dst[n++] = len;
+
+	return n;
+}
+
+/*
+ * Emits one sequence at @op, @match_len is 0 for the last sequence.
+ * Returns the new output offset or 0 if @dst_size is exceeded.
+ */
+static size_t put_sequence(uint8_t *dst, size_t dst_size, size_t op,
+			   const uint8_t *lit, size_t lit_len,
+			   size_t offset, size_t match_len)
+{
+	size_t token = op;
+	size_t need = 0;
+
+	/* Token, literal length bytes, literals, offset, match bytes */
+	need = 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1;
+	if (need > dst_size - op)
+		return 0;
+
+	op++;
+	if (lit_len >= PC_RUN_MASK) {
+		dst[token] = PC_RUN_MASK << 4;
+		op += put_length(dst + op, lit_len - PC_RUN_MASK);
+	} else {
+		dst[token] = lit_len << 4;
+	}
+	memcpy(dst + op, lit, lit_len);
+	op += lit_len;
+
+	if (!match_len)
+		return op;
+
+	dst[op++] = offset;
+	dst[op++] = offset >> 8;
+
+	match_len -= PC_MIN_MATCH;
+	if (match_len >= PC_RUN_MASK) {
+		dst[token] |= PC_RUN_MASK;
+		op += put_length(dst + op, match_len - PC_RUN_MASK);
+	} else {
+		dst[token] |= match_len;
+	}
+
+	return op;
+}
+
+size_t page_compress(struct page_compress_ctx *ctx, const void *src,
+		     void *dst, size_t dst_size)
+{
+	uint16_t *hash_table = ctx->hash_table;
+	const uint8_t *s = src;
+	size_t match_len = 0;
+	size_t anchor = 0;
+	uint32_t seq = 0;
+	size_t ref = 0;
+	size_t ip = 0;
+	size_t op = 0;
+	unsigned int h = 0;
+
+	COMPILE_TIME_ASSERT(SMALL_PAGE_SIZE <= UINT16_MAX);
+
+	memset(ctx->hash_table, 0, sizeof(ctx->hash_table));
+
+	while (ip < SMALL_PAGE_SIZE - PC_MF_LIMIT) {
+		seq = read32(s + ip);
+		h = pc_hash(seq);
+		ref = hash_table[h];
+		hash_table[h] = ip;
+
+		if (ref >= ip || ip - ref > PC_MAX_OFFSET ||
+		    read32(s + ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		match_len = PC_MIN_MATCH;
+		while (ip + match_len < SMALL_PAGE_SIZE - PC_LAST_LITERALS &&
+		       s[ref + match_len] == s[ip + match_len])
+			match_len++;
+
+		op = put_sequence(dst, dst_size, op, s + anchor, ip - anchor,
+				  ip - ref, match_len);
+		if (!op)
+			return 0;
+
+		ip += match_len;
+		anchor = ip;
+	}
+
+	return put_sequence(dst, dst_size, op, s + anchor,
+			    SMALL_PAGE_SIZE - anchor, 0, 0);
+}
+DECLARE_KEEP_PAGER(page_compress);
+
+static bool get_length(const uint8_t *src, size_t src_size, size_t *ip,
+		       size_t *len)
+{
+	uint8_t b = 0;
+
+	do {
+		if (*ip >= src_size)
+			return false;
+		b = src[(*ip)++];
+		*len += b;
+	} while (b == 255);
+
+	return true;
+}
+
+TEE_Result page_decompress(const void *src, size_t src_size, void *dst)
+{
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	size_t offset = 0;
+	size_t len = 0;
+	size_t ip = 0;
+	size_t op = 0;
+	uint8_t token = 0;
+
+	while (ip < src_size) {
+		token = s[ip++];
+
+		len = token >> 4;
+		if (len == PC_RUN_MASK && !get_length(s, src_size, &ip, &len))
+			return TEE_ERROR_CORRUPT_OBJECT;
+		if (len > src_size - ip || len > SMALL_PAGE_SIZE - op)
+			return TEE_ERROR_CORRUPT_OBJECT;
+		memcpy(d + op, s + ip, len);
+		ip += len;
+		op += len;
+
+		/* The last sequence has no match */
+		if (ip == src_size)
+			break;
+
+		if (src_size - ip < 2)
+			return TEE_ERROR_CORRUPT_OBJECT;
+		offset = s[ip] | (s[ip + 1] << 8);
+		ip += 2;
+		if (!offset || offset > op)
+			return TEE_ERROR_CORRUPT_OBJECT;
+
+		len = token & PC_RUN_MASK;
+		if (len == PC_RUN_MASK && !get_length(s, src_size, &ip, &len))
+			return TEE_ERROR_CORRUPT_OBJECT;
+		len += PC_MIN_MATCH;
+		if (len > SMALL_PAGE_SIZE - op)
+			return TEE_ERROR_CORRUPT_OBJECT;
+
+		/* Byte by byte since source and destination may overlap */
+		while (len--) {
+			d[op] = d[op - offset];
+			op++;
+		}
+	}
+
+	if (op != SMALL_PAGE_SIZE)
+		return TEE_ERROR_CORRUPT_OBJECT;
+
+	return TEE_SUCCESS;
+}
+DECLARE_KEEP_PAGER(page_decompress);
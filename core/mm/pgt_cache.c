@@ -13,6 +13,7 @@
 #include <mm/pgt_cache.h>
 #include <mm/phys_mem.h>
 #include <mm/tee_pager.h>
+#include <mm/vm.h>
 #include <stdlib.h>
 #include <trace.h>
 #include <util.h>
@@ -174,6 +175,8 @@ void pgt_flush_range(struct user_mode_ctx *uctx, vaddr_t begin, vaddr_t last)
 	struct pgt *next_p = NULL;
 	struct pgt *p = NULL;
 
+	vm_set_tlbi_pending(uctx);
+
 	/*
 	 * Do the special case where the first element in the list is
 	 * removed first.
@@ -215,6 +218,8 @@ void pgt_flush(struct user_mode_ctx *uctx)
 	struct pgt_cache *pgt_cache = &uctx->pgt_cache;
 	struct pgt *p = NULL;
 
+	vm_set_tlbi_pending(uctx);
+
 	while (true) {
 		p = SLIST_FIRST(pgt_cache);
 		if (!p)
@@ -250,10 +255,13 @@ void pgt_clear_range(struct user_mode_ctx *uctx, vaddr_t begin, vaddr_t end)
 	}
 }
 
-static struct pgt *prune_before_va(struct pgt_cache *pgt_cache, struct pgt *p,
-				   struct pgt *pp, vaddr_t va)
+static struct pgt *prune_before_va(struct user_mode_ctx *uctx,
+				   struct pgt *p, struct pgt *pp, vaddr_t va)
 {
+	struct pgt_cache *pgt_cache = &uctx->pgt_cache;
+
 	while (p && p->vabase < va) {
+		vm_set_tlbi_pending(uctx);
 		if (pp) {
 			assert(p == SLIST_NEXT(pp, link));
 			SLIST_REMOVE_AFTER(pp, link);
@@ -291,7 +299,7 @@ bool pgt_check_avail(struct user_mode_ctx *uctx)
 		for (va = ROUNDDOWN(r->va, CORE_MMU_PGDIR_SIZE);
 		     va < r->va + r->size; va += CORE_MMU_PGDIR_SIZE) {
 			if (!p_used)
-				p = prune_before_va(pgt_cache, p, pp, va);
+				p = prune_before_va(uctx, p, pp, va);
 			if (!p)
 				goto prune_done;
 
@@ -328,6 +336,7 @@ prune_done:
 			p = alloc_pgt(va);
 			if (!p)
 				return false;
+			vm_set_tlbi_pending(uctx);
 
 			if (pp)
 				SLIST_INSERT_AFTER(pp, p, link);
@@ -587,12 +596,19 @@ static void pgt_free_unlocked(struct pgt_cache *pgt_cache)
 	}
 }
 
-static struct pgt *pop_from_some_list(vaddr_t vabase, void *ctx)
+static struct pgt *pop_from_some_list(vaddr_t vabase,
+				      struct user_mode_ctx *uctx)
 {
+	struct ts_ctx *ctx = uctx->ts_ctx;
 	struct pgt *p = pop_from_cache_list(vabase, ctx);
 
 	if (p)
 		return p;
+	/*
+	 * A table not found in the cache list is either new or has
+	 * replaced a table used the last time the context was mapped.
+	 */
+	vm_set_tlbi_pending(uctx);
 	p = pop_from_free_list();
 	if (!p) {
 		p = pop_least_used_from_cache_list();
@@ -613,6 +629,8 @@ void pgt_flush(struct user_mode_ctx *uctx)
 	struct pgt *pp = NULL;
 	struct pgt *p = NULL;
 
+	vm_set_tlbi_pending(uctx);
+
 	mutex_lock(&pgt_mu);
 
 	while (true) {
@@ -720,6 +738,8 @@ void pgt_flush_range(struct user_mode_ctx *uctx, vaddr_t begin, vaddr_t last)
 	struct pgt_cache *pgt_cache = &uctx->pgt_cache;
 	struct ts_ctx *ctx = uctx->ts_ctx;
 
+	vm_set_tlbi_pending(uctx);
+
 	mutex_lock(&pgt_mu);
 
 	flush_ctx_range_from_list(pgt_cache, ctx, begin, last);
@@ -770,9 +790,10 @@ void pgt_clear_range(struct user_mode_ctx *uctx, vaddr_t begin, vaddr_t end)
 	mutex_unlock(&pgt_mu);
 }
 
-static bool pgt_alloc_unlocked(struct pgt_cache *pgt_cache, struct ts_ctx *ctx,
-			       struct vm_info *vm_info)
+static bool pgt_alloc_unlocked(struct user_mode_ctx *uctx)
 {
+	struct pgt_cache *pgt_cache = &uctx->pgt_cache;
+	struct vm_info *vm_info = &uctx->vm_info;
 	struct vm_region *r = NULL;
 	struct pgt *pp = NULL;
 	struct pgt *p = NULL;
@@ -783,7 +804,7 @@ static bool pgt_alloc_unlocked(struct pgt_cache *pgt_cache, struct ts_ctx *ctx,
 		     va < r->va + r->size; va += CORE_MMU_PGDIR_SIZE) {
 			if (p && p->vabase == va)
 				continue;
-			p = pop_from_some_list(va, ctx);
+			p = pop_from_some_list(va, uctx);
 			if (!p) {
 				pgt_free_unlocked(pgt_cache);
 				return false;
@@ -831,7 +852,7 @@ void pgt_get_all(struct user_mode_ctx *uctx)
 	mutex_lock(&pgt_mu);
 
 	pgt_free_unlocked(pgt_cache);
-	while (!pgt_alloc_unlocked(pgt_cache, uctx->ts_ctx, vm_info)) {
+	while (!pgt_alloc_unlocked(uctx)) {
 		assert(pgt_check_avail(uctx));
 		DMSG("Waiting for page tables");
 		condvar_broadcast(&pgt_cv);
@@ -1300,6 +1300,14 @@ void vm_set_ctx(struct ts_ctx *ctx)
 	struct thread_specific_data *tsd = thread_get_tsd();
 	struct user_mode_ctx *uctx = NULL;
 
+	/*
+	 * Setting the same context again is done to synchronize changes
+	 * made to the translation tables, make sure that no stale TLB
+	 * entries remains.
+	 */
+	if (tsd->ctx == ctx && is_user_mode_ctx(ctx))
+		vm_set_tlbi_pending(to_user_mode_ctx(ctx));
+
 	core_mmu_set_user_map(NULL);
 
 	if (is_user_mode_ctx(tsd->ctx)) {
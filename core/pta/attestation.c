@@ -11,6 +11,7 @@
 #include <kernel/user_access.h>
 #include <kernel/user_mode_ctx.h>
 #include <mm/file.h>
+#include <mm/mobj.h>
 #include <pta_attestation.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +25,39 @@
 
 #define MAX_KEY_SIZE 4096
 
+/*
+ * struct region_key - Identifies the content of a measured TA region
+ * @mobj:	Memory object mapped by the region, a reference is held
+ * @offset:	Offset of the region in @mobj
+ * @size:	Size of the region
+ */
+struct region_key {
+	struct mobj *mobj;
+	size_t offset;
+	size_t size;
+};
+
+/*
+ * struct ta_mem_cache - Last measurement of the memory of the calling TA
+ * @keys:	Regions that were measured, in the order of the VM
+ * @nkeys:	Number of elements in @keys
+ * @hash:	Hash of the regions
+ * @valid:	True if @keys and @hash are set
+ *
+ * Used as session context with CFG_ATTESTATION_PTA_CACHE_MEASUREMENTS=y.
+ * The measured regions are read-only so their content only changes if they
+ * are replaced by other regions.
+ */
+struct ta_mem_cache {
+	struct region_key *keys;
+	size_t nkeys;
+	uint8_t hash[TEE_SHA256_HASH_SIZE];
+	bool valid;
+};
+
+static uint8_t tee_mem_hash[TEE_SHA256_HASH_SIZE];
+static bool tee_mem_hash_valid;
+
 static TEE_UUID pta_uuid = PTA_ATTESTATION_UUID;
 
 static struct rsa_keypair *key;
@@ -516,7 +550,69 @@ static int cmp_regions(const void *a, const void *b)
 	return memcmp((void *)r1->va, (void *)r2->va, r1->size);
 }
 
-static TEE_Result hash_regions(struct vm_info *vm_info, uint8_t *hash)
+static void cache_release(struct ta_mem_cache *cache)
+{
+	size_t n = 0;
+
+	for (n = 0; n < cache->nkeys; n++)
+		mobj_put(cache->keys[n].mobj);
+	free(cache->keys);
+	cache->keys = NULL;
+	cache->nkeys = 0;
+	cache->valid = false;
+}
+
+static bool cache_matches(struct ta_mem_cache *cache,
+			  struct vm_region **regions, size_t nregions)
+{
+	size_t n = 0;
+
+	if (!cache->valid || cache->nkeys != nregions)
+		return false;
+
+	for (n = 0; n < nregions; n++)
+		if (cache->keys[n].mobj != regions[n]->mobj ||
+		    cache->keys[n].offset != regions[n]->offset ||
+		    cache->keys[n].size != regions[n]->size)
+			return false;
+
+	return true;
+}
+
+/*
+ * Records @regions, in the order of the VM, as the keys of @cache. The
+ * cache becomes valid once the hash of the regions is stored.
+ */
+static void cache_set_keys(struct ta_mem_cache *cache,
+			   struct vm_region **regions, size_t nregions)
+{
+	struct region_key *keys = NULL;
+	size_t n = 0;
+
+	cache_release(cache);
+
+	if (nregions) {
+		keys = calloc(nregions, sizeof(*keys));
+		if (!keys)
+			return;
+	}
+
+	for (n = 0; n < nregions; n++) {
+		keys[n].mobj = mobj_get(regions[n]->mobj);
+		keys[n].offset = regions[n]->offset;
+		keys[n].size = regions[n]->size;
+	}
+
+	cache->keys = keys;
+	cache->nkeys = nregions;
+}
+
+/*
+ * Hashes the valid regions of @vm_info. If @cache isn't NULL and the
+ * regions are the same as when it was updated the cached hash is used.
+ */
+static TEE_Result hash_regions(struct ta_mem_cache *cache,
+			       struct vm_info *vm_info, uint8_t *hash)
 {
 	TEE_Result res = TEE_SUCCESS;
 	struct vm_region *r = NULL;
@@ -551,6 +647,16 @@ static TEE_Result hash_regions(struct vm_info *vm_info, uint8_t *hash)
 		if (is_region_valid(r))
 			regions[i++] = r;
 
+	if (cache && cache_matches(cache, regions, nregions)) {
+		DMSG("Using cached hash");
+		memcpy(hash, cache->hash, TEE_SHA256_HASH_SIZE);
+		goto out;
+	}
+
+	/* Before the array is sorted below */
+	if (cache)
+		cache_set_keys(cache, regions, nregions);
+
 	enter_user_access();
 
 	/*
@@ -574,6 +680,10 @@ static TEE_Result hash_regions(struct vm_info *vm_info, uint8_t *hash)
 		goto out;
 
 	res = crypto_hash_final(ctx, hash, TEE_SHA256_HASH_SIZE);
+	if (!res && cache && (cache->keys || !nregions)) {
+		memcpy(cache->hash, hash, sizeof(cache->hash));
+		cache->valid = true;
+	}
 out:
 	free(regions);
 	crypto_hash_free_ctx(ctx);
@@ -623,7 +733,8 @@ static TEE_Result cmd_get_ta_shdr_digest(uint32_t param_types,
 	return sign_buffer(out, out_sz, nonce, nonce_sz);
 }
 
-static TEE_Result cmd_hash_ta_memory(uint32_t param_types,
+static TEE_Result cmd_hash_ta_memory(struct ta_mem_cache *cache,
+				     uint32_t param_types,
 				     TEE_Param params[TEE_NUM_PARAMS])
 {
 	uint8_t *nonce = params[0].memref.buffer;
@@ -666,7 +777,7 @@ static TEE_Result cmd_hash_ta_memory(uint32_t param_types,
 	out_sz = min_out_sz;
 
 	s = ts_pop_current_session();
-	res = hash_regions(&uctx->vm_info, out);
+	res = hash_regions(cache, &uctx->vm_info, out);
 	ts_push_current_session(s);
 	if (res)
 		return res;
@@ -674,39 +785,11 @@ static TEE_Result cmd_hash_ta_memory(uint32_t param_types,
 	return sign_buffer(out, out_sz, nonce, nonce_sz);
 }
 
-static TEE_Result cmd_hash_tee_memory(uint32_t param_types,
-				      TEE_Param params[TEE_NUM_PARAMS])
+static TEE_Result hash_tee_memory(uint8_t *hash)
 {
-	uint8_t *nonce = params[0].memref.buffer;
-	size_t nonce_sz = params[0].memref.size;
-	uint8_t *out = params[1].memref.buffer;
-	size_t out_sz = params[1].memref.size;
 	TEE_Result res = TEE_SUCCESS;
-	size_t min_out_sz = 0;
 	void *ctx = NULL;
 
-	if (param_types != TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
-					   TEE_PARAM_TYPE_MEMREF_OUTPUT,
-					   TEE_PARAM_TYPE_NONE,
-					   TEE_PARAM_TYPE_NONE))
-		return TEE_ERROR_BAD_PARAMETERS;
-
-	if (!nonce || !nonce_sz)
-		return TEE_ERROR_BAD_PARAMETERS;
-
-	if (!out && out_sz)
-		return TEE_ERROR_BAD_PARAMETERS;
-
-	res = init_key();
-	if (res)
-		return res;
-
-	min_out_sz = TEE_SHA256_HASH_SIZE + crypto_bignum_num_bytes(key->n);
-	params[1].memref.size = min_out_sz;
-	if (out_sz < min_out_sz)
-		return TEE_ERROR_SHORT_BUFFER;
-	out_sz = min_out_sz;
-
 	res = crypto_hash_alloc_ctx(&ctx, TEE_ALG_SHA256);
 	if (res)
 		return res;
@@ -748,19 +831,90 @@ static TEE_Result cmd_hash_tee_memory(uint32_t param_types,
 		if (res)
 			goto out;
 	}
-	res = crypto_hash_final(ctx, out, TEE_SHA256_HASH_SIZE);
+	res = crypto_hash_final(ctx, hash, TEE_SHA256_HASH_SIZE);
+out:
+	crypto_hash_free_ctx(ctx);
+	return res;
+}
+
+static TEE_Result cmd_hash_tee_memory(uint32_t param_types,
+				      TEE_Param params[TEE_NUM_PARAMS])
+{
+	uint8_t *nonce = params[0].memref.buffer;
+	size_t nonce_sz = params[0].memref.size;
+	uint8_t *out = params[1].memref.buffer;
+	size_t out_sz = params[1].memref.size;
+	TEE_Result res = TEE_SUCCESS;
+	size_t min_out_sz = 0;
+
+	if (param_types != TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT,
+					   TEE_PARAM_TYPE_MEMREF_OUTPUT,
+					   TEE_PARAM_TYPE_NONE,
+					   TEE_PARAM_TYPE_NONE))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!nonce || !nonce_sz)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!out && out_sz)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = init_key();
 	if (res)
-		goto out;
+		return res;
+
+	min_out_sz = TEE_SHA256_HASH_SIZE + crypto_bignum_num_bytes(key->n);
+	params[1].memref.size = min_out_sz;
+	if (out_sz < min_out_sz)
+		return TEE_ERROR_SHORT_BUFFER;
+	out_sz = min_out_sz;
+
+	if (IS_ENABLED(CFG_ATTESTATION_PTA_CACHE_MEASUREMENTS) &&
+	    tee_mem_hash_valid) {
+		memcpy(out, tee_mem_hash, TEE_SHA256_HASH_SIZE);
+	} else {
+		res = hash_tee_memory(out);
+		if (res)
+			return res;
+		if (IS_ENABLED(CFG_ATTESTATION_PTA_CACHE_MEASUREMENTS)) {
+			memcpy(tee_mem_hash, out, TEE_SHA256_HASH_SIZE);
+			tee_mem_hash_valid = true;
+		}
+	}
 
 	DHEXDUMP(out, TEE_SHA256_HASH_SIZE);
 
-	res = sign_buffer(out, out_sz, nonce, nonce_sz);
-out:
-	crypto_hash_free_ctx(ctx);
-	return res;
+	return sign_buffer(out, out_sz, nonce, nonce_sz);
+}
+
+static TEE_Result open_session(uint32_t param_types __unused,
+			       TEE_Param params[TEE_NUM_PARAMS] __unused,
+			       void **sess_ctx)
+{
+	struct ta_mem_cache *cache = NULL;
+
+	if (!IS_ENABLED(CFG_ATTESTATION_PTA_CACHE_MEASUREMENTS))
+		return TEE_SUCCESS;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	*sess_ctx = cache;
+	return TEE_SUCCESS;
+}
+
+static void close_session(void *sess_ctx)
+{
+	struct ta_mem_cache *cache = sess_ctx;
+
+	if (cache) {
+		cache_release(cache);
+		free(cache);
+	}
 }
 
-static TEE_Result invoke_command(void *sess_ctx __unused, uint32_t cmd_id,
+static TEE_Result invoke_command(void *sess_ctx, uint32_t cmd_id,
 				 uint32_t param_types,
 				 TEE_Param params[TEE_NUM_PARAMS])
 {
@@ -781,7 +935,7 @@ static TEE_Result invoke_command(void *sess_ctx __unused, uint32_t cmd_id,
 		res = cmd_get_ta_shdr_digest(param_types, eparams);
 		break;
 	case PTA_ATTESTATION_HASH_TA_MEMORY:
-		res = cmd_hash_ta_memory(param_types, eparams);
+		res = cmd_hash_ta_memory(sess_ctx, param_types, eparams);
 		break;
 	case PTA_ATTESTATION_HASH_TEE_MEMORY:
 		res = cmd_hash_tee_memory(param_types, eparams);
@@ -799,4 +953,6 @@ static TEE_Result invoke_command(void *sess_ctx __unused, uint32_t cmd_id,
 
 pseudo_ta_register(.uuid = PTA_ATTESTATION_UUID, .name = PTA_NAME,
 		   .flags = PTA_DEFAULT_FLAGS,
+		   .open_session_entry_point = open_session,
+		   .close_session_entry_point = close_session,
 		   .invoke_command_entry_point = invoke_command);
@@ -5,10 +5,13 @@
 #include <compiler.h>
 #include <drivers/clk.h>
 #include <drivers/regulator.h>
+#include <kernel/boot_prof.h>
 #include <kernel/pseudo_ta.h>
 #include <kernel/tee_time.h>
+#include <kernel/virtualization.h>
 #include <malloc.h>
 #include <mm/phys_mem.h>
+#include <mm/fobj.h>
 #include <mm/tee_mm.h>
 #include <mm/tee_pager.h>
 #include <pta_stats.h>
@@ -17,6 +20,7 @@
 #include <tee_api_types.h>
 #include <tee/tee_fs.h>
 #include <trace.h>
+#include <util.h>
 
 static TEE_Result get_alloc_stats(uint32_t type, TEE_Param p[TEE_NUM_PARAMS])
 {
@@ -133,6 +137,66 @@ static TEE_Result get_pager_stats(uint32_t type, TEE_Param p[TEE_NUM_PARAMS])
 	return TEE_SUCCESS;
 }
 
+static TEE_Result get_pager_policy_stats(uint32_t type,
+					 TEE_Param p[TEE_NUM_PARAMS])
+{
+	struct tee_pager_stats stats = { };
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT) != type) {
+		EMSG("expect 4 output values as argument");
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	tee_pager_get_stats(&stats);
+
+	switch (stats.policy) {
+	case TEE_PAGER_POLICY_CLOCK:
+		p[0].value.a = STATS_PAGER_POLICY_CLOCK;
+		break;
+	default:
+		p[0].value.a = STATS_PAGER_POLICY_FIFO;
+		break;
+	}
+	p[0].value.b = stats.faults;
+	p[1].value.a = stats.evictions;
+	p[1].value.b = stats.second_chances;
+	p[2].value.a = stats.hides;
+	p[2].value.b = stats.hidden_hits;
+	p[3].value.a = stats.readahead;
+	p[3].value.b = stats.readahead_unused;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result get_pager_compress_stats(uint32_t type,
+					   TEE_Param p[TEE_NUM_PARAMS])
+{
+	struct fobj_comp_stats stats = { };
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT) != type) {
+		EMSG("expect 4 output values as argument");
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	fobj_get_comp_stats(&stats);
+	p[0].value.a = stats.stored_pages;
+	p[0].value.b = stats.store_used;
+	p[1].value.a = stats.store_size;
+	p[1].value.b = stats.store_full;
+	p[2].value.a = stats.saves;
+	p[2].value.b = stats.saves ? stats.save_time / stats.saves : 0;
+	p[3].value.a = stats.loads;
+	p[3].value.b = stats.loads ? stats.load_time / stats.loads : 0;
+
+	return TEE_SUCCESS;
+}
+
 static TEE_Result get_memleak_stats(uint32_t type,
 				    TEE_Param p[TEE_NUM_PARAMS] __maybe_unused)
 {
@@ -219,6 +283,62 @@ static TEE_Result print_driver_info(uint32_t type, TEE_Param p[TEE_NUM_PARAMS])
 	return TEE_SUCCESS;
 }
 
+static TEE_Result get_boot_profile(uint32_t type, TEE_Param p[TEE_NUM_PARAMS])
+{
+	TEE_Result res = TEE_ERROR_GENERIC;
+	size_t sz = 0;
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!IS_ALIGNED_WITH_TYPE(p[0].memref.buffer, uint64_t))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	sz = p[0].memref.size;
+	res = boot_prof_get_entries(p[0].memref.buffer, &sz);
+	if (res && res != TEE_ERROR_SHORT_BUFFER)
+		return res;
+
+	p[0].memref.size = sz;
+	p[1].value.a = boot_prof_get_dropped();
+	p[1].value.b = 0;
+
+	return res;
+}
+
+static TEE_Result get_guest_thread_stats(uint32_t type,
+					 TEE_Param p[TEE_NUM_PARAMS])
+{
+	struct virt_thread_stats stats = { };
+	TEE_Result res = TEE_ERROR_GENERIC;
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT) != type) {
+		EMSG("expect 4 output values as argument");
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	res = virt_get_thread_stats(&stats);
+	if (res)
+		return res;
+
+	p[0].value.a = stats.active;
+	p[0].value.b = stats.max_threads;
+	p[1].value.a = stats.peak;
+	p[1].value.b = stats.admitted;
+	p[2].value.a = stats.over_quota;
+	p[2].value.b = stats.no_thread;
+	p[3].value.a = stats.admitted ? stats.busy_us / stats.admitted : 0;
+	p[3].value.b = MIN(stats.max_busy_us, (uint64_t)UINT32_MAX);
+
+	return TEE_SUCCESS;
+}
+
 /*
  * Trusted Application Entry Points
  */
@@ -230,6 +350,10 @@ static TEE_Result invoke_command(void *psess __unused,
 	switch (cmd) {
 	case STATS_CMD_PAGER_STATS:
 		return get_pager_stats(ptypes, params);
+	case STATS_CMD_PAGER_POLICY_STATS:
+		return get_pager_policy_stats(ptypes, params);
+	case STATS_CMD_PAGER_COMPRESS_STATS:
+		return get_pager_compress_stats(ptypes, params);
 	case STATS_CMD_ALLOC_STATS:
 		return get_alloc_stats(ptypes, params);
 	case STATS_CMD_MEMLEAK_STATS:
@@ -240,6 +364,10 @@ static TEE_Result invoke_command(void *psess __unused,
 		return get_system_time(ptypes, params);
 	case STATS_CMD_PRINT_DRIVER_INFO:
 		return print_driver_info(ptypes, params);
+	case STATS_CMD_BOOT_PROFILE:
+		return get_boot_profile(ptypes, params);
+	case STATS_CMD_GUEST_THREAD_STATS:
+		return get_guest_thread_stats(ptypes, params);
 	default:
 		break;
 	}
@@ -36,6 +36,7 @@ struct dt_test_state {
 	enum dt_test_sid probe_gpios;
 	enum dt_test_sid probe_resets;
 	enum dt_test_sid crypto_dependencies;
+	enum dt_test_sid async_probe;
 };
 
 /*
@@ -118,6 +119,8 @@ static TEE_Result dt_test_release(void)
 		    dt_test_str_sid[dt_test_state.probe_resets]);
 	DT_TEST_MSG("Crypto deps.: %s",
 		    dt_test_str_sid[dt_test_state.crypto_dependencies]);
+	DT_TEST_MSG("Async probe: %s",
+		    dt_test_str_sid[dt_test_state.async_probe]);
 
 	return dt_driver_test_status();
 }
@@ -151,6 +154,10 @@ TEE_Result dt_driver_test_status(void)
 		EMSG("Probe deferral on crypto dependencies test failed");
 		res = TEE_ERROR_GENERIC;
 	}
+	if (dt_test_state.async_probe != SUCCESS) {
+		EMSG("Asynchronous probe test failed");
+		res = TEE_ERROR_GENERIC;
+	}
 
 	return res;
 }
@@ -428,6 +435,39 @@ DEFINE_DT_DRIVER(dt_test_consumer_driver) = {
 	.probe = dt_test_crypt_consumer_probe,
 };
 
+/*
+ * Asynchronous test driver: with CFG_DT_DRIVER_ASYNC_PROBE it is expected
+ * to be probed once, after the probe sequence has completed the probe of
+ * the consumer test driver. Without it, it is probed in the sequence like
+ * any other driver. Failing the test doesn't fail the probe since a failed
+ * asynchronous probe is fatal.
+ */
+static TEE_Result dt_test_async_probe(const void *fdt __unused,
+				      int node __unused,
+				      const void *compat_data __unused)
+{
+	if (dt_test_state.async_probe != DEFAULT ||
+	    (IS_ENABLED(CFG_DT_DRIVER_ASYNC_PROBE) &&
+	     dt_test_state.probe_deferral != SUCCESS))
+		dt_test_state.async_probe = FAILED;
+	else
+		dt_test_state.async_probe = SUCCESS;
+
+	return TEE_SUCCESS;
+}
+
+static const struct dt_device_match dt_test_async_match_table[] = {
+	{ .compatible = "linaro,dt-test-async", },
+	{ }
+};
+
+DEFINE_DT_DRIVER(dt_test_async_driver) = {
+	.name = "dt-test-async",
+	.match_table = dt_test_async_match_table,
+	.probe = dt_test_async_probe,
+	.async_probe = true,
+};
+
 #ifdef CFG_DRIVERS_CLK
 #define DT_TEST_CLK_COUNT		2
 
@@ -0,0 +1,434 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee/fs_dirfile.h>
+#include <trace.h>
+#include <types_ext.h>
+#include <util.h>
+
+#include "misc.h"
+
+/*
+ * Tests of the dirfile with the dirfiles stored in memory:
+ * - lookups through the in-memory index of the entries when objects share
+ *   a bucket or even the whole hash
+ * - moving the objects of a TA from a root dirfile to a shard dirfile the
+ *   way the REE FS does when CFG_REE_FS_DIRF_SHARDS is enabled
+ */
+
+#define TEST_NUM_FILES		2
+#define TEST_FILE_SIZE		4096
+#define TEST_ROOT_NUMBER	UINT32_MAX
+#define TEST_SHARD_NUMBER	32
+#define TEST_NUM_NUMBERS	32
+#define TEST_NUM_SPREAD		24
+
+/*
+ * struct test_file - file in memory
+ * @number:	file number, TEST_ROOT_NUMBER for the root dirfile
+ * @exists:	the file has been created
+ * @data:	content, including changes not committed yet
+ * @len:	length of @data
+ * @committed:	content as of last commit
+ * @committed_len: length of @committed
+ */
+struct test_file {
+	uint32_t number;
+	bool exists;
+	uint8_t data[TEST_FILE_SIZE];
+	size_t len;
+	uint8_t committed[TEST_FILE_SIZE];
+	size_t committed_len;
+};
+
+static struct test_file *test_files;
+
+static const TEE_UUID test_uuid_moved = { .timeLow = 1 };
+static const TEE_UUID test_uuid_kept = { .timeLow = 2 };
+
+/* Object IDs of the same length and index hash for test_uuid_kept */
+static const char test_oid_coll1[] = "obj0012789";
+static const char test_oid_coll2[] = "obj0249192";
+
+static void test_hash(struct test_file *f, uint8_t *hash)
+{
+	uint32_t h = 0x811c9dc5;
+	size_t n = 0;
+
+	for (n = 0; n < f->committed_len; n++)
+		h = (h ^ f->committed[n]) * 0x01000193;
+
+	memset(hash, 0, TEE_FS_HTREE_HASH_SIZE);
+	memcpy(hash, &h, sizeof(h));
+}
+
+static TEE_Result test_open(bool create, uint8_t *hash,
+			    uint32_t min_counter __unused,
+			    const TEE_UUID *uuid __unused,
+			    struct tee_fs_dirfile_fileh *dfh,
+			    struct tee_file_handle **fh)
+{
+	uint32_t number = dfh ? dfh->file_number : TEST_ROOT_NUMBER;
+	uint8_t h[TEE_FS_HTREE_HASH_SIZE] = { };
+	struct test_file *f = NULL;
+	size_t n = 0;
+
+	for (n = 0; n < TEST_NUM_FILES; n++)
+		if (test_files[n].number == number)
+			f = test_files + n;
+	if (!f)
+		return TEE_ERROR_GENERIC;
+
+	if (create) {
+		f->exists = true;
+		f->committed_len = 0;
+	} else if (!f->exists) {
+		return TEE_ERROR_ITEM_NOT_FOUND;
+	}
+
+	if (hash) {
+		test_hash(f, h);
+		if (memcmp(h, hash, sizeof(h)))
+			return TEE_ERROR_SECURITY;
+	}
+
+	memcpy(f->data, f->committed, f->committed_len);
+	f->len = f->committed_len;
+	*fh = (struct tee_file_handle *)f;
+
+	return TEE_SUCCESS;
+}
+
+static void test_close(struct tee_file_handle *fh __unused)
+{
+}
+
+static TEE_Result test_read(struct tee_file_handle *fh, size_t pos, void *buf,
+			    size_t *len)
+{
+	struct test_file *f = (struct test_file *)fh;
+
+	if (pos >= f->len)
+		*len = 0;
+	else
+		*len = MIN(*len, f->len - pos);
+	memcpy(buf, f->data + pos, *len);
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result test_write(struct tee_file_handle *fh, size_t pos,
+			     const void *buf, size_t len)
+{
+	struct test_file *f = (struct test_file *)fh;
+
+	if (pos > f->len || len > sizeof(f->data) - pos)
+		return TEE_ERROR_STORAGE_NO_SPACE;
+
+	memcpy(f->data + pos, buf, len);
+	f->len = MAX(f->len, pos + len);
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result test_commit_writes(struct tee_file_handle *fh,
+				     uint8_t *hash, uint32_t *counter)
+{
+	struct test_file *f = (struct test_file *)fh;
+
+	memcpy(f->committed, f->data, f->len);
+	f->committed_len = f->len;
+	if (hash)
+		test_hash(f, hash);
+	if (counter)
+		*counter = 0;
+
+	return TEE_SUCCESS;
+}
+
+static const struct tee_fs_dirfile_operations test_dirf_ops = {
+	.open = test_open,
+	.close = test_close,
+	.read = test_read,
+	.write = test_write,
+	.commit_writes = test_commit_writes,
+};
+
+static bool test_select(const TEE_UUID *uuid, void *arg __unused)
+{
+	return !memcmp(uuid, &test_uuid_moved, sizeof(*uuid));
+}
+
+static TEE_Result open_root(uint8_t *hash, struct tee_fs_dirfile_dirh **dirh)
+{
+	return tee_fs_dirfile_open_numbered(!hash, hash, 0, NULL, 0,
+					    TEST_NUM_NUMBERS, &test_dirf_ops,
+					    dirh);
+}
+
+static TEE_Result open_shard(uint8_t *hash, struct tee_fs_dirfile_dirh **dirh)
+{
+	struct tee_fs_dirfile_fileh dfh = {
+		.file_number = TEST_SHARD_NUMBER,
+		.idx = -1,
+	};
+
+	return tee_fs_dirfile_open_numbered(!hash, hash, 0, &dfh,
+					    TEST_SHARD_NUMBER + 1,
+					    TEST_NUM_NUMBERS - 1,
+					    &test_dirf_ops, dirh);
+}
+
+static TEE_Result add_object(struct tee_fs_dirfile_dirh *dirh,
+			     const TEE_UUID *uuid, const char *oid)
+{
+	struct tee_fs_dirfile_fileh dfh = { .idx = -1 };
+	TEE_Result res = TEE_SUCCESS;
+
+	res = tee_fs_dirfile_get_tmp(dirh, &dfh);
+	if (res)
+		return res;
+
+	memset(dfh.hash, dfh.file_number + 1, sizeof(dfh.hash));
+
+	return tee_fs_dirfile_rename(dirh, uuid, &dfh, oid, strlen(oid));
+}
+
+/* Checks that @oid of @uuid is listed in @dirh as added by add_object() */
+static bool has_object(struct tee_fs_dirfile_dirh *dirh, const TEE_UUID *uuid,
+		       const char *oid, uint32_t file_number)
+{
+	struct tee_fs_dirfile_fileh dfh = { };
+	uint8_t hash[TEE_FS_HTREE_HASH_SIZE] = { };
+
+	if (tee_fs_dirfile_find(dirh, uuid, oid, strlen(oid), &dfh))
+		return false;
+
+	memset(hash, file_number + 1, sizeof(hash));
+
+	return dfh.file_number == file_number &&
+	       !memcmp(dfh.hash, hash, sizeof(hash));
+}
+
+static TEE_Result remove_object(struct tee_fs_dirfile_dirh *dirh,
+				const TEE_UUID *uuid, const char *oid)
+{
+	struct tee_fs_dirfile_fileh dfh = { };
+	TEE_Result res = TEE_SUCCESS;
+
+	res = tee_fs_dirfile_find(dirh, uuid, oid, strlen(oid), &dfh);
+	if (res)
+		return res;
+
+	return tee_fs_dirfile_remove(dirh, &dfh);
+}
+
+static bool is_missing(struct tee_fs_dirfile_dirh *dirh, const TEE_UUID *uuid,
+		       const char *oid)
+{
+	return tee_fs_dirfile_find(dirh, uuid, oid, strlen(oid), NULL) ==
+	       TEE_ERROR_ITEM_NOT_FOUND;
+}
+
+static size_t count_objects(struct tee_fs_dirfile_dirh *dirh,
+			    const TEE_UUID *uuid)
+{
+	uint8_t oid[TEE_OBJECT_ID_MAX_LEN] = { };
+	size_t oidlen = sizeof(oid);
+	size_t count = 0;
+	int idx = -1;
+
+	while (!tee_fs_dirfile_get_next(dirh, uuid, &idx, oid, &oidlen)) {
+		oidlen = sizeof(oid);
+		count++;
+	}
+
+	return count;
+}
+
+#define CHECK(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			EMSG("check failed: %s", #cond);		\
+			res = TEE_ERROR_GENERIC;			\
+			goto out;					\
+		}							\
+	} while (0)
+
+#define CHECK_RES(expr)							\
+	do {								\
+		res = (expr);						\
+		if (res) {						\
+			EMSG("%s: %#"PRIx32, #expr, res);		\
+			goto out;					\
+		}							\
+	} while (0)
+
+static TEE_Result test_index_collisions(void)
+{
+	struct tee_fs_dirfile_dirh *root = NULL;
+	struct tee_fs_dirfile_fileh dfh = { };
+	uint8_t root_hash[TEE_FS_HTREE_HASH_SIZE] = { };
+	TEE_Result res = TEE_SUCCESS;
+	char oid[8] = { };
+	size_t n = 0;
+
+	/*
+	 * File numbers 0 and 1 for the colliding pair, 2 and up for objects
+	 * spread over the buckets of the index. There are more objects than
+	 * buckets so some share a bucket.
+	 */
+	CHECK_RES(open_root(NULL, &root));
+	CHECK_RES(add_object(root, &test_uuid_kept, test_oid_coll1));
+	CHECK_RES(add_object(root, &test_uuid_kept, test_oid_coll2));
+	for (n = 0; n < TEST_NUM_SPREAD; n++) {
+		snprintf(oid, sizeof(oid), "o%zu", n);
+		CHECK_RES(add_object(root, &test_uuid_moved, oid));
+	}
+	/* Same object ID as an object of another TA */
+	CHECK_RES(add_object(root, &test_uuid_moved, test_oid_coll1));
+
+	CHECK(has_object(root, &test_uuid_kept, test_oid_coll1, 0));
+	CHECK(has_object(root, &test_uuid_kept, test_oid_coll2, 1));
+	CHECK(has_object(root, &test_uuid_moved, test_oid_coll1,
+			 TEST_NUM_SPREAD + 2));
+	for (n = 0; n < TEST_NUM_SPREAD; n++) {
+		snprintf(oid, sizeof(oid), "o%zu", n);
+		CHECK(has_object(root, &test_uuid_moved, oid, n + 2));
+		CHECK(is_missing(root, &test_uuid_kept, oid));
+	}
+
+	/* Remove one of the colliding pair and an object in the middle */
+	CHECK_RES(remove_object(root, &test_uuid_kept, test_oid_coll1));
+	snprintf(oid, sizeof(oid), "o%d", TEST_NUM_SPREAD / 2);
+	CHECK_RES(remove_object(root, &test_uuid_moved, oid));
+	CHECK(is_missing(root, &test_uuid_kept, test_oid_coll1));
+	CHECK(is_missing(root, &test_uuid_moved, oid));
+	CHECK(has_object(root, &test_uuid_kept, test_oid_coll2, 1));
+	CHECK(has_object(root, &test_uuid_moved, test_oid_coll1,
+			 TEST_NUM_SPREAD + 2));
+
+	/* The first free entry and file number are reused */
+	CHECK_RES(add_object(root, &test_uuid_kept, "new"));
+	CHECK_RES(tee_fs_dirfile_find(root, &test_uuid_kept, "new", 3, &dfh));
+	CHECK(dfh.idx == 0 && dfh.file_number == 0);
+	CHECK_RES(tee_fs_dirfile_commit_writes(root, root_hash, NULL));
+	tee_fs_dirfile_close(root);
+	root = NULL;
+
+	/* The index rebuilt when opening gives the same results */
+	CHECK_RES(open_root(root_hash, &root));
+	CHECK(is_missing(root, &test_uuid_kept, test_oid_coll1));
+	CHECK(is_missing(root, &test_uuid_moved, oid));
+	CHECK(has_object(root, &test_uuid_kept, "new", 0));
+	CHECK(has_object(root, &test_uuid_kept, test_oid_coll2, 1));
+	CHECK(has_object(root, &test_uuid_moved, test_oid_coll1,
+			 TEST_NUM_SPREAD + 2));
+	CHECK(count_objects(root, &test_uuid_kept) == 2);
+	CHECK(count_objects(root, &test_uuid_moved) == TEST_NUM_SPREAD);
+
+out:
+	tee_fs_dirfile_close(root);
+
+	return res;
+}
+
+static TEE_Result test_move_to_shard(void)
+{
+	struct tee_fs_dirfile_dirh *shard = NULL;
+	struct tee_fs_dirfile_dirh *root = NULL;
+	struct tee_fs_dirfile_fileh dfh = { };
+	uint8_t shard_hash[TEE_FS_HTREE_HASH_SIZE] = { };
+	uint8_t root_hash[TEE_FS_HTREE_HASH_SIZE] = { };
+	TEE_Result res = TEE_SUCCESS;
+	size_t count = 0;
+
+	/* Objects stored in the root dirfile only, file numbers 0 to 2 */
+	CHECK_RES(open_root(NULL, &root));
+	CHECK_RES(add_object(root, &test_uuid_moved, "a"));
+	CHECK_RES(add_object(root, &test_uuid_kept, "b"));
+	CHECK_RES(add_object(root, &test_uuid_moved, "c"));
+	CHECK_RES(tee_fs_dirfile_commit_writes(root, root_hash, NULL));
+	tee_fs_dirfile_close(root);
+	root = NULL;
+
+	/* Interrupted move, the shard is committed but not the root */
+	CHECK_RES(open_root(root_hash, &root));
+	CHECK_RES(open_shard(NULL, &shard));
+	CHECK_RES(tee_fs_dirfile_copy_entries(root, shard, test_select, NULL,
+					      &count));
+	CHECK(count == 2);
+	CHECK_RES(tee_fs_dirfile_commit_writes(shard, shard_hash, NULL));
+	CHECK_RES(tee_fs_dirfile_remove_entries(root, test_select, NULL));
+	tee_fs_dirfile_close(root);
+	tee_fs_dirfile_close(shard);
+	root = NULL;
+	shard = NULL;
+
+	/* The objects are still listed in the root and moved again */
+	CHECK_RES(open_root(root_hash, &root));
+	CHECK(count_objects(root, &test_uuid_moved) == 2);
+	CHECK_RES(open_shard(shard_hash, &shard));
+	count = 0;
+	CHECK_RES(tee_fs_dirfile_copy_entries(root, shard, test_select, NULL,
+					      &count));
+	CHECK(count == 2);
+	CHECK(count_objects(shard, &test_uuid_moved) == 2);
+	CHECK_RES(tee_fs_dirfile_commit_writes(shard, shard_hash, NULL));
+	CHECK_RES(tee_fs_dirfile_remove_entries(root, test_select, NULL));
+	CHECK_RES(tee_fs_dirfile_commit_writes(root, root_hash, NULL));
+	tee_fs_dirfile_close(root);
+	tee_fs_dirfile_close(shard);
+	root = NULL;
+	shard = NULL;
+
+	/* Moved objects keep their file number and hash */
+	CHECK_RES(open_root(root_hash, &root));
+	CHECK(!count_objects(root, &test_uuid_moved));
+	CHECK(has_object(root, &test_uuid_kept, "b", 1));
+	CHECK_RES(open_shard(shard_hash, &shard));
+	CHECK(has_object(shard, &test_uuid_moved, "a", 0));
+	CHECK(has_object(shard, &test_uuid_moved, "c", 2));
+	CHECK(!count_objects(shard, &test_uuid_kept));
+
+	/* New files of the shard are numbered from its own range */
+	CHECK_RES(tee_fs_dirfile_get_tmp(shard, &dfh));
+	CHECK(dfh.file_number == TEST_SHARD_NUMBER + 1);
+	tee_fs_dirfile_close(shard);
+	shard = NULL;
+
+	/* A shard doesn't open with a stale hash */
+	CHECK(open_shard(root_hash, &shard) == TEE_ERROR_SECURITY);
+
+out:
+	tee_fs_dirfile_close(root);
+	tee_fs_dirfile_close(shard);
+
+	return res;
+}
+
+TEE_Result core_fs_dirfile_tests(void)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	test_files = calloc(TEST_NUM_FILES, sizeof(*test_files));
+	if (!test_files)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	test_files[0].number = TEST_ROOT_NUMBER;
+	test_files[1].number = TEST_SHARD_NUMBER;
+
+	res = test_index_collisions();
+	if (!res)
+		res = test_move_to_shard();
+
+	free(test_files);
+	test_files = NULL;
+
+	return res;
+}
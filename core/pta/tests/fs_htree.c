@@ -623,5 +623,13 @@ TEE_Result core_fs_htree_tests(uint32_t nParamTypes,
 	if (res)
 		return res;
 
-	return test_corrupt(5);
+	res = test_corrupt(5);
+	if (res)
+		return res;
+
+	res = core_fs_dirfile_tests();
+	if (res)
+		return res;
+
+	return core_ree_fs_trans_tests();
 }
@@ -9,8 +9,12 @@
 #include <kernel/dt_driver.h>
 #include <kernel/linker.h>
 #include <kernel/panic.h>
+#include <kernel/thread.h>
+#include <kernel/virtualization.h>
 #include <malloc.h>
 #include <mm/core_memprot.h>
+#include <mm/mobj.h>
+#include <optee_msg.h>
 #include <setjmp.h>
 #include <stdbool.h>
 #include <trace.h>
@@ -556,6 +560,180 @@ static int self_test_nex_malloc(void)
 }
 #endif
 
+#ifdef CFG_NS_VIRTUALIZATION
+#define TEST_COOKIE_BASE	0x7e57000000000000ULL
+#define TEST_COOKIE_COUNT	8
+
+static bool check_cookies(uint64_t mask, uint16_t guest_id)
+{
+	size_t n = 0;
+
+	for (n = 0; n < TEST_COOKIE_COUNT; n++) {
+		if (virt_find_guest_by_cookie(TEST_COOKIE_BASE + n) !=
+		    ((mask & BIT64(n)) ? guest_id : 0))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Test lookups of guest partitions by ID and, with CFG_CORE_SEL1_SPMC, of
+ * their shared memory cookies, adding and removing cookies of the current
+ * guest.
+ */
+static int self_test_virt_lookup(void)
+{
+	uint16_t id = virt_get_current_guest_id();
+	struct guest_partition *prtn = NULL;
+	uint16_t other_id = id + CFG_VIRT_GUEST_COUNT;
+	size_t n = 0;
+	int ret = 0;
+	bool r = false;
+
+	LOG("guest lookup tests:");
+
+	/* Guest IDs in the same bucket as the current guest */
+	prtn = virt_get_guest(id);
+	r = prtn && virt_get_guest_id(prtn) == id;
+	virt_put_guest(prtn);
+	prtn = virt_get_guest(other_id);
+	r = r && (!prtn || virt_get_guest_id(prtn) == other_id);
+	virt_put_guest(prtn);
+	if (!r)
+		ret = -1;
+	LOG("- find guest %"PRIu16" by ID => test %s", id,
+	    r ? "ok" : "FAILED");
+
+	if (!IS_ENABLED(CFG_CORE_SEL1_SPMC))
+		return ret;
+
+	r = true;
+	for (n = 0; n < TEST_COOKIE_COUNT; n++)
+		if (virt_add_cookie_to_current_guest(TEST_COOKIE_BASE + n))
+			r = false;
+	r = r && check_cookies(GENMASK_64(TEST_COOKIE_COUNT - 1, 0), id);
+
+	/* Remove the first, a middle and the last cookie, add the first */
+	virt_remove_cookie(TEST_COOKIE_BASE);
+	virt_remove_cookie(TEST_COOKIE_BASE + TEST_COOKIE_COUNT / 2);
+	virt_remove_cookie(TEST_COOKIE_BASE + TEST_COOKIE_COUNT - 1);
+	r = r && check_cookies(GENMASK_64(TEST_COOKIE_COUNT - 2, 1) &
+			       ~BIT64(TEST_COOKIE_COUNT / 2), id);
+	r = r && !virt_add_cookie_to_current_guest(TEST_COOKIE_BASE);
+	/* A cookie can't be added twice */
+	r = r && virt_add_cookie_to_current_guest(TEST_COOKIE_BASE) ==
+		 TEE_ERROR_ACCESS_DENIED;
+	r = r && check_cookies(GENMASK_64(TEST_COOKIE_COUNT - 2, 0) &
+			       ~BIT64(TEST_COOKIE_COUNT / 2), id);
+
+	for (n = 0; n < TEST_COOKIE_COUNT; n++)
+		virt_remove_cookie(TEST_COOKIE_BASE + n);
+	r = r && check_cookies(0, id);
+	if (!r)
+		ret = -1;
+	LOG("- add, find and remove cookies => test %s", r ? "ok" : "FAILED");
+
+	return ret;
+}
+#else
+static int self_test_virt_lookup(void)
+{
+	return 0;
+}
+#endif
+
+#ifdef CFG_CORE_SEL1_SPMC
+#define TEST_FFA_PAGES		4
+
+/*
+ * Checks the physical address of each page of @mobj, @pa[] holds the
+ * expected address of each page
+ */
+static bool check_ffa_pages(struct mobj *mobj, const paddr_t *pa,
+			    size_t num_pages)
+{
+	paddr_t p = 0;
+	size_t n = 0;
+
+	for (n = 0; n < num_pages; n++) {
+		if (mobj_get_pa(mobj, n * SMALL_PAGE_SIZE + 8, 0, &p) ||
+		    p != pa[n] + 8)
+			return false;
+		if (mobj_get_pa(mobj, n * SMALL_PAGE_SIZE, SMALL_PAGE_SIZE,
+				&p) || p != pa[n])
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Test a FF-A share made of the pages of a RPC payload, listed first in
+ * order and then in reverse order. Constituents contiguous in physical
+ * memory are merged into one range, the pages must be found at the same
+ * place whether or not they are.
+ */
+static int self_test_mobj_ffa(void)
+{
+	paddr_t pa[2 * TEST_FFA_PAGES] = { };
+	struct mobj_ffa *mf = NULL;
+	struct mobj *payload = NULL;
+	struct mobj *mobj = NULL;
+	uint64_t cookie = 0;
+	unsigned int idx = 0;
+	size_t n = 0;
+	int ret = -1;
+
+	LOG("mobj_ffa tests:");
+
+	payload = thread_rpc_alloc_payload(TEST_FFA_PAGES * SMALL_PAGE_SIZE);
+	if (!payload)
+		goto out;
+	for (n = 0; n < TEST_FFA_PAGES; n++) {
+		if (mobj_get_pa(payload, n * SMALL_PAGE_SIZE, SMALL_PAGE_SIZE,
+				pa + n))
+			goto out;
+		pa[ARRAY_SIZE(pa) - 1 - n] = pa[n];
+	}
+
+	mf = mobj_ffa_sel1_spmc_new(OPTEE_MSG_FMEM_INVALID_GLOBAL_ID,
+				    ARRAY_SIZE(pa), ARRAY_SIZE(pa));
+	if (!mf)
+		goto out;
+	for (n = 0; n < ARRAY_SIZE(pa); n++)
+		if (mobj_ffa_add_pages_at(mf, &idx, pa[n], 1))
+			goto out;
+	cookie = mobj_ffa_push_to_inactive(mf);
+	mf = NULL;
+
+	mobj = mobj_ffa_get_by_cookie(cookie, 0);
+	if (mobj && check_ffa_pages(mobj, pa, ARRAY_SIZE(pa)))
+		ret = 0;
+
+out:
+	mobj_put(mobj);
+	if (cookie) {
+		if (mobj)
+			mobj_ffa_unregister_by_cookie(cookie);
+		if (mobj_ffa_sel1_spmc_reclaim(cookie))
+			ret = -1;
+	}
+	if (mf)
+		mobj_ffa_sel1_spmc_delete(mf);
+	thread_rpc_free_payload(payload);
+	LOG("- share of %zu pages => test %s", ARRAY_SIZE(pa),
+	    ret ? "FAILED" : "ok");
+
+	return ret;
+}
+#else
+static int self_test_mobj_ffa(void)
+{
+	return 0;
+}
+#endif
+
 static int check_virt_to_phys(vaddr_t va, paddr_t exp_pa,
 			      enum teecore_memtypes m)
 {
@@ -861,7 +1039,8 @@ TEE_Result core_self_tests(uint32_t nParamTypes __unused,
 	if (self_test_mul_signed_overflow() || self_test_add_overflow() ||
 	    self_test_sub_overflow() || self_test_mul_unsigned_overflow() ||
 	    self_test_division() || self_test_malloc() ||
-	    self_test_nex_malloc() || self_test_va2pa() ||
+	    self_test_nex_malloc() || self_test_virt_lookup() ||
+	    self_test_mobj_ffa() || self_test_va2pa() ||
 	    self_test_asan()) {
 		EMSG("some self_test_xxx failed! you should enable local LOG");
 		return TEE_ERROR_GENERIC;
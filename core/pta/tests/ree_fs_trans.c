@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+#include <pta_invoke_tests.h>
+#include <string.h>
+#include <tee/tee_fs.h>
+#include <tee/tee_pobj.h>
+#include <trace.h>
+#include <types_ext.h>
+
+#include "misc.h"
+
+/*
+ * Tests of the write transactions of the REE FS, begin_writes() and
+ * commit_writes(), on an object stored with tee-supplicant under the UUID
+ * of this pseudo TA.
+ */
+
+static const char test_data_old[] = "0123456789";
+static const char test_data_new[] = "abcdefghijklmno";
+
+#define TEST_TRUNC_LEN	12
+
+#define CHECK(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			EMSG("check failed: %s", #cond);		\
+			res = TEE_ERROR_GENERIC;			\
+			goto out;					\
+		}							\
+	} while (0)
+
+#define CHECK_RES(expr)							\
+	do {								\
+		res = (expr);						\
+		if (res) {						\
+			EMSG("%s: %#"PRIx32, #expr, res);		\
+			goto out;					\
+		}							\
+	} while (0)
+
+/* Checks that the object of @po holds the @len first bytes of @data */
+static TEE_Result check_data(struct tee_pobj *po, const char *data,
+			     size_t len)
+{
+	struct tee_file_handle *fh = NULL;
+	char buf[sizeof(test_data_new)] = { };
+	size_t buf_len = sizeof(buf);
+	TEE_Result res = TEE_SUCCESS;
+	size_t size = 0;
+
+	CHECK_RES(ree_fs_ops.open(po, &size, &fh));
+	CHECK_RES(ree_fs_ops.read(fh, 0, buf, NULL, &buf_len));
+	CHECK(size == len && buf_len == len && !memcmp(buf, data, len));
+out:
+	ree_fs_ops.close(&fh);
+
+	return res;
+}
+
+TEE_Result core_ree_fs_trans_tests(void)
+{
+	char oid[] = "ree_fs_trans_test";
+	struct tee_pobj po = {
+		.uuid = PTA_INVOKE_TESTS_UUID,
+		.obj_id = oid,
+		.obj_id_len = sizeof(oid) - 1,
+		.fops = &ree_fs_ops,
+	};
+	struct tee_file_handle *fh = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	CHECK_RES(ree_fs_ops.create(&po, true, NULL, 0, NULL, 0,
+				    test_data_old, NULL,
+				    strlen(test_data_old), &fh));
+
+	/* Changes not committed when the object is closed are discarded */
+	CHECK_RES(ree_fs_ops.begin_writes(fh));
+	CHECK(ree_fs_ops.begin_writes(fh) == TEE_ERROR_BAD_STATE);
+	CHECK_RES(ree_fs_ops.write(fh, 0, test_data_new, NULL,
+				   strlen(test_data_new)));
+	ree_fs_ops.close(&fh);
+	CHECK_RES(check_data(&po, test_data_old, strlen(test_data_old)));
+
+	/* Committed changes, including a truncation, are kept */
+	CHECK_RES(ree_fs_ops.open(&po, NULL, &fh));
+	CHECK(ree_fs_ops.commit_writes(fh) == TEE_ERROR_BAD_STATE);
+	CHECK_RES(ree_fs_ops.begin_writes(fh));
+	CHECK_RES(ree_fs_ops.write(fh, 0, test_data_new, NULL,
+				   strlen(test_data_new)));
+	CHECK_RES(ree_fs_ops.truncate(fh, TEST_TRUNC_LEN));
+	CHECK_RES(ree_fs_ops.commit_writes(fh));
+	ree_fs_ops.close(&fh);
+	CHECK_RES(check_data(&po, test_data_new, TEST_TRUNC_LEN));
+
+out:
+	ree_fs_ops.close(&fh);
+	ree_fs_ops.remove(&po);
+
+	return res;
+}
@@ -1,4 +1,6 @@
 srcs-$(call cfg-all-enabled,CFG_REE_FS CFG_WITH_USER_TA) += fs_htree.c
+srcs-$(call cfg-all-enabled,CFG_REE_FS CFG_WITH_USER_TA) += fs_dirfile.c
+srcs-$(call cfg-all-enabled,CFG_REE_FS CFG_WITH_USER_TA) += ree_fs_trans.c
 srcs-y += invoke.c
 srcs-$(CFG_LOCKDEP) += lockdep.c
 srcs-y += misc.c
@@ -10,13 +10,53 @@
 #include <string.h>
 #include <tee/fs_dirfile.h>
 #include <types_ext.h>
+#include <util.h>
 
+/*
+ * struct dirfile_index - in-memory index of an entry in the dirfile
+ * @key_hash:	hash of the UUID and object ID of the entry
+ * @uuid_hash:	hash of the UUID of the entry
+ * @next:	index of the next entry in the same bucket, -1 if last
+ */
+struct dirfile_index {
+	uint32_t key_hash;
+	uint32_t uuid_hash;
+	int next;
+};
+
+/*
+ * struct tee_fs_dirfile_dirh - dirfile handle
+ * @fops:	file interface
+ * @fh:		handle of the underlying file
+ * @nbits:	number of bits in @files
+ * @files:	bitmap of file numbers in use, bit 0 is @first_number
+ * @first_number: first file number allocated by this dirfile
+ * @num_numbers: number of file numbers allocated by this dirfile
+ * @ndents:	number of entries in the dirfile, including free entries
+ * @index:	index of each entry, valid if the bit in @used is set
+ * @index_size:	number of elements in @index and bits in @used
+ * @used:	bitmap of entries holding an object
+ * @buckets:	hash table of entries, chained with dirfile_index.next
+ * @nbuckets:	number of elements in @buckets, a power of two
+ *
+ * The index allows finding an object, a free entry or the next object of
+ * a TA without reading each entry of the dirfile, which would go through
+ * the hash tree of the file for every entry. Only entries with a matching
+ * hash are read to confirm a match.
+ */
 struct tee_fs_dirfile_dirh {
 	const struct tee_fs_dirfile_operations *fops;
 	struct tee_file_handle *fh;
 	int nbits;
 	bitstr_t *files;
+	uint32_t first_number;
+	uint32_t num_numbers;
 	size_t ndents;
+	struct dirfile_index *index;
+	size_t index_size;
+	bitstr_t *used;
+	int *buckets;
+	size_t nbuckets;
 };
 
 struct dirfile_entry {
@@ -41,6 +81,123 @@ static bool is_free(struct dirfile_entry *dent)
 	return !dent->oidlen && !dent->oid[0];
 }
 
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t n = 0;
+
+	for (n = 0; n < len; n++)
+		h = (h ^ p[n]) * 0x01000193;
+
+	return h;
+}
+
+static uint32_t uuid_hash(const TEE_UUID *uuid)
+{
+	return fnv1a(0x811c9dc5, uuid, sizeof(*uuid));
+}
+
+static uint32_t key_hash(uint32_t uuid_h, const void *oid, size_t oidlen)
+{
+	return fnv1a(uuid_h, oid, oidlen);
+}
+
+static int *index_bucket(struct tee_fs_dirfile_dirh *dirh, uint32_t key_h)
+{
+	return dirh->buckets + (key_h & (dirh->nbuckets - 1));
+}
+
+static void index_add(struct tee_fs_dirfile_dirh *dirh, int idx,
+		      const struct dirfile_entry *dent)
+{
+	struct dirfile_index *di = dirh->index + idx;
+	int *bucket = NULL;
+
+	assert((size_t)idx < dirh->index_size);
+	assert(!bit_test(dirh->used, idx));
+
+	di->uuid_hash = uuid_hash(&dent->uuid);
+	di->key_hash = key_hash(di->uuid_hash, dent->oid, dent->oidlen);
+	bucket = index_bucket(dirh, di->key_hash);
+	di->next = *bucket;
+	*bucket = idx;
+	bit_set(dirh->used, idx);
+}
+
+static void index_del(struct tee_fs_dirfile_dirh *dirh, int idx)
+{
+	int *p = NULL;
+
+	if ((size_t)idx >= dirh->index_size || !bit_test(dirh->used, idx))
+		return;
+
+	for (p = index_bucket(dirh, dirh->index[idx].key_hash); *p != idx;
+	     p = &dirh->index[*p].next)
+		assert(*p >= 0);
+	*p = dirh->index[idx].next;
+	bit_clear(dirh->used, idx);
+}
+
+static void index_rehash(struct tee_fs_dirfile_dirh *dirh)
+{
+	int *bucket = NULL;
+	size_t n = 0;
+
+	for (n = 0; n < dirh->nbuckets; n++)
+		dirh->buckets[n] = -1;
+
+	for (n = 0; n < dirh->index_size; n++) {
+		if (!bit_test(dirh->used, n))
+			continue;
+		bucket = index_bucket(dirh, dirh->index[n].key_hash);
+		dirh->index[n].next = *bucket;
+		*bucket = n;
+	}
+}
+
+/*
+ * Makes room in the index for entry @idx. Called before the entry is
+ * written so that updating the index afterwards can't fail.
+ */
+static TEE_Result index_reserve(struct tee_fs_dirfile_dirh *dirh, int idx)
+{
+	size_t nbuckets = dirh->nbuckets;
+	size_t sz = dirh->index_size;
+	void *p = NULL;
+
+	if ((size_t)idx < sz)
+		return TEE_SUCCESS;
+
+	sz = MAX(sz * 2, (size_t)idx + 1);
+	sz = MAX(sz, 32U);
+
+	p = realloc(dirh->index, sz * sizeof(*dirh->index));
+	if (!p)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	dirh->index = p;
+
+	p = realloc(dirh->used, bitstr_size(sz));
+	if (!p)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	dirh->used = p;
+	bit_nclear(dirh->used, dirh->index_size, sz - 1);
+	dirh->index_size = sz;
+
+	/* Keep on average at most two entries per bucket */
+	while (nbuckets * 2 < sz)
+		nbuckets = MAX(nbuckets * 2, 16U);
+	if (nbuckets != dirh->nbuckets) {
+		p = realloc(dirh->buckets, nbuckets * sizeof(*dirh->buckets));
+		if (!p)
+			return TEE_ERROR_OUT_OF_MEMORY;
+		dirh->buckets = p;
+		dirh->nbuckets = nbuckets;
+		index_rehash(dirh);
+	}
+
+	return TEE_SUCCESS;
+}
+
 /*
  * File layout
  *
@@ -49,8 +206,18 @@ static bool is_free(struct dirfile_entry *dent)
  * dirfile_entry.n
  *
  * where n the index is disconnected from file_number in struct dirfile_entry
+ *
+ * Only file numbers in the range of the dirfile are tracked in
+ * dirh->files. An entry may refer to a file number outside the range,
+ * such a number was allocated elsewhere and is never handed out by
+ * tee_fs_dirfile_get_tmp().
  */
 
+static bool is_tracked(struct tee_fs_dirfile_dirh *dirh, uint32_t file_number)
+{
+	return file_number - dirh->first_number < dirh->num_numbers;
+}
+
 static TEE_Result maybe_grow_files(struct tee_fs_dirfile_dirh *dirh, int idx)
 {
 	void *p;
@@ -69,24 +236,37 @@ static TEE_Result maybe_grow_files(struct tee_fs_dirfile_dirh *dirh, int idx)
 	return TEE_SUCCESS;
 }
 
-static TEE_Result set_file(struct tee_fs_dirfile_dirh *dirh, int idx)
+static TEE_Result set_file(struct tee_fs_dirfile_dirh *dirh,
+			   uint32_t file_number)
 {
-	TEE_Result res = maybe_grow_files(dirh, idx);
+	int idx = file_number - dirh->first_number;
+	TEE_Result res = TEE_SUCCESS;
 
+	if (!is_tracked(dirh, file_number))
+		return TEE_SUCCESS;
+
+	res = maybe_grow_files(dirh, idx);
 	if (!res)
 		bit_set(dirh->files, idx);
 
 	return res;
 }
 
-static void clear_file(struct tee_fs_dirfile_dirh *dirh, int idx)
+static void clear_file(struct tee_fs_dirfile_dirh *dirh, uint32_t file_number)
 {
-	if (idx < dirh->nbits)
+	int idx = file_number - dirh->first_number;
+
+	if (is_tracked(dirh, file_number) && idx < dirh->nbits)
 		bit_clear(dirh->files, idx);
 }
 
-static bool test_file(struct tee_fs_dirfile_dirh *dirh, int idx)
+/* File numbers outside the range of the dirfile are assumed to be in use */
+static bool test_file(struct tee_fs_dirfile_dirh *dirh, uint32_t file_number)
 {
+	int idx = file_number - dirh->first_number;
+
+	if (!is_tracked(dirh, file_number))
+		return true;
 	if (idx < dirh->nbits)
 		return bit_test(dirh->files, idx);
 
@@ -121,9 +301,12 @@ static TEE_Result write_dent(struct tee_fs_dirfile_dirh *dirh, size_t n,
 	return res;
 }
 
-TEE_Result tee_fs_dirfile_open(bool create, uint8_t *hash, uint32_t min_counter,
-			       const struct tee_fs_dirfile_operations *fops,
-			       struct tee_fs_dirfile_dirh **dirh_ret)
+TEE_Result
+tee_fs_dirfile_open_numbered(bool create, uint8_t *hash, uint32_t min_counter,
+			     struct tee_fs_dirfile_fileh *dfh,
+			     uint32_t first_number, uint32_t num_numbers,
+			     const struct tee_fs_dirfile_operations *fops,
+			     struct tee_fs_dirfile_dirh **dirh_ret)
 {
 	TEE_Result res;
 	struct tee_fs_dirfile_dirh *dirh = calloc(1, sizeof(*dirh));
@@ -133,7 +316,9 @@ TEE_Result tee_fs_dirfile_open(bool create, uint8_t *hash, uint32_t min_counter,
 		return TEE_ERROR_OUT_OF_MEMORY;
 
 	dirh->fops = fops;
-	res = fops->open(create, hash, min_counter, NULL, NULL, &dirh->fh);
+	dirh->first_number = first_number;
+	dirh->num_numbers = num_numbers;
+	res = fops->open(create, hash, min_counter, NULL, dfh, &dirh->fh);
 	if (res)
 		goto out;
 
@@ -147,10 +332,15 @@ TEE_Result tee_fs_dirfile_open(bool create, uint8_t *hash, uint32_t min_counter,
 			goto out;
 		}
 
+		res = index_reserve(dirh, n);
+		if (res)
+			goto out;
+
 		if (is_free(&dent))
 			continue;
 
-		if (test_file(dirh, dent.file_number)) {
+		if (is_tracked(dirh, dent.file_number) &&
+		    test_file(dirh, dent.file_number)) {
 			DMSG("clearing duplicate file number %" PRIu32,
 			     dent.file_number);
 			memset(&dent, 0, sizeof(dent));
@@ -163,6 +353,8 @@ TEE_Result tee_fs_dirfile_open(bool create, uint8_t *hash, uint32_t min_counter,
 		res = set_file(dirh, dent.file_number);
 		if (res != TEE_SUCCESS)
 			goto out;
+
+		index_add(dirh, n, &dent);
 	}
 out:
 	if (!res) {
@@ -174,11 +366,22 @@ out:
 	return res;
 }
 
+TEE_Result tee_fs_dirfile_open(bool create, uint8_t *hash, uint32_t min_counter,
+			       const struct tee_fs_dirfile_operations *fops,
+			       struct tee_fs_dirfile_dirh **dirh)
+{
+	return tee_fs_dirfile_open_numbered(create, hash, min_counter, NULL, 0,
+					    UINT32_MAX, fops, dirh);
+}
+
 void tee_fs_dirfile_close(struct tee_fs_dirfile_dirh *dirh)
 {
 	if (dirh) {
 		dirh->fops->close(dirh->fh);
 		free(dirh->files);
+		free(dirh->index);
+		free(dirh->used);
+		free(dirh->buckets);
 		free(dirh);
 	}
 }
@@ -200,10 +403,12 @@ TEE_Result tee_fs_dirfile_get_tmp(struct tee_fs_dirfile_dirh *dirh,
 		if (i == -1)
 			i = dirh->nbits;
 	}
+	if ((uint32_t)i >= dirh->num_numbers)
+		return TEE_ERROR_STORAGE_NO_SPACE;
 
-	res = set_file(dirh, i);
+	res = set_file(dirh, dirh->first_number + i);
 	if (!res)
-		dfh->file_number = i;
+		dfh->file_number = dirh->first_number + i;
 
 	return res;
 }
@@ -214,15 +419,23 @@ TEE_Result tee_fs_dirfile_find(struct tee_fs_dirfile_dirh *dirh,
 {
 	TEE_Result res = TEE_SUCCESS;
 	struct dirfile_entry dent = { };
-	int n = 0;
+	uint32_t key_h = 0;
+	int n = -1;
+
+	if (!dirh->nbuckets)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	key_h = key_hash(uuid_hash(uuid), oid, oidlen);
+	for (n = *index_bucket(dirh, key_h); n >= 0;
+	     n = dirh->index[n].next) {
+		if (dirh->index[n].key_hash != key_h)
+			continue;
 
-	for (n = 0;; n++) {
 		res = read_dent(dirh, n, &dent);
 		if (res)
 			return res;
 
-		if (is_free(&dent))
-			continue;
+		assert(!is_free(&dent));
 		if (dent.oidlen != oidlen)
 			continue;
 
@@ -233,6 +446,9 @@ TEE_Result tee_fs_dirfile_find(struct tee_fs_dirfile_dirh *dirh,
 			break;
 	}
 
+	if (n < 0)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
 	if (dfh) {
 		dfh->idx = n;
 		dfh->file_number = dent.file_number;
@@ -244,19 +460,14 @@ TEE_Result tee_fs_dirfile_find(struct tee_fs_dirfile_dirh *dirh,
 
 static TEE_Result find_empty_idx(struct tee_fs_dirfile_dirh *dh, int *idx)
 {
-	struct dirfile_entry dent = { };
-	TEE_Result res = TEE_SUCCESS;
-	int n = 0;
+	int n = -1;
 
-	for (n = 0;; n++) {
-		res = read_dent(dh, n, &dent);
-		if (res == TEE_ERROR_ITEM_NOT_FOUND)
-			break;
-		if (res)
-			return res;
-		if (is_free(&dent))
-			break;
-	}
+	/* All entries up to dh->ndents have room in the index */
+	assert(dh->ndents <= dh->index_size);
+	if (dh->ndents)
+		bit_ffc(dh->used, (int)dh->ndents, &n);
+	if (n < 0)
+		n = dh->ndents;
 
 	*idx = n;
 	return TEE_SUCCESS;
@@ -317,7 +528,17 @@ TEE_Result tee_fs_dirfile_rename(struct tee_fs_dirfile_dirh *dirh,
 		dfh->idx = dfh2.idx;
 	}
 
-	return write_dent(dirh, dfh->idx, &dent);
+	res = index_reserve(dirh, dfh->idx);
+	if (res)
+		return res;
+
+	res = write_dent(dirh, dfh->idx, &dent);
+	if (!res) {
+		index_del(dirh, dfh->idx);
+		index_add(dirh, dfh->idx, &dent);
+	}
+
+	return res;
 }
 
 TEE_Result tee_fs_dirfile_remove(struct tee_fs_dirfile_dirh *dirh,
@@ -340,8 +561,10 @@ TEE_Result tee_fs_dirfile_remove(struct tee_fs_dirfile_dirh *dirh,
 
 	memset(&dent, 0, sizeof(dent));
 	res = write_dent(dirh, dfh->idx, &dent);
-	if (!res)
+	if (!res) {
+		index_del(dirh, dfh->idx);
 		clear_file(dirh, file_number);
+	}
 
 	return res;
 }
@@ -370,11 +593,18 @@ TEE_Result tee_fs_dirfile_get_next(struct tee_fs_dirfile_dirh *dirh,
 	TEE_Result res;
 	int i = *idx + 1;
 	struct dirfile_entry dent = { };
+	uint32_t uuid_h = uuid_hash(uuid);
 
 	if (i < 0)
 		i = 0;
 
 	for (;; i++) {
+		if ((size_t)i >= dirh->ndents)
+			return TEE_ERROR_ITEM_NOT_FOUND;
+		if (!bit_test(dirh->used, i) ||
+		    dirh->index[i].uuid_hash != uuid_h)
+			continue;
+
 		res = read_dent(dirh, i, &dent);
 		if (res)
 			return res;
@@ -392,3 +622,102 @@ TEE_Result tee_fs_dirfile_get_next(struct tee_fs_dirfile_dirh *dirh,
 
 	return TEE_SUCCESS;
 }
+
+TEE_Result tee_fs_dirfile_get_next_any(struct tee_fs_dirfile_dirh *dirh,
+				       int *idx, TEE_UUID *uuid, void *oid,
+				       size_t *oidlen,
+				       struct tee_fs_dirfile_fileh *dfh)
+{
+	TEE_Result res;
+	int i = *idx + 1;
+	struct dirfile_entry dent = { };
+
+	if (i < 0)
+		i = 0;
+
+	for (;; i++) {
+		if ((size_t)i >= dirh->ndents)
+			return TEE_ERROR_ITEM_NOT_FOUND;
+		if (bit_test(dirh->used, i))
+			break;
+	}
+
+	res = read_dent(dirh, i, &dent);
+	if (res)
+		return res;
+	assert(!is_free(&dent));
+
+	if (*oidlen < dent.oidlen)
+		return TEE_ERROR_SHORT_BUFFER;
+
+	*uuid = dent.uuid;
+	memcpy(oid, dent.oid, dent.oidlen);
+	*oidlen = dent.oidlen;
+	dfh->idx = i;
+	dfh->file_number = dent.file_number;
+	memcpy(dfh->hash, dent.hash, sizeof(dent.hash));
+	*idx = i;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result tee_fs_dirfile_copy_entries(struct tee_fs_dirfile_dirh *src,
+				       struct tee_fs_dirfile_dirh *dst,
+				       bool (*select)(const TEE_UUID *uuid,
+						      void *arg),
+				       void *arg, size_t *count)
+{
+	struct tee_fs_dirfile_fileh dfh = { };
+	uint8_t oid[TEE_OBJECT_ID_MAX_LEN] = { };
+	size_t oidlen = 0;
+	TEE_UUID uuid = { };
+	TEE_Result res = TEE_SUCCESS;
+	int idx = -1;
+
+	while (true) {
+		oidlen = sizeof(oid);
+		res = tee_fs_dirfile_get_next_any(src, &idx, &uuid, oid,
+						  &oidlen, &dfh);
+		if (res == TEE_ERROR_ITEM_NOT_FOUND)
+			return TEE_SUCCESS;
+		if (res)
+			return res;
+		if (!select(&uuid, arg))
+			continue;
+
+		dfh.idx = -1;
+		res = tee_fs_dirfile_rename(dst, &uuid, &dfh, oid, oidlen);
+		if (res)
+			return res;
+		(*count)++;
+	}
+}
+
+TEE_Result tee_fs_dirfile_remove_entries(struct tee_fs_dirfile_dirh *dirh,
+					 bool (*select)(const TEE_UUID *uuid,
+							void *arg),
+					 void *arg)
+{
+	struct tee_fs_dirfile_fileh dfh = { };
+	uint8_t oid[TEE_OBJECT_ID_MAX_LEN] = { };
+	size_t oidlen = 0;
+	TEE_UUID uuid = { };
+	TEE_Result res = TEE_SUCCESS;
+	int idx = -1;
+
+	while (true) {
+		oidlen = sizeof(oid);
+		res = tee_fs_dirfile_get_next_any(dirh, &idx, &uuid, oid,
+						  &oidlen, &dfh);
+		if (res == TEE_ERROR_ITEM_NOT_FOUND)
+			return TEE_SUCCESS;
+		if (res)
+			return res;
+		if (!select(&uuid, arg))
+			continue;
+
+		res = tee_fs_dirfile_remove(dirh, &dfh);
+		if (res)
+			return res;
+	}
+}
@@ -9,15 +9,102 @@
 #include <kernel/user_access.h>
 #include <optee_rpc_cmd.h>
 #include <pta_socket.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/queue.h>
 #include <tee/tee_fs_rpc.h>
+#include <__tee_tcpsocket_defines.h>
+
+#define RECV_BUF_SIZE	CFG_GP_SOCKETS_RECV_BUF_SIZE
+
+/*
+ * struct socket_recv_buf - Read-ahead buffer of a TCP socket
+ * @link:	Link in the list of the session
+ * @handle:	Socket handle
+ * @data:	Data received ahead, in secure memory
+ * @size:	Size of @data
+ * @rd:		Offset of the first byte not yet passed to the TA
+ * @wr:		Offset past the last byte received
+ *
+ * tee-supplicant receives into shared memory, which normal world can
+ * modify at any time. The received bytes are copied to @data once so that
+ * the TA gets the same content however it splits its receives.
+ */
+struct socket_recv_buf {
+	SLIST_ENTRY(socket_recv_buf) link;
+	uint32_t handle;
+	uint8_t *data;
+	size_t size;
+	size_t rd;
+	size_t wr;
+};
+
+/*
+ * struct socket_sess - Session of a TA with the socket pseudo TA
+ * @instance_id:	TA instance id, identifies the TA to tee-supplicant
+ * @recv_bufs:		Read-ahead buffers of the sockets of the TA
+ */
+struct socket_sess {
+	uint32_t instance_id;
+	SLIST_HEAD(, socket_recv_buf) recv_bufs;
+};
 
 static uint32_t get_instance_id(struct ts_session *sess)
 {
 	return sess->ctx->ops->get_instance_id(sess->ctx);
 }
 
-static TEE_Result socket_open(uint32_t instance_id, uint32_t param_types,
+static struct socket_recv_buf *find_recv_buf(struct socket_sess *sess,
+					     uint32_t handle)
+{
+	struct socket_recv_buf *rb = NULL;
+
+	SLIST_FOREACH(rb, &sess->recv_bufs, link)
+		if (rb->handle == handle)
+			return rb;
+
+	return NULL;
+}
+
+/*
+ * TCP is a byte stream so data received ahead of what the TA asked for
+ * can be kept for the next receive. That's not the case with datagrams.
+ */
+static void add_recv_buf(struct socket_sess *sess, uint32_t handle,
+			 uint32_t protocol)
+{
+	struct socket_recv_buf *rb = NULL;
+
+	if (!RECV_BUF_SIZE || protocol != TEE_ISOCKET_PROTOCOLID_TCP)
+		return;
+
+	rb = calloc(1, sizeof(*rb));
+	if (!rb)
+		goto err;
+
+	rb->data = malloc(RECV_BUF_SIZE);
+	if (!rb->data)
+		goto err;
+
+	rb->size = RECV_BUF_SIZE;
+	rb->handle = handle;
+	SLIST_INSERT_HEAD(&sess->recv_bufs, rb, link);
+	return;
+err:
+	/* Receives on this socket go directly to the TA buffer instead */
+	DMSG("No read-ahead buffer for socket %#"PRIx32, handle);
+	free(rb);
+}
+
+static void free_recv_buf(struct socket_sess *sess,
+			  struct socket_recv_buf *rb)
+{
+	SLIST_REMOVE(&sess->recv_bufs, rb, socket_recv_buf, link);
+	free(rb->data);
+	free(rb);
+}
+
+static TEE_Result socket_open(struct socket_sess *sess, uint32_t param_types,
 			      TEE_Param params[TEE_NUM_PARAMS])
 {
 	struct thread_param tpm[4] = { };
@@ -46,7 +133,8 @@ static TEE_Result socket_open(uint32_t instance_id, uint32_t param_types,
 	if (res)
 		return res;
 
-	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_OPEN, instance_id, 0);
+	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_OPEN,
+				    sess->instance_id, 0);
 	tpm[1] = THREAD_PARAM_VALUE(IN,
 				    params[0].value.b, /* server port number */
 				    params[2].value.a, /* protocol */
@@ -55,15 +143,18 @@ static TEE_Result socket_open(uint32_t instance_id, uint32_t param_types,
 	tpm[3] = THREAD_PARAM_VALUE(OUT, 0, 0, 0);
 
 	res = thread_rpc_cmd(OPTEE_RPC_CMD_SOCKET, 4, tpm);
-	if (res == TEE_SUCCESS)
+	if (res == TEE_SUCCESS) {
 		params[3].value.a = tpm[3].u.value.a;
+		add_recv_buf(sess, params[3].value.a, params[2].value.a);
+	}
 
 	return res;
 }
 
-static TEE_Result socket_close(uint32_t instance_id, uint32_t param_types,
+static TEE_Result socket_close(struct socket_sess *sess, uint32_t param_types,
 			       TEE_Param params[TEE_NUM_PARAMS])
 {
+	struct socket_recv_buf *rb = NULL;
 	struct thread_param tpm = { };
 	uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
 					  TEE_PARAM_TYPE_NONE,
@@ -76,13 +167,17 @@ static TEE_Result socket_close(uint32_t instance_id, uint32_t param_types,
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
-	tpm = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_CLOSE, instance_id,
+	tpm = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_CLOSE, sess->instance_id,
 				 params[0].value.a);
 
+	rb = find_recv_buf(sess, params[0].value.a);
+	if (rb)
+		free_recv_buf(sess, rb);
+
 	return thread_rpc_cmd(OPTEE_RPC_CMD_SOCKET, 1, &tpm);
 }
 
-static TEE_Result socket_send(uint32_t instance_id, uint32_t param_types,
+static TEE_Result socket_send(struct socket_sess *sess, uint32_t param_types,
 			      TEE_Param params[TEE_NUM_PARAMS])
 {
 	struct thread_param tpm[3] = { };
@@ -111,7 +206,8 @@ static TEE_Result socket_send(uint32_t instance_id, uint32_t param_types,
 	if (res)
 		return res;
 
-	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_SEND, instance_id,
+	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_SEND,
+				    sess->instance_id,
 				    params[0].value.a /* handle */);
 	tpm[1] = THREAD_PARAM_MEMREF(IN, mobj, 0, params[1].memref.size);
 	tpm[2] = THREAD_PARAM_VALUE(INOUT, params[0].value.b, /* timeout */
@@ -123,9 +219,61 @@ static TEE_Result socket_send(uint32_t instance_id, uint32_t param_types,
 	return res;
 }
 
-static TEE_Result socket_recv(uint32_t instance_id, uint32_t param_types,
+/*
+ * Receives into the read-ahead buffer of the socket once it's consumed and
+ * passes its content to the TA, a receive of a few bytes at a time then
+ * only needs an RPC when the buffer runs empty. Like with a direct
+ * receive, tee-supplicant returns what is available, at most the size of
+ * the buffer, and only waits for the timeout if nothing is.
+ */
+static TEE_Result recv_buffered(struct socket_sess *sess,
+				struct socket_recv_buf *rb,
+				TEE_Param params[TEE_NUM_PARAMS])
+{
+	struct thread_param tpm[3] = { };
+	TEE_Result res = TEE_SUCCESS;
+	struct mobj *mobj = NULL;
+	void *va = NULL;
+	size_t n = 0;
+
+	if (rb->rd == rb->wr) {
+		va = thread_rpc_shm_cache_alloc(THREAD_SHM_CACHE_USER_SOCKET,
+						THREAD_SHM_TYPE_APPLICATION,
+						rb->size, &mobj);
+		if (!va)
+			return TEE_ERROR_OUT_OF_MEMORY;
+
+		tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_RECV,
+					    sess->instance_id, rb->handle);
+		tpm[1] = THREAD_PARAM_MEMREF(OUT, mobj, 0, rb->size);
+		tpm[2] = THREAD_PARAM_VALUE(IN,
+					    params[0].value.b /* timeout */,
+					    0, 0);
+
+		res = thread_rpc_cmd(OPTEE_RPC_CMD_SOCKET, 3, tpm);
+		if (res) {
+			params[1].memref.size = 0;
+			return res;
+		}
+		rb->rd = 0;
+		rb->wr = MIN(tpm[1].u.memref.size, rb->size);
+		memcpy(rb->data, va, rb->wr);
+	}
+
+	n = MIN(params[1].memref.size, rb->wr - rb->rd);
+	res = copy_to_user(params[1].memref.buffer, rb->data + rb->rd, n);
+	if (res)
+		return res;
+	rb->rd += n;
+	params[1].memref.size = n;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result socket_recv(struct socket_sess *sess, uint32_t param_types,
 			      TEE_Param params[TEE_NUM_PARAMS])
 {
+	struct socket_recv_buf *rb = NULL;
 	struct thread_param tpm[3] = { };
 	struct mobj *mobj = NULL;
 	TEE_Result res = TEE_SUCCESS;
@@ -141,6 +289,15 @@ static TEE_Result socket_recv(uint32_t instance_id, uint32_t param_types,
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
+	/*
+	 * Receives at least as large as the read-ahead buffer bypass it
+	 * once it's consumed.
+	 */
+	rb = find_recv_buf(sess, params[0].value.a);
+	if (rb && params[1].memref.size &&
+	    (rb->rd != rb->wr || params[1].memref.size < rb->size))
+		return recv_buffered(sess, rb, params);
+
 	if (params[1].memref.size) {
 		va = thread_rpc_shm_cache_alloc(THREAD_SHM_CACHE_USER_SOCKET,
 						THREAD_SHM_TYPE_APPLICATION,
@@ -149,7 +306,8 @@ static TEE_Result socket_recv(uint32_t instance_id, uint32_t param_types,
 			return TEE_ERROR_OUT_OF_MEMORY;
 	}
 
-	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_RECV, instance_id,
+	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_RECV,
+				    sess->instance_id,
 				    params[0].value.a /* handle */);
 	tpm[1] = THREAD_PARAM_MEMREF(OUT, mobj, 0, params[1].memref.size);
 	tpm[2] = THREAD_PARAM_VALUE(IN, params[0].value.b /* timeout */, 0, 0);
@@ -170,7 +328,7 @@ static TEE_Result socket_recv(uint32_t instance_id, uint32_t param_types,
 	return res;
 }
 
-static TEE_Result socket_ioctl(uint32_t instance_id, uint32_t param_types,
+static TEE_Result socket_ioctl(struct socket_sess *sess, uint32_t param_types,
 			       TEE_Param params[TEE_NUM_PARAMS])
 {
 	struct thread_param tpm[3] = { };
@@ -199,7 +357,8 @@ static TEE_Result socket_ioctl(uint32_t instance_id, uint32_t param_types,
 	if (res)
 		return res;
 
-	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_IOCTL, instance_id,
+	tpm[0] = THREAD_PARAM_VALUE(IN, OPTEE_RPC_SOCKET_IOCTL,
+				    sess->instance_id,
 				    params[0].value.a /* handle */);
 	tpm[1] = THREAD_PARAM_MEMREF(INOUT, mobj, 0, params[1].memref.size);
 	tpm[2] = THREAD_PARAM_VALUE(IN, params[0].value.b /* ioctl command */,
@@ -220,7 +379,7 @@ static TEE_Result socket_ioctl(uint32_t instance_id, uint32_t param_types,
 	return res;
 }
 
-typedef TEE_Result (*ta_func)(uint32_t instance_id, uint32_t param_types,
+typedef TEE_Result (*ta_func)(struct socket_sess *sess, uint32_t param_types,
 			      TEE_Param params[TEE_NUM_PARAMS]);
 
 static const ta_func ta_funcs[] = {
@@ -240,35 +399,47 @@ static TEE_Result pta_socket_open_session(uint32_t param_types __unused,
 			void **sess_ctx)
 {
 	struct ts_session *s = ts_get_calling_session();
+	struct socket_sess *sess = NULL;
 
 	/* Check that we're called from a TA */
 	if (!s || !is_user_ta_ctx(s->ctx))
 		return TEE_ERROR_ACCESS_DENIED;
 
-	*sess_ctx = (void *)(vaddr_t)get_instance_id(s);
+	sess = calloc(1, sizeof(*sess));
+	if (!sess)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	sess->instance_id = get_instance_id(s);
+	SLIST_INIT(&sess->recv_bufs);
+	*sess_ctx = sess;
 
 	return TEE_SUCCESS;
 }
 
 static void pta_socket_close_session(void *sess_ctx)
 {
+	struct socket_sess *sess = sess_ctx;
 	TEE_Result res;
 	struct thread_param tpm = {
 		.attr = THREAD_PARAM_ATTR_VALUE_IN, .u.value = {
-			.a = OPTEE_RPC_SOCKET_CLOSE_ALL, .b = (vaddr_t)sess_ctx,
+			.a = OPTEE_RPC_SOCKET_CLOSE_ALL, .b = sess->instance_id,
 		},
 	};
 
 	res = thread_rpc_cmd(OPTEE_RPC_CMD_SOCKET, 1, &tpm);
 	if (res != TEE_SUCCESS)
 		DMSG("OPTEE_RPC_SOCKET_CLOSE_ALL failed: %#" PRIx32, res);
+
+	while (!SLIST_EMPTY(&sess->recv_bufs))
+		free_recv_buf(sess, SLIST_FIRST(&sess->recv_bufs));
+	free(sess);
 }
 
 static TEE_Result pta_socket_invoke_command(void *sess_ctx, uint32_t cmd_id,
 			uint32_t param_types, TEE_Param params[TEE_NUM_PARAMS])
 {
 	if (cmd_id < ARRAY_SIZE(ta_funcs) && ta_funcs[cmd_id])
-		return ta_funcs[cmd_id]((vaddr_t)sess_ctx, param_types, params);
+		return ta_funcs[cmd_id](sess_ctx, param_types, params);
 
 	return TEE_ERROR_NOT_IMPLEMENTED;
 }
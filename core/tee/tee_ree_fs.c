@@ -14,6 +14,7 @@
 #include <mm/core_memprot.h>
 #include <mm/tee_pager.h>
 #include <optee_rpc_cmd.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/queue.h>
@@ -30,15 +31,84 @@
 
 #define BLOCK_SIZE	(1 << BLOCK_SHIFT)
 
+/*
+ * struct tee_fs_fd - file handle
+ * @ht:		hash tree of the file
+ * @fd:		file descriptor of the REE file
+ * @dfh:	dirfile handle of the file
+ * @uuid:	UUID of the TA owning the file
+ * @write_back:	writes are committed by ree_fs_commit_writes() only
+ */
 struct tee_fs_fd {
 	struct tee_fs_htree *ht;
 	int fd;
 	struct tee_fs_dirfile_fileh dfh;
 	const TEE_UUID *uuid;
+	bool write_back;
 };
 
-struct tee_fs_dir {
+/*
+ * With CFG_REE_FS_DIRF_SHARDS > 0 the objects are listed in shard
+ * dirfiles, a TA is assigned to a shard based on a hash of its UUID. The
+ * root dirfile "dirf.db" lists the shard dirfiles. With
+ * CFG_REE_FS_INTEGRITY_RPMB the hash of each shard is stored in RPMB next
+ * to the hash of the root dirfile, which is then only updated when a
+ * shard is added or objects are moved to it. Otherwise the root dirfile
+ * remains the only dirfile with rollback protection and it's updated each
+ * time a shard is updated. A TA only has to wait for TAs using the same
+ * shard, except for these updates.
+ *
+ * Each dirfile allocates file numbers from its own range of SHARD_NUMBERS
+ * numbers. The root dirfile uses the range starting at 0, shard n the
+ * range starting at (n + 1) * SHARD_NUMBERS where the first number is the
+ * shard dirfile itself. Objects created before sharding was enabled are
+ * moved to their shard the first time the shard is opened, keeping their
+ * file numbers.
+ */
+#define NUM_SHARDS	CFG_REE_FS_DIRF_SHARDS
+#define SHARD_NUMBERS	BIT(24)
+
+static_assert(NUM_SHARDS < 256);
+
+/*
+ * struct ree_fs_dir - a dirfile and the lock serializing access to it
+ * @mutex:	protects the fields below and the files listed in the dirfile
+ * @dirh:	cached dirfile handle, see get_dirh()
+ * @refcount:	number of users of @dirh
+ * @migrated:	a shard has been checked for objects in the root dirfile
+ */
+struct ree_fs_dir {
+	struct mutex mutex;
 	struct tee_fs_dirfile_dirh *dirh;
+	size_t refcount;
+	bool migrated;
+};
+
+/* The root dirfile followed by the shards, if any */
+static struct ree_fs_dir ree_fs_dirs[NUM_SHARDS + 1] = {
+	[0 ... NUM_SHARDS] = { .mutex = MUTEX_INITIALIZER },
+};
+
+static struct ree_fs_dir *const ree_fs_root = ree_fs_dirs;
+
+static struct ree_fs_dir *uuid_to_dir(const TEE_UUID *uuid)
+{
+	const uint8_t *p = (const uint8_t *)uuid;
+	uint32_t h = 0x811c9dc5;
+	size_t n = 0;
+
+	if (!NUM_SHARDS)
+		return ree_fs_root;
+
+	/* FNV-1a */
+	for (n = 0; n < sizeof(*uuid); n++)
+		h = (h ^ p[n]) * 0x01000193;
+
+	return ree_fs_dirs + 1 + h % MAX(NUM_SHARDS, 1);
+}
+
+struct tee_fs_dir {
+	struct ree_fs_dir *dir;
 	int idx;
 	struct tee_fs_dirent d;
 	const TEE_UUID *uuid;
@@ -49,8 +119,6 @@ static int pos_to_block_num(int position)
 	return position >> BLOCK_SHIFT;
 }
 
-static struct mutex ree_fs_mutex = MUTEX_INITIALIZER;
-
 static void *get_tmp_block(void)
 {
 	return mempool_alloc(mempool_default, BLOCK_SIZE);
@@ -382,11 +450,13 @@ exit:
 static TEE_Result ree_fs_read(struct tee_file_handle *fh, size_t pos,
 			      void *buf_core, void *buf_user, size_t *len)
 {
+	struct tee_fs_fd *fdp = (struct tee_fs_fd *)fh;
+	struct ree_fs_dir *dir = uuid_to_dir(fdp->uuid);
 	TEE_Result res;
 
-	mutex_lock(&ree_fs_mutex);
+	mutex_lock(&dir->mutex);
 	res = ree_fs_read_primitive(fh, pos, buf_core, buf_user, len);
-	mutex_unlock(&ree_fs_mutex);
+	mutex_unlock(&dir->mutex);
 
 	return res;
 }
@@ -510,16 +580,18 @@ static const struct tee_fs_dirfile_operations ree_dirf_ops = {
 	.commit_writes = ree_dirf_commit_writes,
 };
 
-/*
- * ree_fs_dirh is caching the dirfile handle to avoid frequent opening and
- * closing of that handle. When ree_fs_dirh_refcount reaches 0, ree_fs_dirh
- * will be freed. However, ree_fs_dirh_refcount > 0 is not a guarantee that
- * ree_fs_dirh will not be freed, it may very well be freed earlier in an
- * error path. get_dirh() must be used to get the ree_fs_dirh pointer each
- * time it's needed if ree_fs_mutex has been unlocked in between.
- */
-static struct tee_fs_dirfile_dirh *ree_fs_dirh;
-static size_t ree_fs_dirh_refcount;
+static TEE_Result open_root_dirfile(bool create, uint8_t *hash,
+				    uint32_t min_counter,
+				    struct tee_fs_dirfile_dirh **dirh)
+{
+	uint32_t num_numbers = UINT32_MAX;
+
+	if (NUM_SHARDS)
+		num_numbers = SHARD_NUMBERS;
+
+	return tee_fs_dirfile_open_numbered(create, hash, min_counter, NULL, 0,
+					    num_numbers, &ree_dirf_ops, dirh);
+}
 
 #ifdef CFG_REE_FS_INTEGRITY_RPMB
 static struct tee_file_handle *ree_fs_rpmb_fh;
@@ -546,7 +618,7 @@ static TEE_Result open_dirh(struct tee_fs_dirfile_dirh **dirh)
 	if (res)
 		return res;
 
-	res = tee_fs_dirfile_open(false, hashp, 0, &ree_dirf_ops, dirh);
+	res = open_root_dirfile(false, hashp, 0, dirh);
 
 	if (res == TEE_ERROR_ITEM_NOT_FOUND) {
 		if (hashp) {
@@ -565,7 +637,7 @@ static TEE_Result open_dirh(struct tee_fs_dirfile_dirh **dirh)
 			}
 		}
 
-		res = tee_fs_dirfile_open(true, NULL, 0, &ree_dirf_ops, dirh);
+		res = open_root_dirfile(true, NULL, 0, dirh);
 	}
 
 out:
@@ -613,8 +685,7 @@ static TEE_Result open_dirh(struct tee_fs_dirfile_dirh **dirh)
 		}
 		min_counter = 0;
 	}
-	res = tee_fs_dirfile_open(false, NULL, min_counter, &ree_dirf_ops,
-				  dirh);
+	res = open_root_dirfile(false, NULL, min_counter, dirh);
 	if (res == TEE_ERROR_ITEM_NOT_FOUND) {
 		if (min_counter) {
 			if (!IS_ENABLED(CFG_REE_FS_ALLOW_RESET)) {
@@ -623,8 +694,7 @@ static TEE_Result open_dirh(struct tee_fs_dirfile_dirh **dirh)
 			}
 			DMSG("dirf.db not found, initializing with a non-zero monotonic counter");
 		}
-		return tee_fs_dirfile_open(true, NULL, min_counter,
-					   &ree_dirf_ops, dirh);
+		return open_root_dirfile(true, NULL, min_counter, dirh);
 	}
 
 	return res;
@@ -658,29 +728,319 @@ static void close_dirh(struct tee_fs_dirfile_dirh **dirh)
 }
 #endif /*!CFG_REE_FS_INTEGRITY_RPMB*/
 
-static TEE_Result get_dirh(struct tee_fs_dirfile_dirh **dirh)
+static TEE_Result get_dirh(struct ree_fs_dir *dir,
+			   struct tee_fs_dirfile_dirh **dirh);
+static void put_dirh_primitive(struct ree_fs_dir *dir, bool close);
+
+static const TEE_UUID shard_uuid;
+
+static uint32_t shard_file_number(struct ree_fs_dir *dir)
+{
+	return (dir - ree_fs_dirs) * SHARD_NUMBERS;
+}
+
+/* Finds the entry of the shard @dir in the root dirfile */
+static TEE_Result find_shard(struct tee_fs_dirfile_dirh *root_dirh,
+			     struct ree_fs_dir *dir, char *oid, size_t *oidlen,
+			     struct tee_fs_dirfile_fileh *dfh)
+{
+	int l = snprintf(oid, *oidlen, "dirf.db.%td", dir - ree_fs_dirs - 1);
+
+	if (l < 0 || (size_t)l >= *oidlen)
+		return TEE_ERROR_GENERIC;
+	*oidlen = l;
+
+	return tee_fs_dirfile_find(root_dirh, &shard_uuid, oid, l, dfh);
+}
+
+static bool in_shard(const TEE_UUID *uuid, void *dir)
+{
+	return memcmp(uuid, &shard_uuid, sizeof(*uuid)) &&
+	       uuid_to_dir(uuid) == dir;
+}
+
+/*
+ * Records the hash of the shard @dir in the root dirfile, removing the
+ * objects moved to the shard from the root dirfile if @migrated. Called
+ * with ree_fs_root->mutex held.
+ */
+static TEE_Result update_root(struct ree_fs_dir *dir, const uint8_t *hash,
+			      bool migrated)
+{
+	struct tee_fs_dirfile_fileh dfh = { .idx = -1 };
+	struct tee_fs_dirfile_dirh *root_dirh = NULL;
+	char oid[TEE_OBJECT_ID_MAX_LEN] = { };
+	size_t oidlen = sizeof(oid);
+	TEE_Result res = TEE_SUCCESS;
+
+	res = get_dirh(ree_fs_root, &root_dirh);
+	if (res)
+		return res;
+
+	res = find_shard(root_dirh, dir, oid, &oidlen, &dfh);
+	if (res && res != TEE_ERROR_ITEM_NOT_FOUND)
+		goto out;
+
+	memcpy(dfh.hash, hash, sizeof(dfh.hash));
+	if (res) {
+		dfh.file_number = shard_file_number(dir);
+		res = tee_fs_dirfile_rename(root_dirh, &shard_uuid, &dfh, oid,
+					    oidlen);
+	} else {
+		res = tee_fs_dirfile_update_hash(root_dirh, &dfh);
+	}
+	if (res)
+		goto out;
+
+	/* The files are now owned by the shard, only drop the entries */
+	if (migrated) {
+		res = tee_fs_dirfile_remove_entries(root_dirh, in_shard, dir);
+		if (res)
+			goto out;
+	}
+
+	res = commit_dirh_writes(root_dirh);
+out:
+	put_dirh_primitive(ree_fs_root, res);
+
+	return res;
+}
+
+#ifdef CFG_REE_FS_INTEGRITY_RPMB
+/*
+ * The hash of shard n is stored after the hash of the root dirfile in the
+ * RPMB file, at offset (n + 1) * TEE_FS_HTREE_HASH_SIZE. Committing a
+ * shard only updates its hash there, the root dirfile is only committed
+ * when a shard is added or objects are moved to it. The hash of a shard
+ * in the root dirfile is used until one is stored in the RPMB file.
+ */
+static size_t shard_hash_offs(struct ree_fs_dir *dir)
+{
+	return (dir - ree_fs_dirs) * TEE_FS_HTREE_HASH_SIZE;
+}
+
+/* Called with ree_fs_root->mutex held and the root dirfile open */
+static TEE_Result read_shard_hash(struct ree_fs_dir *dir, uint8_t *hash)
+{
+	uint8_t h[TEE_FS_HTREE_HASH_SIZE] = { };
+	size_t l = sizeof(h);
+	TEE_Result res = TEE_SUCCESS;
+
+	res = rpmb_fs_ops.read(ree_fs_rpmb_fh, shard_hash_offs(dir), h, NULL,
+			       &l);
+	if (!res && l == sizeof(h))
+		memcpy(hash, h, sizeof(h));
+
+	return res;
+}
+
+/* Called with ree_fs_root->mutex held and the root dirfile open */
+static TEE_Result store_shard_hash(struct ree_fs_dir *dir,
+				   const uint8_t *hash)
+{
+	return rpmb_fs_ops.write(ree_fs_rpmb_fh, shard_hash_offs(dir), hash,
+				 NULL, TEE_FS_HTREE_HASH_SIZE);
+}
+
+static TEE_Result commit_shard_hash(struct ree_fs_dir *dir,
+				    const uint8_t *hash)
+{
+	struct tee_fs_dirfile_dirh *root_dirh = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	mutex_lock(&ree_fs_root->mutex);
+
+	/* Makes sure that ree_fs_rpmb_fh is open */
+	res = get_dirh(ree_fs_root, &root_dirh);
+	if (!res) {
+		res = store_shard_hash(dir, hash);
+		put_dirh_primitive(ree_fs_root, false);
+	}
+
+	mutex_unlock(&ree_fs_root->mutex);
+
+	return res;
+}
+#else
+/*
+ * Only the root dirfile is protected against rollback by the monotonic
+ * counter, committing a shard records its hash in the root dirfile.
+ */
+static TEE_Result read_shard_hash(struct ree_fs_dir *dir __unused,
+				  uint8_t *hash __unused)
+{
+	return TEE_SUCCESS;
+}
+
+static TEE_Result store_shard_hash(struct ree_fs_dir *dir __unused,
+				   const uint8_t *hash __unused)
+{
+	return TEE_SUCCESS;
+}
+
+static TEE_Result commit_shard_hash(struct ree_fs_dir *dir,
+				    const uint8_t *hash)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	mutex_lock(&ree_fs_root->mutex);
+	res = update_root(dir, hash, false);
+	mutex_unlock(&ree_fs_root->mutex);
+
+	return res;
+}
+#endif /*!CFG_REE_FS_INTEGRITY_RPMB*/
+
+/*
+ * Opens the shard dirfile of @dir, creating it if needed. A reference on
+ * the root dirfile is held while the shard dirfile is open since it's
+ * updated each time the shard is.
+ */
+static TEE_Result open_shard_dirh(struct ree_fs_dir *dir)
+{
+	struct tee_fs_dirfile_dirh *root_dirh = NULL;
+	struct tee_fs_dirfile_fileh dfh = { .idx = -1 };
+	uint8_t hash[TEE_FS_HTREE_HASH_SIZE] = { };
+	char oid[TEE_OBJECT_ID_MAX_LEN] = { };
+	size_t oidlen = sizeof(oid);
+	TEE_Result res = TEE_SUCCESS;
+	size_t count = 0;
+	bool create = false;
+
+	mutex_lock(&ree_fs_root->mutex);
+
+	res = get_dirh(ree_fs_root, &root_dirh);
+	if (res)
+		goto out_unlock;
+
+	res = find_shard(root_dirh, dir, oid, &oidlen, &dfh);
+	if (res == TEE_ERROR_ITEM_NOT_FOUND) {
+		create = true;
+		dfh.file_number = shard_file_number(dir);
+	} else if (!res) {
+		res = read_shard_hash(dir, dfh.hash);
+	}
+	if (res && !create)
+		goto out;
+
+	res = tee_fs_dirfile_open_numbered(create, create ? NULL : dfh.hash, 0,
+					   &dfh, dfh.file_number + 1,
+					   SHARD_NUMBERS - 1, &ree_dirf_ops,
+					   &dir->dirh);
+	if (res) {
+		/* The root dirfile says the shard exists */
+		if (res == TEE_ERROR_ITEM_NOT_FOUND) {
+			DMSG("Shard %s not found", oid);
+			res = TEE_ERROR_SECURITY;
+		}
+		goto out;
+	}
+
+	if (!dir->migrated) {
+		res = tee_fs_dirfile_copy_entries(root_dirh, dir->dirh,
+						  in_shard, dir, &count);
+		if (res)
+			goto out;
+	}
+
+	/*
+	 * Adding the shard or moving objects to it changes the root
+	 * dirfile. The objects moved remain listed in the root dirfile
+	 * until it's committed, they're moved again next time otherwise.
+	 */
+	if (create || count) {
+		res = tee_fs_dirfile_commit_writes(dir->dirh, hash, NULL);
+		if (res)
+			goto out;
+		res = store_shard_hash(dir, hash);
+		if (res)
+			goto out;
+		res = update_root(dir, hash, count);
+		if (res)
+			goto out;
+		if (count)
+			DMSG("Moved %zu objects to shard %s", count, oid);
+	}
+	dir->migrated = true;
+
+out:
+	if (res) {
+		tee_fs_dirfile_close(dir->dirh);
+		dir->dirh = NULL;
+		put_dirh_primitive(ree_fs_root, true);
+	}
+out_unlock:
+	mutex_unlock(&ree_fs_root->mutex);
+
+	return res;
+}
+
+static TEE_Result commit_shard_writes(struct ree_fs_dir *dir)
+{
+	uint8_t hash[TEE_FS_HTREE_HASH_SIZE] = { };
+	TEE_Result res = TEE_SUCCESS;
+
+	res = tee_fs_dirfile_commit_writes(dir->dirh, hash, NULL);
+	if (res)
+		return res;
+
+	return commit_shard_hash(dir, hash);
+}
+
+static void close_shard_dirh(struct ree_fs_dir *dir)
+{
+	tee_fs_dirfile_close(dir->dirh);
+	dir->dirh = NULL;
+
+	mutex_lock(&ree_fs_root->mutex);
+	put_dirh_primitive(ree_fs_root, false);
+	mutex_unlock(&ree_fs_root->mutex);
+}
+
+static TEE_Result commit_dir_writes(struct ree_fs_dir *dir)
+{
+	if (dir == ree_fs_root)
+		return commit_dirh_writes(dir->dirh);
+
+	return commit_shard_writes(dir);
+}
+
+/*
+ * dir->dirh is caching the dirfile handle to avoid frequent opening and
+ * closing of that handle. When dir->refcount reaches 0, dir->dirh will be
+ * freed. However, dir->refcount > 0 is not a guarantee that dir->dirh will
+ * not be freed, it may very well be freed earlier in an error path.
+ * get_dirh() must be used to get the dir->dirh pointer each time it's
+ * needed if dir->mutex has been unlocked in between.
+ */
+static TEE_Result get_dirh(struct ree_fs_dir *dir,
+			   struct tee_fs_dirfile_dirh **dirh)
 {
-	if (!ree_fs_dirh) {
-		TEE_Result res = open_dirh(&ree_fs_dirh);
+	if (!dir->dirh) {
+		TEE_Result res = TEE_SUCCESS;
 
+		if (dir == ree_fs_root)
+			res = open_dirh(&dir->dirh);
+		else
+			res = open_shard_dirh(dir);
 		if (res) {
 			*dirh = NULL;
 			return res;
 		}
 	}
-	ree_fs_dirh_refcount++;
-	assert(ree_fs_dirh);
-	assert(ree_fs_dirh_refcount);
-	*dirh = ree_fs_dirh;
+	dir->refcount++;
+	assert(dir->dirh);
+	assert(dir->refcount);
+	*dirh = dir->dirh;
 	return TEE_SUCCESS;
 }
 
-static void put_dirh_primitive(bool close)
+static void put_dirh_primitive(struct ree_fs_dir *dir, bool close)
 {
-	assert(ree_fs_dirh_refcount);
+	assert(dir->refcount);
 
 	/*
-	 * During the execution of one of the ree_fs_ops ree_fs_dirh is
+	 * During the execution of one of the ree_fs_ops dir->dirh is
 	 * guareteed to be a valid pointer. But when the fop has returned
 	 * another thread may get an error or something causing that fop
 	 * to do a put with close=1.
@@ -689,18 +1049,23 @@ static void put_dirh_primitive(bool close)
 	 * get a new dirh which will open it again if it was closed before.
 	 * But in the ree_fs_close() case there's no call to get_dirh()
 	 * only to this function, put_dirh_primitive(), and in this case
-	 * ree_fs_dirh may actually be NULL.
+	 * dir->dirh may actually be NULL.
 	 */
-	ree_fs_dirh_refcount--;
-	if (ree_fs_dirh && (!ree_fs_dirh_refcount || close))
-		close_dirh(&ree_fs_dirh);
+	dir->refcount--;
+	if (dir->dirh && (!dir->refcount || close)) {
+		if (dir == ree_fs_root)
+			close_dirh(&dir->dirh);
+		else
+			close_shard_dirh(dir);
+	}
 }
 
-static void put_dirh(struct tee_fs_dirfile_dirh *dirh, bool close)
+static void put_dirh(struct ree_fs_dir *dir, struct tee_fs_dirfile_dirh *dirh,
+		     bool close)
 {
 	if (dirh) {
-		assert(dirh == ree_fs_dirh);
-		put_dirh_primitive(close);
+		assert(dirh == dir->dirh);
+		put_dirh_primitive(dir, close);
 	}
 }
 
@@ -708,12 +1073,13 @@ static TEE_Result ree_fs_open(struct tee_pobj *po, size_t *size,
 			      struct tee_file_handle **fh)
 {
 	TEE_Result res;
+	struct ree_fs_dir *dir = uuid_to_dir(&po->uuid);
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	struct tee_fs_dirfile_fileh dfh;
 
-	mutex_lock(&ree_fs_mutex);
+	mutex_lock(&dir->mutex);
 
-	res = get_dirh(&dirh);
+	res = get_dirh(dir, &dirh);
 	if (res != TEE_SUCCESS)
 		goto out;
 
@@ -737,13 +1103,14 @@ static TEE_Result ree_fs_open(struct tee_pobj *po, size_t *size,
 
 out:
 	if (res)
-		put_dirh(dirh, true);
-	mutex_unlock(&ree_fs_mutex);
+		put_dirh(dir, dirh, true);
+	mutex_unlock(&dir->mutex);
 
 	return res;
 }
 
-static TEE_Result set_name(struct tee_fs_dirfile_dirh *dirh,
+static TEE_Result set_name(struct ree_fs_dir *dir,
+			   struct tee_fs_dirfile_dirh *dirh,
 			   struct tee_fs_fd *fdp, struct tee_pobj *po,
 			   bool overwrite)
 {
@@ -770,7 +1137,7 @@ static TEE_Result set_name(struct tee_fs_dirfile_dirh *dirh,
 	if (res)
 		return res;
 
-	res = commit_dirh_writes(dirh);
+	res = commit_dir_writes(dir);
 	if (res)
 		return res;
 
@@ -783,11 +1150,14 @@ static TEE_Result set_name(struct tee_fs_dirfile_dirh *dirh,
 static void ree_fs_close(struct tee_file_handle **fh)
 {
 	if (*fh) {
-		mutex_lock(&ree_fs_mutex);
-		put_dirh_primitive(false);
+		struct tee_fs_fd *fdp = (struct tee_fs_fd *)*fh;
+		struct ree_fs_dir *dir = uuid_to_dir(fdp->uuid);
+
+		mutex_lock(&dir->mutex);
+		put_dirh_primitive(dir, false);
 		ree_fs_close_primitive(*fh);
 		*fh = NULL;
-		mutex_unlock(&ree_fs_mutex);
+		mutex_unlock(&dir->mutex);
 
 	}
 }
@@ -799,6 +1169,7 @@ static TEE_Result ree_fs_create(struct tee_pobj *po, bool overwrite,
 				size_t data_size, struct tee_file_handle **fh)
 {
 	struct tee_fs_fd *fdp;
+	struct ree_fs_dir *dir = uuid_to_dir(&po->uuid);
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	struct tee_fs_dirfile_fileh dfh;
 	TEE_Result res;
@@ -808,9 +1179,9 @@ static TEE_Result ree_fs_create(struct tee_pobj *po, bool overwrite,
 	assert(!data_core || !data_user);
 
 	*fh = NULL;
-	mutex_lock(&ree_fs_mutex);
+	mutex_lock(&dir->mutex);
 
-	res = get_dirh(&dirh);
+	res = get_dirh(dir, &dirh);
 	if (res)
 		goto out;
 
@@ -848,21 +1219,39 @@ static TEE_Result ree_fs_create(struct tee_pobj *po, bool overwrite,
 	if (res)
 		goto out;
 
-	res = set_name(dirh, fdp, po, overwrite);
+	res = set_name(dir, dirh, fdp, po, overwrite);
 out:
 	if (res) {
-		put_dirh(dirh, true);
+		put_dirh(dir, dirh, true);
 		if (*fh) {
 			ree_fs_close_primitive(*fh);
 			*fh = NULL;
 			tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, &dfh);
 		}
 	}
-	mutex_unlock(&ree_fs_mutex);
+	mutex_unlock(&dir->mutex);
 
 	return res;
 }
 
+/* Commits the changes of the file and records its new hash in the dirfile */
+static TEE_Result commit_fd(struct ree_fs_dir *dir,
+			    struct tee_fs_dirfile_dirh *dirh,
+			    struct tee_fs_fd *fdp)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	res = tee_fs_htree_sync_to_storage(&fdp->ht, fdp->dfh.hash, NULL);
+	if (res)
+		return res;
+
+	res = tee_fs_dirfile_update_hash(dirh, &fdp->dfh);
+	if (res)
+		return res;
+
+	return commit_dir_writes(dir);
+}
+
 static TEE_Result ree_fs_write(struct tee_file_handle *fh, size_t pos,
 			       const void *buf_core, const void *buf_user,
 			       size_t len)
@@ -870,13 +1259,14 @@ static TEE_Result ree_fs_write(struct tee_file_handle *fh, size_t pos,
 	TEE_Result res;
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	struct tee_fs_fd *fdp = (struct tee_fs_fd *)fh;
+	struct ree_fs_dir *dir = uuid_to_dir(fdp->uuid);
 
 	/* One of buf_core and buf_user must be NULL */
 	assert(!buf_core || !buf_user);
 
-	mutex_lock(&ree_fs_mutex);
+	mutex_lock(&dir->mutex);
 
-	res = get_dirh(&dirh);
+	res = get_dirh(dir, &dirh);
 	if (res)
 		goto out;
 
@@ -884,17 +1274,11 @@ static TEE_Result ree_fs_write(struct tee_file_handle *fh, size_t pos,
 	if (res)
 		goto out;
 
-	res = tee_fs_htree_sync_to_storage(&fdp->ht, fdp->dfh.hash, NULL);
-	if (res)
-		goto out;
-
-	res = tee_fs_dirfile_update_hash(dirh, &fdp->dfh);
-	if (res)
-		goto out;
-	res = commit_dirh_writes(dirh);
+	if (!fdp->write_back)
+		res = commit_fd(dir, dirh, fdp);
 out:
-	put_dirh(dirh, res);
-	mutex_unlock(&ree_fs_mutex);
+	put_dirh(dir, dirh, res);
+	mutex_unlock(&dir->mutex);
 
 	return res;
 }
@@ -903,6 +1287,7 @@ static TEE_Result ree_fs_rename(struct tee_pobj *old, struct tee_pobj *new,
 				bool overwrite)
 {
 	TEE_Result res;
+	struct ree_fs_dir *dir = NULL;
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	struct tee_fs_dirfile_fileh dfh;
 	struct tee_fs_dirfile_fileh remove_dfh = { .idx = -1 };
@@ -910,8 +1295,13 @@ static TEE_Result ree_fs_rename(struct tee_pobj *old, struct tee_pobj *new,
 	if (!new)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-	mutex_lock(&ree_fs_mutex);
-	res = get_dirh(&dirh);
+	/* Objects can't be moved between shards */
+	dir = uuid_to_dir(&old->uuid);
+	if (uuid_to_dir(&new->uuid) != dir)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	mutex_lock(&dir->mutex);
+	res = get_dirh(dir, &dirh);
 	if (res)
 		goto out;
 
@@ -938,7 +1328,7 @@ static TEE_Result ree_fs_rename(struct tee_pobj *old, struct tee_pobj *new,
 			goto out;
 	}
 
-	res = commit_dirh_writes(dirh);
+	res = commit_dir_writes(dir);
 	if (res)
 		goto out;
 
@@ -946,8 +1336,8 @@ static TEE_Result ree_fs_rename(struct tee_pobj *old, struct tee_pobj *new,
 		tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, &remove_dfh);
 
 out:
-	put_dirh(dirh, res);
-	mutex_unlock(&ree_fs_mutex);
+	put_dirh(dir, dirh, res);
+	mutex_unlock(&dir->mutex);
 
 	return res;
 
@@ -956,11 +1346,12 @@ out:
 static TEE_Result ree_fs_remove(struct tee_pobj *po)
 {
 	TEE_Result res;
+	struct ree_fs_dir *dir = uuid_to_dir(&po->uuid);
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	struct tee_fs_dirfile_fileh dfh;
 
-	mutex_lock(&ree_fs_mutex);
-	res = get_dirh(&dirh);
+	mutex_lock(&dir->mutex);
+	res = get_dirh(dir, &dirh);
 	if (res)
 		goto out;
 
@@ -973,7 +1364,7 @@ static TEE_Result ree_fs_remove(struct tee_pobj *po)
 	if (res)
 		goto out;
 
-	res = commit_dirh_writes(dirh);
+	res = commit_dir_writes(dir);
 	if (res)
 		goto out;
 
@@ -982,8 +1373,8 @@ static TEE_Result ree_fs_remove(struct tee_pobj *po)
 	assert(tee_fs_dirfile_find(dirh, &po->uuid, po->obj_id, po->obj_id_len,
 				   &dfh));
 out:
-	put_dirh(dirh, res);
-	mutex_unlock(&ree_fs_mutex);
+	put_dirh(dir, dirh, res);
+	mutex_unlock(&dir->mutex);
 
 	return res;
 }
@@ -993,10 +1384,11 @@ static TEE_Result ree_fs_truncate(struct tee_file_handle *fh, size_t len)
 	TEE_Result res;
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	struct tee_fs_fd *fdp = (struct tee_fs_fd *)fh;
+	struct ree_fs_dir *dir = uuid_to_dir(fdp->uuid);
 
-	mutex_lock(&ree_fs_mutex);
+	mutex_lock(&dir->mutex);
 
-	res = get_dirh(&dirh);
+	res = get_dirh(dir, &dirh);
 	if (res)
 		goto out;
 
@@ -1004,17 +1396,60 @@ static TEE_Result ree_fs_truncate(struct tee_file_handle *fh, size_t len)
 	if (res)
 		goto out;
 
-	res = tee_fs_htree_sync_to_storage(&fdp->ht, fdp->dfh.hash, NULL);
-	if (res)
+	if (!fdp->write_back)
+		res = commit_fd(dir, dirh, fdp);
+out:
+	put_dirh(dir, dirh, res);
+	mutex_unlock(&dir->mutex);
+
+	return res;
+}
+
+/*
+ * Until ree_fs_commit_writes() the changes only update the hash tree in
+ * memory and blocks not referenced by the committed version of the file,
+ * so they are discarded if the file is closed or the TEE is reset before.
+ */
+static TEE_Result ree_fs_begin_writes(struct tee_file_handle *fh)
+{
+	struct tee_fs_fd *fdp = (struct tee_fs_fd *)fh;
+	struct ree_fs_dir *dir = uuid_to_dir(fdp->uuid);
+	TEE_Result res = TEE_SUCCESS;
+
+	mutex_lock(&dir->mutex);
+	if (fdp->write_back)
+		res = TEE_ERROR_BAD_STATE;
+	else
+		fdp->write_back = true;
+	mutex_unlock(&dir->mutex);
+
+	return res;
+}
+
+static TEE_Result ree_fs_commit_writes(struct tee_file_handle *fh)
+{
+	struct tee_fs_fd *fdp = (struct tee_fs_fd *)fh;
+	struct ree_fs_dir *dir = uuid_to_dir(fdp->uuid);
+	struct tee_fs_dirfile_dirh *dirh = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	mutex_lock(&dir->mutex);
+
+	if (!fdp->write_back) {
+		res = TEE_ERROR_BAD_STATE;
 		goto out;
+	}
 
-	res = tee_fs_dirfile_update_hash(dirh, &fdp->dfh);
+	res = get_dirh(dir, &dirh);
 	if (res)
 		goto out;
-	res = commit_dirh_writes(dirh);
+
+	res = commit_fd(dir, dirh, fdp);
+	if (!res)
+		fdp->write_back = false;
+	put_dirh(dir, dirh, res);
 out:
-	put_dirh(dirh, res);
-	mutex_unlock(&ree_fs_mutex);
+	mutex_unlock(&dir->mutex);
 
 	return res;
 }
@@ -1024,6 +1459,7 @@ static TEE_Result ree_fs_opendir_rpc(const TEE_UUID *uuid,
 
 {
 	TEE_Result res = TEE_SUCCESS;
+	struct ree_fs_dir *rdir = uuid_to_dir(uuid);
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	struct tee_fs_dir *d = calloc(1, sizeof(*d));
 
@@ -1031,10 +1467,11 @@ static TEE_Result ree_fs_opendir_rpc(const TEE_UUID *uuid,
 		return TEE_ERROR_OUT_OF_MEMORY;
 
 	d->uuid = uuid;
+	d->dir = rdir;
 
-	mutex_lock(&ree_fs_mutex);
+	mutex_lock(&rdir->mutex);
 
-	res = get_dirh(&dirh);
+	res = get_dirh(rdir, &dirh);
 	if (res)
 		goto out;
 
@@ -1050,10 +1487,10 @@ out:
 		*dir = d;
 	} else {
 		if (d)
-			put_dirh(dirh, false);
+			put_dirh(rdir, dirh, false);
 		free(d);
 	}
-	mutex_unlock(&ree_fs_mutex);
+	mutex_unlock(&rdir->mutex);
 
 	return res;
 }
@@ -1061,12 +1498,14 @@ out:
 static void ree_fs_closedir_rpc(struct tee_fs_dir *d)
 {
 	if (d) {
-		mutex_lock(&ree_fs_mutex);
+		struct ree_fs_dir *dir = d->dir;
+
+		mutex_lock(&dir->mutex);
 
-		put_dirh(ree_fs_dirh, false);
+		put_dirh(dir, dir->dirh, false);
 		free(d);
 
-		mutex_unlock(&ree_fs_mutex);
+		mutex_unlock(&dir->mutex);
 	}
 }
 
@@ -1076,9 +1515,9 @@ static TEE_Result ree_fs_readdir_rpc(struct tee_fs_dir *d,
 	struct tee_fs_dirfile_dirh *dirh = NULL;
 	TEE_Result res = TEE_SUCCESS;
 
-	mutex_lock(&ree_fs_mutex);
+	mutex_lock(&d->dir->mutex);
 
-	res = get_dirh(&dirh);
+	res = get_dirh(d->dir, &dirh);
 	if (res)
 		goto out;
 
@@ -1088,9 +1527,9 @@ static TEE_Result ree_fs_readdir_rpc(struct tee_fs_dir *d,
 	if (res == TEE_SUCCESS)
 		*ent = &d->d;
 
-	put_dirh(dirh, res);
+	put_dirh(d->dir, dirh, res);
 out:
-	mutex_unlock(&ree_fs_mutex);
+	mutex_unlock(&d->dir->mutex);
 
 	return res;
 }
@@ -1102,6 +1541,8 @@ const struct tee_file_operations ree_fs_ops = {
 	.read = ree_fs_read,
 	.write = ree_fs_write,
 	.truncate = ree_fs_truncate,
+	.begin_writes = ree_fs_begin_writes,
+	.commit_writes = ree_fs_commit_writes,
 	.rename = ree_fs_rename,
 	.remove = ree_fs_remove,
 	.opendir = ree_fs_opendir_rpc,
@@ -4072,7 +4072,7 @@ TEE_Result syscall_cryp_random_number_generate(void *buf, size_t blen)
 	if (!bbuf)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
-	res = crypto_rng_read(bbuf, blen);
+	res = crypto_rng_read_buffered(bbuf, blen);
 	if (res != TEE_SUCCESS)
 		return res;
 
@@ -921,6 +921,43 @@ TEE_Result syscall_storage_obj_seek(unsigned long obj, int32_t offset,
 	return TEE_SUCCESS;
 }
 
+TEE_Result syscall_storage_obj_transaction(unsigned long obj, unsigned long op)
+{
+	struct ts_session *sess = ts_get_current_session();
+	struct user_ta_ctx *utc = to_user_ta_ctx(sess->ctx);
+	const struct tee_file_operations *fops = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	struct tee_obj *o = NULL;
+
+	res = tee_obj_get(utc, uref_to_vaddr(obj), &o);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	if (!(o->info.handleFlags & TEE_HANDLE_FLAG_PERSISTENT))
+		return TEE_ERROR_BAD_STATE;
+
+	if (!(o->info.handleFlags & TEE_DATA_FLAG_ACCESS_WRITE))
+		return TEE_ERROR_ACCESS_CONFLICT;
+
+	fops = o->pobj->fops;
+	if (!fops->begin_writes || !fops->commit_writes)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	switch (op) {
+	case UTEE_STORAGE_TRANSACTION_BEGIN:
+		return fops->begin_writes(o->fh);
+	case UTEE_STORAGE_TRANSACTION_COMMIT:
+		res = fops->commit_writes(o->fh);
+		if (res == TEE_ERROR_CORRUPT_OBJECT) {
+			EMSG("Object corrupt");
+			remove_corrupt_obj(utc, o);
+		}
+		return res;
+	default:
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+}
+
 void tee_svc_storage_close_all_enum(struct user_ta_ctx *utc)
 {
 	struct tee_storage_enum_head *eh = &utc->storage_enums;
@@ -10,6 +10,7 @@
 #define MBEDTLS_HAVE_INT32
 
 #define MBEDTLS_CIPHER_MODE_CBC
+#define MBEDTLS_CIPHER_MODE_CTR
 #define MBEDTLS_PKCS1_V15
 
 #define MBEDTLS_CIPHER_C
@@ -21,6 +22,7 @@
 #define MBEDTLS_CHACHAPOLY_C
 
 #define MBEDTLS_SHA1_C
+#define MBEDTLS_SHA224_C
 #define MBEDTLS_SHA256_C
 #define MBEDTLS_SHA384_C
 #define MBEDTLS_SHA512_C
@@ -67,4 +69,15 @@
 #define MBEDTLS_PEM_PARSE_C
 #define MBEDTLS_PEM_WRITE_C
 
+/*
+ * With CFG_TA_USER_CRYPTO libutee runs AES and SHA-256 in user mode, use
+ * the ARMv8 Crypto Extensions when the platform has them. There's no
+ * way for a TA to probe for them so this relies on CFG_CRYPTO_WITH_CE.
+ */
+#if defined(CFG_TA_USER_CRYPTO) && defined(CFG_CRYPTO_WITH_CE) && \
+	defined(CFG_TA_FLOAT_SUPPORT) && defined(__aarch64__)
+#define MBEDTLS_AESCE_C
+#define MBEDTLS_SHA256_USE_ARMV8_A_CRYPTO_ONLY
+#endif
+
 #endif /* __MBEDTLS_CONFIG_UTA_H */
@@ -93,4 +93,99 @@ struct pta_stats_ta {
 #define STATS_DRIVER_TYPE_CLOCK		0
 #define STATS_DRIVER_TYPE_REGULATOR	1
 
+/*
+ * STATS_CMD_PAGER_POLICY_STATS - Get statistics on pager page replacement
+ *
+ * [out]    value[0].a        Page replacement policy, STATS_PAGER_POLICY_*
+ * [out]    value[0].b        Page faults since last stats dump
+ * [out]    value[1].a        Loaded pages evicted since last stats dump
+ * [out]    value[1].b        Referenced pages spared since last stats dump
+ * [out]    value[2].a        Pages hidden since last stats dump
+ * [out]    value[2].b        Hidden faults since last stats dump
+ * [out]    value[3].a        Pages loaded by fault-around since last stats dump
+ * [out]    value[3].b        Pages loaded by fault-around and evicted unused
+ *                            since last stats dump
+ *
+ * Counters are shared with STATS_CMD_PAGER_STATS, both commands reset them.
+ */
+#define STATS_CMD_PAGER_POLICY_STATS	6
+
+#define STATS_PAGER_POLICY_FIFO		0
+#define STATS_PAGER_POLICY_CLOCK	1
+
+/*
+ * STATS_CMD_PAGER_COMPRESS_STATS - Get statistics on the compressed store
+ * of read/write paged memory
+ *
+ * [out]    value[0].a        Pages held in the compressed store
+ * [out]    value[0].b        Bytes of the compressed store in use
+ * [out]    value[1].a        Size of the compressed store in bytes
+ * [out]    value[1].b        Saves failed on a full store since last stats
+ *                            dump
+ * [out]    value[2].a        Pages saved since last stats dump
+ * [out]    value[2].b        Average save time in microseconds since last
+ *                            stats dump
+ * [out]    value[3].a        Pages loaded since last stats dump
+ * [out]    value[3].b        Average load time in microseconds since last
+ *                            stats dump
+ *
+ * The compression ratio is value[0].a * page size / value[0].b. All values
+ * are 0 if the compressed store isn't enabled.
+ */
+#define STATS_CMD_PAGER_COMPRESS_STATS	7
+
+/*
+ * STATS_CMD_BOOT_PROFILE - Get timings of boot initcalls and DT driver probes
+ *
+ * [out]    memref[0]        Array of struct pta_stats_boot_prof, one per
+ *                           recorded event in the order they completed
+ * [out]    value[1].a       Number of events not recorded for lack of room
+ *
+ * Requires CFG_CORE_BOOT_PROFILE=y. A short buffer returns
+ * TEE_ERROR_SHORT_BUFFER with the size needed in memref[0].
+ */
+#define STATS_CMD_BOOT_PROFILE		8
+
+#define STATS_BOOT_PROF_PREINITCALL	0
+#define STATS_BOOT_PROF_EARLY_INITCALL	1
+#define STATS_BOOT_PROF_SERVICE_INITCALL	2
+#define STATS_BOOT_PROF_DRIVER_INITCALL	3
+#define STATS_BOOT_PROF_FINALCALL	4
+#define STATS_BOOT_PROF_DT_PROBE	5
+#define STATS_BOOT_PROF_DT_REPROBE	6	/* Probe of a deferred driver */
+
+#define STATS_BOOT_PROF_NAME_SIZE	32
+
+struct pta_stats_boot_prof {
+	uint64_t start_us;	/* Start time from system counter origin */
+	uint32_t duration_us;
+	uint32_t type;		/* One of STATS_BOOT_PROF_* */
+	uint32_t result;	/* TEE_Result of the initcall or probe */
+	uint32_t deferrals;	/* Probe deferrals so far */
+	char name[STATS_BOOT_PROF_NAME_SIZE];	/* Function or driver */
+	char node[STATS_BOOT_PROF_NAME_SIZE];	/* DT node of a probe */
+};
+
+/*
+ * STATS_CMD_GUEST_THREAD_STATS - Get thread usage of the calling guest
+ *
+ * [out]    value[0].a        Threads allocated to the guest
+ * [out]    value[0].b        Threads the guest may have allocated at once
+ * [out]    value[1].a        Highest number of threads allocated since last
+ *                            stats dump
+ * [out]    value[1].b        Calls admitted since last stats dump
+ * [out]    value[2].a        Calls refused since the guest used its quota
+ *                            of threads since last stats dump
+ * [out]    value[2].b        Calls refused since all threads were in use
+ *                            since last stats dump
+ * [out]    value[3].a        Average time in microseconds a call held a
+ *                            thread since last stats dump
+ * [out]    value[3].b        Longest time in microseconds a call held a
+ *                            thread since last stats dump
+ *
+ * Requires CFG_NS_VIRTUALIZATION=y. A thread is held from the start of a
+ * call until it returns, including the time spent in RPCs.
+ */
+#define STATS_CMD_GUEST_THREAD_STATS	9
+
 #endif /*__PTA_STATS_H*/
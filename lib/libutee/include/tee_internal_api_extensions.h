@@ -35,6 +35,27 @@ TEE_Result TEE_CacheClean(char *buf, size_t len);
 TEE_Result TEE_CacheFlush(char *buf, size_t len);
 TEE_Result TEE_CacheInvalidate(char *buf, size_t len);
 
+/*
+ * Transactions on persistent objects
+ *
+ * TEE_BeginObjectTransaction() - After this call TEE_WriteObjectData() and
+ *				   TEE_TruncateObjectData() on @object only
+ *				   update the object in memory until
+ *				   TEE_CommitObjectTransaction() is called.
+ *
+ * TEE_CommitObjectTransaction() - Atomically commits all the changes made
+ *				    to @object since the transaction began
+ *				    and ends the transaction.
+ *
+ * Changes not committed when @object is closed are discarded. @object must
+ * be opened with TEE_DATA_FLAG_ACCESS_WRITE. Returns
+ * TEE_ERROR_NOT_SUPPORTED if the storage of @object doesn't support
+ * transactions, TEE_ERROR_BAD_STATE if a transaction is already started
+ * or not started respectively.
+ */
+TEE_Result TEE_BeginObjectTransaction(TEE_ObjectHandle object);
+TEE_Result TEE_CommitObjectTransaction(TEE_ObjectHandle object);
+
 /*
  * tee_map_zi() - Map zero initialized memory
  * @len:	Number of bytes
@@ -223,6 +223,10 @@ TEE_Result _utee_storage_obj_seek(unsigned long obj, int32_t offset,
 /* op is of type enum _utee_cache_operation */
 TEE_Result _utee_cache_operation(void *va, size_t l, unsigned long op);
 
+/* obj is of type TEE_ObjectHandle */
+/* op is of type enum utee_storage_transaction_op */
+TEE_Result _utee_storage_obj_transaction(unsigned long obj, unsigned long op);
+
 TEE_Result _utee_gprof_send(void *buf, size_t size, uint32_t *id);
 
 #endif /* UTEE_SYSCALLS_H */
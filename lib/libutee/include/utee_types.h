@@ -42,6 +42,15 @@ enum utee_cache_operation {
 	TEE_CACHEINVALIDATE,
 };
 
+/*
+ * Operations of _utee_storage_obj_transaction(), used by
+ * TEE_BeginObjectTransaction() and TEE_CommitObjectTransaction()
+ */
+enum utee_storage_transaction_op {
+	UTEE_STORAGE_TRANSACTION_BEGIN = 0,
+	UTEE_STORAGE_TRANSACTION_COMMIT,
+};
+
 struct utee_params {
 	uint64_t types;
 	/* vals[n * 2]	   corresponds to either value.a or memref.buffer
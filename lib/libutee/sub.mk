@@ -13,6 +13,8 @@ srcs-y += tee_api_objects.c
 srcs-y += tee_api_operations.c
 srcs-y += tee_api_panic.c
 srcs-y += tee_api_property.c
+srcs-$(CFG_TA_USER_DRBG) += tee_drbg.c
+srcs-$(CFG_TA_USER_CRYPTO) += tee_user_crypto.c
 srcs-y += tee_socket_pta.c
 srcs-y += tee_system_pta.c
 srcs-y += tee_tcpudp_socket.c
@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include <tee_api.h>
+#include <tee_internal_api_extensions.h>
 #include <utee_syscalls.h>
 #include "tee_api_private.h"
 
@@ -991,6 +992,24 @@ TEE_Result __GP11_TEE_TruncateObjectData(TEE_ObjectHandle object,
 	return TEE_TruncateObjectData(object, size);
 }
 
+TEE_Result TEE_BeginObjectTransaction(TEE_ObjectHandle object)
+{
+	if (object == TEE_HANDLE_NULL)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	return _utee_storage_obj_transaction((unsigned long)object,
+					     UTEE_STORAGE_TRANSACTION_BEGIN);
+}
+
+TEE_Result TEE_CommitObjectTransaction(TEE_ObjectHandle object)
+{
+	if (object == TEE_HANDLE_NULL)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	return _utee_storage_obj_transaction((unsigned long)object,
+					     UTEE_STORAGE_TRANSACTION_COMMIT);
+}
+
 TEE_Result TEE_SeekObjectData(TEE_ObjectHandle object, intmax_t offset,
 			      TEE_Whence whence)
 {
@@ -31,8 +31,95 @@ struct __TEE_OperationHandle {
 	size_t block_size;	/* Block size of cipher */
 	size_t buffer_offs;	/* Offset in buffer */
 	uint32_t state;		/* Handle to state in TEE Core */
+	/* User mode state, see tee_user_crypto.c */
+	struct utee_user_crypto *user_crypto;
 };
 
+/*
+ * Returns the user mode state of the operation if the operation is carried
+ * out in user mode, else NULL and the operation goes through the TEE Core.
+ */
+static struct utee_user_crypto *user_crypto(TEE_OperationHandle op)
+{
+	if (IS_ENABLED(CFG_TA_USER_CRYPTO) && op->user_crypto &&
+	    __utee_user_crypto_is_active(op->user_crypto))
+		return op->user_crypto;
+
+	return NULL;
+}
+
+static TEE_Result op_hash_init(TEE_OperationHandle op, const void *IV,
+			       size_t IVLen)
+{
+	struct utee_user_crypto *uc = user_crypto(op);
+
+	if (uc)
+		return __utee_user_crypto_hash_init(uc);
+	return _utee_hash_init(op->state, IV, IVLen);
+}
+
+static TEE_Result op_hash_update(TEE_OperationHandle op, const void *chunk,
+				 size_t chunk_size)
+{
+	struct utee_user_crypto *uc = user_crypto(op);
+
+	if (uc)
+		return __utee_user_crypto_hash_update(uc, chunk, chunk_size);
+	return _utee_hash_update(op->state, chunk, chunk_size);
+}
+
+static TEE_Result op_hash_final(TEE_OperationHandle op, const void *chunk,
+				size_t chunk_size, void *hash,
+				uint64_t *hash_len)
+{
+	struct utee_user_crypto *uc = user_crypto(op);
+
+	if (uc)
+		return __utee_user_crypto_hash_final(uc, chunk, chunk_size,
+						     hash, hash_len);
+	return _utee_hash_final(op->state, chunk, chunk_size, hash, hash_len);
+}
+
+static TEE_Result op_cipher_init(TEE_OperationHandle op, const void *IV,
+				 size_t IVLen)
+{
+	struct utee_user_crypto *uc = user_crypto(op);
+
+	if (uc)
+		return __utee_user_crypto_cipher_init(uc, IV, IVLen);
+	return _utee_cipher_init(op->state, IV, IVLen);
+}
+
+static TEE_Result op_cipher_update(TEE_OperationHandle op, const void *src,
+				   size_t slen, void *dst, uint64_t *dlen)
+{
+	struct utee_user_crypto *uc = user_crypto(op);
+
+	if (uc)
+		return __utee_user_crypto_cipher_update(uc, src, slen, dst,
+							dlen);
+	return _utee_cipher_update(op->state, src, slen, dst, dlen);
+}
+
+static TEE_Result op_cipher_final(TEE_OperationHandle op, const void *src,
+				  size_t slen, void *dst, uint64_t *dlen)
+{
+	struct utee_user_crypto *uc = user_crypto(op);
+
+	/* Algorithms handled in user mode have no final block processing */
+	if (uc)
+		return __utee_user_crypto_cipher_update(uc, src, slen, dst,
+							dlen);
+	return _utee_cipher_final(op->state, src, slen, dst, dlen);
+}
+
+static TEE_Result op_authenc_update_payload(TEE_OperationHandle op,
+					    const void *src, size_t slen,
+					    void *dst, uint64_t *dlen)
+{
+	return _utee_authenc_update_payload(op->state, src, slen, dst, dlen);
+}
+
 /* Cryptographic Operations API - Generic Operation Functions */
 
 TEE_Result TEE_AllocateOperation(TEE_OperationHandle *operation,
@@ -378,6 +465,13 @@ TEE_Result TEE_AllocateOperation(TEE_OperationHandle *operation,
 	if (res != TEE_SUCCESS)
 		goto out;
 
+	if (IS_ENABLED(CFG_TA_USER_CRYPTO)) {
+		res = __utee_user_crypto_alloc(algorithm, mode,
+					       &op->user_crypto);
+		if (res != TEE_SUCCESS)
+			goto out;
+	}
+
 	/*
 	 * Initialize digest operations
 	 * Other multi-stage operations initialized w/ TEE_xxxInit functions
@@ -431,6 +525,8 @@ void TEE_FreeOperation(TEE_OperationHandle operation)
 	if (res != TEE_SUCCESS)
 		TEE_Panic(res);
 
+	if (IS_ENABLED(CFG_TA_USER_CRYPTO))
+		__utee_user_crypto_free(operation->user_crypto);
 	TEE_Free(operation->buffer);
 	TEE_Free(operation);
 }
@@ -565,7 +661,7 @@ static void reset_operation_state(TEE_OperationHandle op)
 	op->operationState = TEE_OPERATION_STATE_INITIAL;
 
 	if (op->info.operationClass == TEE_OPERATION_DIGEST) {
-		TEE_Result res = _utee_hash_init(op->state, NULL, 0);
+		TEE_Result res = op_hash_init(op, NULL, 0);
 
 		if (res != TEE_SUCCESS)
 			TEE_Panic(res);
@@ -602,6 +698,9 @@ TEE_Result TEE_SetOperationKey(TEE_OperationHandle operation,
 		/* Operation key cleared */
 		TEE_ResetTransientObject(operation->key1);
 		operation->info.handleState &= ~TEE_HANDLE_FLAG_KEY_SET;
+		if (IS_ENABLED(CFG_TA_USER_CRYPTO) && operation->user_crypto)
+			__utee_user_crypto_set_key(operation->user_crypto,
+						   TEE_HANDLE_NULL);
 		if (operation->operationState != TEE_OPERATION_STATE_INITIAL)
 			reset_operation_state(operation);
 		return TEE_SUCCESS;
@@ -646,6 +745,9 @@ TEE_Result TEE_SetOperationKey(TEE_OperationHandle operation,
 	if (res != TEE_SUCCESS)
 		goto out;
 
+	if (IS_ENABLED(CFG_TA_USER_CRYPTO) && operation->user_crypto)
+		__utee_user_crypto_set_key(operation->user_crypto, key);
+
 	operation->info.handleState |= TEE_HANDLE_FLAG_KEY_SET;
 
 	operation->info.keySize = key_size;
@@ -868,6 +970,10 @@ void TEE_CopyOperation(TEE_OperationHandle dst_op, TEE_OperationHandle src_op)
 	res = _utee_cryp_state_copy(dst_op->state, src_op->state);
 	if (res != TEE_SUCCESS)
 		TEE_Panic(res);
+
+	if (IS_ENABLED(CFG_TA_USER_CRYPTO) && src_op->user_crypto)
+		__utee_user_crypto_copy(dst_op->user_crypto,
+					src_op->user_crypto);
 }
 
 /* Cryptographic Operations API - Message Digest Functions */
@@ -881,7 +987,7 @@ static void init_hash_operation(TEE_OperationHandle operation, const void *IV,
 	 * Note : IV and IVLen are never used in current implementation
 	 * This is why coherent values of IV and IVLen are not checked
 	 */
-	res = _utee_hash_init(operation->state, IV, IVLen);
+	res = op_hash_init(operation, IV, IVLen);
 	if (res != TEE_SUCCESS)
 		TEE_Panic(res);
 	operation->buffer_offs = 0;
@@ -899,7 +1005,7 @@ void TEE_DigestUpdate(TEE_OperationHandle operation,
 
 	operation->operationState = TEE_OPERATION_STATE_ACTIVE;
 
-	res = _utee_hash_update(operation->state, chunk, chunkSize);
+	res = op_hash_update(operation, chunk, chunkSize);
 	if (res != TEE_SUCCESS)
 		TEE_Panic(res);
 }
@@ -942,8 +1048,7 @@ TEE_Result TEE_DigestDoFinal(TEE_OperationHandle operation, const void *chunk,
 		*hashLen = len;
 	} else {
 		hl = *hashLen;
-		res = _utee_hash_final(operation->state, chunk, chunkLen, hash,
-				       &hl);
+		res = op_hash_final(operation, chunk, chunkLen, hash, &hl);
 		*hashLen = hl;
 		if (res)
 			goto out;
@@ -993,7 +1098,7 @@ TEE_Result TEE_DigestExtract(TEE_OperationHandle operation, void *hash,
 		operation->info.handleState |= TEE_HANDLE_FLAG_EXTRACTING;
 		operation->operationState = TEE_OPERATION_STATE_EXTRACTING;
 		hl = *hashLen;
-		res = _utee_hash_final(operation->state, NULL, 0, hash, &hl);
+		res = op_hash_final(operation, NULL, 0, hash, &hl);
 		if (res)
 			TEE_Panic(0);
 		*hashLen = hl;
@@ -1003,8 +1108,8 @@ TEE_Result TEE_DigestExtract(TEE_OperationHandle operation, void *hash,
 
 	if (operation->operationState != TEE_OPERATION_STATE_EXTRACTING) {
 		hl = operation->block_size;
-		res = _utee_hash_final(operation->state, NULL, 0,
-				       operation->buffer, &hl);
+		res = op_hash_final(operation, NULL, 0, operation->buffer,
+				    &hl);
 		if (res)
 			TEE_Panic(0);
 		if (hl != operation->block_size)
@@ -1052,7 +1157,7 @@ void TEE_CipherInit(TEE_OperationHandle operation, const void *IV,
 
 	operation->operationState = TEE_OPERATION_STATE_ACTIVE;
 
-	res = _utee_cipher_init(operation->state, IV, IVLen);
+	res = op_cipher_init(operation, IV, IVLen);
 	if (res != TEE_SUCCESS)
 		TEE_Panic(res);
 
@@ -1068,8 +1173,9 @@ void __GP11_TEE_CipherInit(TEE_OperationHandle operation, const void *IV,
 
 static TEE_Result tee_buffer_update(
 		TEE_OperationHandle op,
-		TEE_Result(*update_func)(unsigned long state, const void *src,
-				size_t slen, void *dst, uint64_t *dlen),
+		TEE_Result(*update_func)(TEE_OperationHandle op,
+					 const void *src, size_t slen,
+					 void *dst, uint64_t *dlen),
 		const void *src_data, size_t src_len,
 		void *dest_data, uint64_t *dest_len)
 {
@@ -1125,7 +1231,7 @@ static TEE_Result tee_buffer_update(
 		if (!op->buffer_two_blocks)
 			l = op->block_size;
 		tmp_dlen = dlen;
-		res = update_func(op->state, op->buffer, l, dst, &tmp_dlen);
+		res = update_func(op, op->buffer, l, dst, &tmp_dlen);
 		if (res != TEE_SUCCESS)
 			TEE_Panic(res);
 		dst += tmp_dlen;
@@ -1151,7 +1257,7 @@ static TEE_Result tee_buffer_update(
 			l = ROUNDUP2(slen - buffer_size + 1, op->block_size);
 
 		tmp_dlen = dlen;
-		res = update_func(op->state, src, l, dst, &tmp_dlen);
+		res = update_func(op, src, l, dst, &tmp_dlen);
 		if (res != TEE_SUCCESS)
 			TEE_Panic(res);
 		src += l;
@@ -1234,12 +1340,12 @@ TEE_Result TEE_CipherUpdate(TEE_OperationHandle operation, const void *srcData,
 
 	dl = *destLen;
 	if (operation->block_size > 1) {
-		res = tee_buffer_update(operation, _utee_cipher_update, srcData,
+		res = tee_buffer_update(operation, op_cipher_update, srcData,
 					srcLen, destData, &dl);
 	} else {
 		if (srcLen > 0) {
-			res = _utee_cipher_update(operation->state, srcData,
-						  srcLen, destData, &dl);
+			res = op_cipher_update(operation, srcData, srcLen,
+					       destData, &dl);
 		} else {
 			res = TEE_SUCCESS;
 			dl = 0;
@@ -1341,7 +1447,7 @@ TEE_Result TEE_CipherDoFinal(TEE_OperationHandle operation,
 
 	if (operation->block_size > 1) {
 		if (srcLen) {
-			res = tee_buffer_update(operation, _utee_cipher_update,
+			res = tee_buffer_update(operation, op_cipher_update,
 						srcData, srcLen, dst,
 						&tmp_dlen);
 			if (res != TEE_SUCCESS)
@@ -1352,12 +1458,11 @@ TEE_Result TEE_CipherDoFinal(TEE_OperationHandle operation,
 
 			tmp_dlen = *destLen - acc_dlen;
 		}
-		res = _utee_cipher_final(operation->state, operation->buffer,
-					 operation->buffer_offs, dst,
-					 &tmp_dlen);
+		res = op_cipher_final(operation, operation->buffer,
+				      operation->buffer_offs, dst, &tmp_dlen);
 	} else {
-		res = _utee_cipher_final(operation->state, srcData, srcLen, dst,
-					 &tmp_dlen);
+		res = op_cipher_final(operation, srcData, srcLen, dst,
+				      &tmp_dlen);
 	}
 	if (res != TEE_SUCCESS)
 		goto out;
@@ -1440,7 +1545,7 @@ void TEE_MACUpdate(TEE_OperationHandle operation, const void *chunk,
 	if (operation->operationState != TEE_OPERATION_STATE_ACTIVE)
 		TEE_Panic(0);
 
-	res = _utee_hash_update(operation->state, chunk, chunkSize);
+	res = op_hash_update(operation, chunk, chunkSize);
 	if (res != TEE_SUCCESS)
 		TEE_Panic(res);
 }
@@ -1480,7 +1585,7 @@ TEE_Result TEE_MACComputeFinal(TEE_OperationHandle operation,
 	}
 
 	ml = *macLen;
-	res = _utee_hash_final(operation->state, message, messageLen, mac, &ml);
+	res = op_hash_final(operation, message, messageLen, mac, &ml);
 	*macLen = ml;
 	if (res != TEE_SUCCESS)
 		goto out;
@@ -1707,7 +1812,7 @@ static TEE_Result ae_update_helper(TEE_OperationHandle operation,
 	}
 
 	if (operation->block_size > 1) {
-		res = tee_buffer_update(operation, _utee_authenc_update_payload,
+		res = tee_buffer_update(operation, op_authenc_update_payload,
 					src, slen, dst, &dl);
 	} else {
 		if (slen > 0) {
@@ -1854,7 +1959,7 @@ TEE_Result TEE_AEEncryptFinal(TEE_OperationHandle operation,
 	tl = *tagLen;
 	tmp_dlen = *destLen - acc_dlen;
 	if (operation->block_size > 1) {
-		res = tee_buffer_update(operation, _utee_authenc_update_payload,
+		res = tee_buffer_update(operation, op_authenc_update_payload,
 					srcData, srcLen, dst, &tmp_dlen);
 		if (res != TEE_SUCCESS)
 			goto out;
@@ -1952,7 +2057,7 @@ TEE_Result TEE_AEDecryptFinal(TEE_OperationHandle operation,
 
 	tmp_dlen = *destLen - acc_dlen;
 	if (operation->block_size > 1) {
-		res = tee_buffer_update(operation, _utee_authenc_update_payload,
+		res = tee_buffer_update(operation, op_authenc_update_payload,
 					srcData, srcLen, dst, &tmp_dlen);
 		if (res != TEE_SUCCESS)
 			goto out;
@@ -2398,6 +2503,11 @@ void TEE_GenerateRandom(void *randomBuffer, size_t randomBufferLen)
 {
 	TEE_Result res;
 
+	if (IS_ENABLED(CFG_TA_USER_DRBG)) {
+		__utee_drbg_read(randomBuffer, randomBufferLen);
+		return;
+	}
+
 	res = _utee_cryp_random_number_generate(randomBuffer, randomBufferLen);
 	if (res != TEE_SUCCESS)
 		TEE_Panic(res);
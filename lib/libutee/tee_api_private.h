@@ -5,6 +5,8 @@
 #ifndef TEE_API_PRIVATE
 #define TEE_API_PRIVATE
 
+#include <compiler.h>
+#include <stddef.h>
 #include <tee_api_types.h>
 #include <utee_types.h>
 
@@ -19,6 +21,46 @@ TEE_Result __utee_entry(unsigned long func, unsigned long session_id,
 			struct utee_params *up, unsigned long cmd_id);
 
 
+/* Serve random numbers from the DRBG of the TA instance */
+void __utee_drbg_read(void *buf, size_t blen);
+
+#if defined(CFG_TA_USER_DRBG)
+/* Called on TA entry, reseeds the DRBG when @session_id changes */
+void __utee_drbg_enter_session(unsigned long session_id);
+#else
+static inline void __utee_drbg_enter_session(unsigned long session_id
+					     __unused) {}
+#endif
+
+/*
+ * User mode digest, HMAC and AES operations, see tee_user_crypto.c. Only
+ * available with CFG_TA_USER_CRYPTO=y.
+ */
+struct utee_user_crypto;
+
+/* Supplies a NULL @uc if @algo isn't handled in user mode */
+TEE_Result __utee_user_crypto_alloc(uint32_t algo, uint32_t mode,
+				    struct utee_user_crypto **uc);
+void __utee_user_crypto_free(struct utee_user_crypto *uc);
+/* True if the operation is to be carried out in user mode */
+bool __utee_user_crypto_is_active(struct utee_user_crypto *uc);
+/* Operation is active on return if @key can be used in user mode */
+void __utee_user_crypto_set_key(struct utee_user_crypto *uc,
+				TEE_ObjectHandle key);
+void __utee_user_crypto_copy(struct utee_user_crypto *dst,
+			     struct utee_user_crypto *src);
+TEE_Result __utee_user_crypto_hash_init(struct utee_user_crypto *uc);
+TEE_Result __utee_user_crypto_hash_update(struct utee_user_crypto *uc,
+					  const void *chunk, size_t chunk_size);
+TEE_Result __utee_user_crypto_hash_final(struct utee_user_crypto *uc,
+					 const void *chunk, size_t chunk_size,
+					 void *hash, uint64_t *hash_len);
+TEE_Result __utee_user_crypto_cipher_init(struct utee_user_crypto *uc,
+					  const void *iv, size_t iv_len);
+TEE_Result __utee_user_crypto_cipher_update(struct utee_user_crypto *uc,
+					    const void *src, size_t slen,
+					    void *dst, uint64_t *dlen);
+
 #if defined(CFG_TA_GPROF_SUPPORT)
 void __utee_gprof_init(void);
 void __utee_gprof_fini(void);
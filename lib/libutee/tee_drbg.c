@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+/*
+ * User space DRBG serving the random numbers of a TA instance.
+ *
+ * ChaCha20 with fast key erasure: each refill of the output buffer
+ * produces a batch of keystream blocks. The first KEY_SIZE bytes replace
+ * the key and the rest is output. Output bytes are wiped once served, so
+ * a later compromise of the state doesn't reveal earlier output.
+ *
+ * The key is mixed with KEY_SIZE bytes from the kernel RNG when first
+ * used, after RESEED_INTERVAL bytes of output and when a session other
+ * than the one that last used the DRBG draws random numbers. That last
+ * rule keeps sessions of a multi-session TA from sharing buffered output.
+ */
+
+#include <string.h>
+#include <string_ext.h>
+#include <tee_api.h>
+#include <types_ext.h>
+#include <util.h>
+#include <utee_syscalls.h>
+
+#include "tee_api_private.h"
+
+#define KEY_SIZE		32
+#define BLOCK_SIZE		64
+#define BATCH_SIZE		(8 * BLOCK_SIZE)
+#define RESEED_INTERVAL		SIZE_1M
+
+#define ROTL32(v, n)		(((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTERROUND(a, b, c, d) \
+	do { \
+		a += b; d ^= a; d = ROTL32(d, 16); \
+		c += d; b ^= c; b = ROTL32(b, 12); \
+		a += b; d ^= a; d = ROTL32(d, 8); \
+		c += d; b ^= c; b = ROTL32(b, 7); \
+	} while (0)
+
+/*
+ * struct drbg_state - State of the DRBG
+ * @key:		ChaCha20 key
+ * @buf:		Output batch, bytes from @pos are unused
+ * @pos:		Offset of the first unused byte in @buf
+ * @output_count:	Bytes output since last reseed
+ * @session_id:		Session that last drew random numbers
+ * @seeded:		True once @key is mixed with kernel random numbers
+ */
+static struct drbg_state {
+	uint32_t key[KEY_SIZE / sizeof(uint32_t)];
+	uint8_t buf[BATCH_SIZE];
+	size_t pos;
+	size_t output_count;
+	unsigned long session_id;
+	bool seeded;
+} drbg = { .pos = BATCH_SIZE };
+
+/* ChaCha20 block function as in RFC 8439 with a zero nonce */
+static void chacha20_block(const uint32_t key[8], uint32_t counter,
+			   uint8_t out[BLOCK_SIZE])
+{
+	static const uint32_t sigma[4] = {
+		0x61707865, 0x3320646e, 0x79622d32, 0x6b206574
+	};
+	uint32_t in[16] = { };
+	uint32_t x[16] = { };
+	uint32_t v = 0;
+	size_t n = 0;
+
+	memcpy(in, sigma, sizeof(sigma));
+	memcpy(in + 4, key, KEY_SIZE);
+	in[12] = counter;
+	memcpy(x, in, sizeof(x));
+
+	for (n = 0; n < 10; n++) {
+		QUARTERROUND(x[0], x[4], x[8], x[12]);
+		QUARTERROUND(x[1], x[5], x[9], x[13]);
+		QUARTERROUND(x[2], x[6], x[10], x[14]);
+		QUARTERROUND(x[3], x[7], x[11], x[15]);
+		QUARTERROUND(x[0], x[5], x[10], x[15]);
+		QUARTERROUND(x[1], x[6], x[11], x[12]);
+		QUARTERROUND(x[2], x[7], x[8], x[13]);
+		QUARTERROUND(x[3], x[4], x[9], x[14]);
+	}
+
+	for (n = 0; n < 16; n++) {
+		v = x[n] + in[n];
+		out[4 * n] = v;
+		out[4 * n + 1] = v >> 8;
+		out[4 * n + 2] = v >> 16;
+		out[4 * n + 3] = v >> 24;
+	}
+
+	memzero_explicit(x, sizeof(x));
+	memzero_explicit(in, sizeof(in));
+}
+
+static void reseed(void)
+{
+	uint32_t seed[KEY_SIZE / sizeof(uint32_t)] = { };
+	TEE_Result res = TEE_ERROR_GENERIC;
+	size_t n = 0;
+
+	res = _utee_cryp_random_number_generate(seed, sizeof(seed));
+	if (res)
+		TEE_Panic(res);
+
+	for (n = 0; n < ARRAY_SIZE(drbg.key); n++)
+		drbg.key[n] ^= seed[n];
+	memzero_explicit(seed, sizeof(seed));
+
+	/* Output buffered under the previous key isn't served anymore */
+	memzero_explicit(drbg.buf, sizeof(drbg.buf));
+	drbg.pos = sizeof(drbg.buf);
+	drbg.output_count = 0;
+	drbg.seeded = true;
+}
+
+static void refill(void)
+{
+	size_t n = 0;
+
+	for (n = 0; n < BATCH_SIZE / BLOCK_SIZE; n++)
+		chacha20_block(drbg.key, n, drbg.buf + n * BLOCK_SIZE);
+
+	memcpy(drbg.key, drbg.buf, KEY_SIZE);
+	memzero_explicit(drbg.buf, KEY_SIZE);
+	drbg.pos = KEY_SIZE;
+}
+
+void __utee_drbg_enter_session(unsigned long session_id)
+{
+	if (drbg.session_id != session_id) {
+		drbg.session_id = session_id;
+		drbg.seeded = false;
+	}
+}
+
+void __utee_drbg_read(void *buf, size_t blen)
+{
+	uint8_t *b = buf;
+	size_t n = 0;
+
+	if (!drbg.seeded)
+		reseed();
+
+	while (blen) {
+		/* Large requests are served from more than one seed */
+		if (drbg.output_count >= RESEED_INTERVAL)
+			reseed();
+		if (drbg.pos == sizeof(drbg.buf))
+			refill();
+
+		n = MIN(blen, sizeof(drbg.buf) - drbg.pos);
+		n = MIN(n, RESEED_INTERVAL - drbg.output_count);
+		memcpy(b, drbg.buf + drbg.pos, n);
+		memzero_explicit(drbg.buf + drbg.pos, n);
+		drbg.pos += n;
+		drbg.output_count += n;
+		b += n;
+		blen -= n;
+	}
+}
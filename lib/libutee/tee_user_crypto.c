@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Copyright (c) 2026, Linaro Limited
+ */
+
+/*
+ * User mode implementation of digests, HMAC and AES ciphers.
+ *
+ * An operation is carried out here instead of in the TEE Core when its
+ * algorithm is one of those handled below and, for keyed algorithms, when
+ * the key is a transient object with TEE_USAGE_EXTRACTABLE set. The TA can
+ * read such a key anyway, so keeping the expanded key in TA memory doesn't
+ * expose anything new. Other keys are only known by the TEE Core and the
+ * operation falls back to system calls.
+ *
+ * The TEE Core state of the operation is still allocated so that the
+ * operation can switch back to it when given another key.
+ */
+
+#include <mbedtls/aes.h>
+#include <mbedtls/md.h>
+#include <string.h>
+#include <string_ext.h>
+#include <tee_api.h>
+#include <utee_defines.h>
+#include <util.h>
+
+#include "tee_api_private.h"
+
+/* Largest HMAC key accepted by the TEE Core, larger keys stay there */
+#define MAX_SECRET_SIZE		(1024 / 8)
+
+/*
+ * struct utee_user_crypto - User mode state of an operation
+ * @algo:		Algorithm of the operation
+ * @mode:		Mode of the operation
+ * @active:		True if the operation is carried out in user mode
+ * @md:			Digest or HMAC context
+ * @aes:		AES context with the expanded key
+ * @iv:			CBC chaining value or CTR counter block
+ * @stream_block:	CTR key stream of the current counter block
+ * @stream_offs:	Offset of the next unused byte of @stream_block
+ */
+struct utee_user_crypto {
+	uint32_t algo;
+	uint32_t mode;
+	bool active;
+	mbedtls_md_context_t md;
+	mbedtls_aes_context aes;
+	uint8_t iv[TEE_AES_BLOCK_SIZE];
+	uint8_t stream_block[TEE_AES_BLOCK_SIZE];
+	size_t stream_offs;
+};
+
+static mbedtls_md_type_t get_md_type(uint32_t algo)
+{
+	switch (algo) {
+	case TEE_ALG_MD5:
+	case TEE_ALG_HMAC_MD5:
+		return MBEDTLS_MD_MD5;
+	case TEE_ALG_SHA1:
+	case TEE_ALG_HMAC_SHA1:
+		return MBEDTLS_MD_SHA1;
+	case TEE_ALG_SHA224:
+	case TEE_ALG_HMAC_SHA224:
+		return MBEDTLS_MD_SHA224;
+	case TEE_ALG_SHA256:
+	case TEE_ALG_HMAC_SHA256:
+		return MBEDTLS_MD_SHA256;
+	case TEE_ALG_SHA384:
+	case TEE_ALG_HMAC_SHA384:
+		return MBEDTLS_MD_SHA384;
+	case TEE_ALG_SHA512:
+	case TEE_ALG_HMAC_SHA512:
+		return MBEDTLS_MD_SHA512;
+	default:
+		return MBEDTLS_MD_NONE;
+	}
+}
+
+static bool is_hmac(struct utee_user_crypto *uc)
+{
+	return TEE_ALG_GET_CLASS(uc->algo) == TEE_OPERATION_MAC;
+}
+
+static bool is_aes(uint32_t algo)
+{
+	return algo == TEE_ALG_AES_ECB_NOPAD || algo == TEE_ALG_AES_CBC_NOPAD ||
+	       algo == TEE_ALG_AES_CTR;
+}
+
+TEE_Result __utee_user_crypto_alloc(uint32_t algo, uint32_t mode,
+				    struct utee_user_crypto **uc_ret)
+{
+	const mbedtls_md_info_t *md_info = NULL;
+	struct utee_user_crypto *uc = NULL;
+
+	*uc_ret = NULL;
+
+	if (!is_aes(algo)) {
+		md_info = mbedtls_md_info_from_type(get_md_type(algo));
+		if (!md_info)
+			return TEE_SUCCESS;
+	}
+
+	uc = TEE_Malloc(sizeof(*uc), TEE_MALLOC_FILL_ZERO);
+	if (!uc)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	uc->algo = algo;
+	uc->mode = mode;
+	mbedtls_md_init(&uc->md);
+	mbedtls_aes_init(&uc->aes);
+
+	if (md_info) {
+		if (mbedtls_md_setup(&uc->md, md_info, is_hmac(uc)))
+			goto err;
+		/* Digests need no key, they can start right away */
+		if (!is_hmac(uc)) {
+			if (mbedtls_md_starts(&uc->md))
+				goto err;
+			uc->active = true;
+		}
+	}
+
+	*uc_ret = uc;
+	return TEE_SUCCESS;
+err:
+	__utee_user_crypto_free(uc);
+	return TEE_ERROR_OUT_OF_MEMORY;
+}
+
+void __utee_user_crypto_free(struct utee_user_crypto *uc)
+{
+	if (!uc)
+		return;
+
+	mbedtls_md_free(&uc->md);
+	mbedtls_aes_free(&uc->aes);
+	memzero_explicit(uc, sizeof(*uc));
+	TEE_Free(uc);
+}
+
+bool __utee_user_crypto_is_active(struct utee_user_crypto *uc)
+{
+	return uc->active;
+}
+
+void __utee_user_crypto_set_key(struct utee_user_crypto *uc,
+				TEE_ObjectHandle key)
+{
+	uint8_t secret[MAX_SECRET_SIZE] = { };
+	size_t secret_len = sizeof(secret);
+	TEE_ObjectInfo info = { };
+	int rc = 0;
+
+	if (TEE_ALG_GET_CLASS(uc->algo) == TEE_OPERATION_DIGEST)
+		return;
+
+	uc->active = false;
+	if (key == TEE_HANDLE_NULL)
+		return;
+
+	if (TEE_GetObjectInfo1(key, &info))
+		return;
+	if ((info.handleFlags & TEE_HANDLE_FLAG_PERSISTENT) ||
+	    !(info.objectUsage & TEE_USAGE_EXTRACTABLE))
+		return;
+	if (TEE_GetObjectBufferAttribute(key, TEE_ATTR_SECRET_VALUE, secret,
+					 &secret_len))
+		return;
+
+	if (is_hmac(uc))
+		rc = mbedtls_md_hmac_starts(&uc->md, secret, secret_len);
+	else if (uc->algo == TEE_ALG_AES_CTR || uc->mode == TEE_MODE_ENCRYPT)
+		rc = mbedtls_aes_setkey_enc(&uc->aes, secret, secret_len * 8);
+	else
+		rc = mbedtls_aes_setkey_dec(&uc->aes, secret, secret_len * 8);
+
+	memzero_explicit(secret, sizeof(secret));
+	uc->active = !rc;
+}
+
+void __utee_user_crypto_copy(struct utee_user_crypto *dst,
+			     struct utee_user_crypto *src)
+{
+	dst->active = src->active;
+	if (!src->active)
+		return;
+
+	if (is_aes(src->algo)) {
+		dst->aes = src->aes;
+		memcpy(dst->iv, src->iv, sizeof(dst->iv));
+		memcpy(dst->stream_block, src->stream_block,
+		       sizeof(dst->stream_block));
+		dst->stream_offs = src->stream_offs;
+	} else if (mbedtls_md_clone(&dst->md, &src->md)) {
+		TEE_Panic(0);
+	}
+}
+
+TEE_Result __utee_user_crypto_hash_init(struct utee_user_crypto *uc)
+{
+	int rc = 0;
+
+	if (is_hmac(uc))
+		rc = mbedtls_md_hmac_reset(&uc->md);
+	else
+		rc = mbedtls_md_starts(&uc->md);
+	if (rc)
+		return TEE_ERROR_BAD_STATE;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result __utee_user_crypto_hash_update(struct utee_user_crypto *uc,
+					  const void *chunk, size_t chunk_size)
+{
+	int rc = 0;
+
+	if (!chunk_size)
+		return TEE_SUCCESS;
+
+	if (is_hmac(uc))
+		rc = mbedtls_md_hmac_update(&uc->md, chunk, chunk_size);
+	else
+		rc = mbedtls_md_update(&uc->md, chunk, chunk_size);
+	if (rc)
+		return TEE_ERROR_BAD_STATE;
+
+	return TEE_SUCCESS;
+}
+
+/* Same semantics as _utee_hash_final() */
+TEE_Result __utee_user_crypto_hash_final(struct utee_user_crypto *uc,
+					 const void *chunk, size_t chunk_size,
+					 void *hash, uint64_t *hash_len)
+{
+	const mbedtls_md_info_t *md_info = mbedtls_md_info_from_ctx(&uc->md);
+	size_t hash_size = mbedtls_md_get_size(md_info);
+	TEE_Result res = TEE_SUCCESS;
+	int rc = 0;
+
+	if (*hash_len < hash_size) {
+		*hash_len = hash_size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	res = __utee_user_crypto_hash_update(uc, chunk, chunk_size);
+	if (res)
+		return res;
+
+	if (is_hmac(uc))
+		rc = mbedtls_md_hmac_finish(&uc->md, hash);
+	else
+		rc = mbedtls_md_finish(&uc->md, hash);
+	if (rc)
+		return TEE_ERROR_BAD_STATE;
+
+	*hash_len = hash_size;
+	return TEE_SUCCESS;
+}
+
+TEE_Result __utee_user_crypto_cipher_init(struct utee_user_crypto *uc,
+					  const void *iv, size_t iv_len)
+{
+	if (uc->algo == TEE_ALG_AES_ECB_NOPAD)
+		return TEE_SUCCESS;
+
+	if (!iv || iv_len != sizeof(uc->iv))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	memcpy(uc->iv, iv, sizeof(uc->iv));
+	memzero_explicit(uc->stream_block, sizeof(uc->stream_block));
+	uc->stream_offs = 0;
+
+	return TEE_SUCCESS;
+}
+
+/* Same semantics as _utee_cipher_update() and _utee_cipher_final() */
+TEE_Result __utee_user_crypto_cipher_update(struct utee_user_crypto *uc,
+					    const void *src, size_t slen,
+					    void *dst, uint64_t *dlen)
+{
+	int aes_mode = MBEDTLS_AES_DECRYPT;
+	const uint8_t *s = src;
+	uint8_t *d = dst;
+	size_t n = 0;
+	int rc = 0;
+
+	if (*dlen < slen) {
+		*dlen = slen;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	if (uc->mode == TEE_MODE_ENCRYPT)
+		aes_mode = MBEDTLS_AES_ENCRYPT;
+
+	switch (uc->algo) {
+	case TEE_ALG_AES_ECB_NOPAD:
+		if (slen % TEE_AES_BLOCK_SIZE)
+			return TEE_ERROR_BAD_PARAMETERS;
+		for (n = 0; n < slen && !rc; n += TEE_AES_BLOCK_SIZE)
+			rc = mbedtls_aes_crypt_ecb(&uc->aes, aes_mode, s + n,
+						   d + n);
+		break;
+	case TEE_ALG_AES_CBC_NOPAD:
+		if (slen % TEE_AES_BLOCK_SIZE)
+			return TEE_ERROR_BAD_PARAMETERS;
+		rc = mbedtls_aes_crypt_cbc(&uc->aes, aes_mode, slen, uc->iv, s,
+					   d);
+		break;
+	case TEE_ALG_AES_CTR:
+		rc = mbedtls_aes_crypt_ctr(&uc->aes, slen, &uc->stream_offs,
+					   uc->iv, uc->stream_block, s, d);
+		break;
+	default:
+		return TEE_ERROR_BAD_STATE;
+	}
+	if (rc)
+		return TEE_ERROR_BAD_STATE;
+
+	*dlen = slen;
+	return TEE_SUCCESS;
+}
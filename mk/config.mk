@@ -391,6 +391,18 @@ $(eval $(call cfg-depends-all,CFG_REE_FS_TA_BUFFERED,CFG_REE_FS_TA))
 # of TAs and the entire REE FS secure storage.
 CFG_REE_FS_ALLOW_RESET ?= n
 
+# When CFG_REE_FS=y:
+# CFG_REE_FS_DIRF_SHARDS, when > 0, spreads the objects of the REE FS secure
+# storage over this many directory files, a TA is assigned to one of them
+# based on its UUID. Updates of objects of TAs in different shards don't
+# wait for each other and only rewrite their own directory file plus, with
+# CFG_REE_FS_INTEGRITY_RPMB=y, the hash of the shard in RPMB or, otherwise,
+# the small dirf.db listing the shards. Objects stored with a value of 0 are
+# moved to their shard the first time it's used. Max 255.
+# Warning: this is a one-way change of the storage layout, it must not be
+# set back to 0 or changed to another number once deployed.
+CFG_REE_FS_DIRF_SHARDS ?= 0
+
 # Support for loading user TAs from a special section in the TEE binary.
 # Such TAs are available even before tee-supplicant is available (hence their
 # name), but note that many services exported to TAs may need tee-supplicant,
@@ -450,6 +462,32 @@ CFG_PAGED_USER_TA ?= $(CFG_WITH_PAGER)
 # TAG and IV in order to reduce heap usage.
 CFG_CORE_PAGE_TAG_AND_IV ?= $(CFG_PAGED_USER_TA)
 
+# Page replacement policy of the pager. The default policy evicts the oldest
+# page and periodically hides the oldest pages to detect the ones still in
+# use. With CFG_CORE_PAGER_POLICY_CLOCK=y a CLOCK (second chance) policy is
+# used instead, pages are only hidden when passed by the clock hand which
+# keeps the working set mapped.
+CFG_CORE_PAGER_POLICY_CLOCK ?= n
+
+# Maximum number of pages following a faulting read-only paged page which
+# are loaded and mapped on the same abort (fault-around), at most 32. Pages
+# are only loaded ahead if it can be done without evicting pages in use.
+CFG_CORE_PAGER_FAULT_AROUND_PAGES ?= 0
+
+# Compress read/write paged pages before they are encrypted and saved.
+# Pages are saved with a granularity of 128 bytes in a store of
+# CFG_CORE_PAGER_RWP_COMPRESS_STORE_SIZE bytes allocated from TA RAM and
+# shared by all read/write paged objects, instead of a store sized as the
+# paged objects. Dirty pages remain resident while the store is full.
+# The tag and IV of the compressed pages are kept in the core heap, so
+# CFG_CORE_PAGE_TAG_AND_IV is disabled when this is enabled.
+CFG_CORE_PAGER_RWP_COMPRESS ?= n
+CFG_CORE_PAGER_RWP_COMPRESS_STORE_SIZE ?= 0x200000
+ifeq ($(CFG_CORE_PAGER_RWP_COMPRESS)-$(CFG_CORE_PAGE_TAG_AND_IV),y-y)
+$(warning Warning: Disabling CFG_CORE_PAGE_TAG_AND_IV [not supported with CFG_CORE_PAGER_RWP_COMPRESS])
+override CFG_CORE_PAGE_TAG_AND_IV := n
+endif
+
 # Runtime lock dependency checker: ensures that a proper locking hierarchy is
 # used in the TEE core when acquiring and releasing mutexes. Any violation will
 # cause a panic as soon as the invalid locking condition is detected. If
@@ -595,6 +633,14 @@ endif
 # clients to retrieve debug and statistics information on core and loaded TAs.
 CFG_WITH_STATS ?= n
 
+# CFG_CORE_BOOT_PROFILE when enabled records the time spent in each
+# initcall and DT driver probe, including retries of deferred probes, in a
+# table of CFG_CORE_BOOT_PROFILE_ENTRIES entries. The table is printed at
+# info level at the end of boot and can be retrieved with the stats PTA
+# command STATS_CMD_BOOT_PROFILE. Timings require CFG_CORE_HAS_GENERIC_TIMER.
+CFG_CORE_BOOT_PROFILE ?= n
+CFG_CORE_BOOT_PROFILE_ENTRIES ?= 256
+
 # CFG_DRIVERS_DT_RECURSIVE_PROBE when enabled forces a recursive subnode
 # parsing in the embedded DTB for driver probing. The alternative is
 # an exploration based on compatible drivers found. It is default disabled.
@@ -668,6 +714,15 @@ endif
 # Enable Global Platform Sockets support
 CFG_GP_SOCKETS ?= y
 
+# CFG_GP_SOCKETS_RECV_BUF_SIZE
+# Size in bytes of a read-ahead buffer kept in secure memory for each TCP
+# socket opened by a TA, 0 to disable. A receive then asks tee-supplicant
+# for as much as fits in the buffer and following receives are served from
+# it without RPC. This helps protocols reading small chunks at a time like
+# TLS does with its record headers. The buffer is allocated once when the
+# socket is opened.
+CFG_GP_SOCKETS_RECV_BUF_SIZE ?= 0
+
 # Enable Secure Data Path support in OP-TEE core (TA may be invoked with
 # invocation parameters referring to specific secure memories).
 CFG_SECURE_DATA_PATH ?= n
@@ -706,6 +761,15 @@ $(eval $(call cfg-depends-all,CFG_ATTESTATION_PTA,_CFG_WITH_SECURE_STORAGE))
 #  emLen = ceil((modBits - 1) / 8) => emLen is the key size in bytes
 CFG_ATTESTATION_PTA_KEY_SIZE ?= 3072
 
+# When enabled, the attestation PTA computes the hash of the TEE core memory
+# only once and keeps, for each session, the hash of the memory of the
+# calling TA. The hash of the TA is computed again only when the set of
+# read-only regions of the TA has changed. Read-only regions of a TA can't
+# be made writable, but note that with this enabled a modification of the
+# measured memory that bypasses the memory mappings isn't detected by
+# later requests.
+CFG_ATTESTATION_PTA_CACHE_MEASUREMENTS ?= n
+
 # Define the number of cores per cluster used in calculating core position.
 # The cluster number is shifted by this value and added to the core ID,
 # so its value represents log2(cores/cluster).
@@ -726,6 +790,14 @@ CFG_CORE_DYN_SHM ?= y
 # memory area).
 CFG_CORE_RESERVED_SHM ?= y
 
+# CFG_CORE_RPC_ARENA_SIZE, size in bytes of an arena of shared memory
+# serving RPC payload allocations, 0 to disable. The arena is allocated
+# from normal world once, when payload memory is first needed, and
+# allocations from it then need no RPC. Allocations that don't fit use an
+# RPC each as without the arena. The arena is dropped and allocated again
+# if an RPC fails to use it, as after a restart of tee-supplicant.
+CFG_CORE_RPC_ARENA_SIZE ?= 0
+
 # Enables support for larger physical addresses, that is, it will define
 # paddr_t as a 64-bit type.
 CFG_CORE_LARGE_PHYS_ADDR ?= n
@@ -736,6 +808,22 @@ CFG_CORE_LARGE_PHYS_ADDR ?= n
 # Set this to a lower value to reduce the TA memory footprint.
 CFG_TA_BIGNUM_MAX_BITS ?= 2048
 
+# CFG_TA_USER_DRBG when enabled makes TEE_GenerateRandom() and rand() in
+# TAs draw from a ChaCha20 based DRBG in libutee instead of issuing a
+# system call for each request. Each TA instance has its own DRBG, seeded
+# from the TEE core RNG on first use, after each MiB of output and when
+# another session of the TA draws random numbers.
+CFG_TA_USER_DRBG ?= n
+
+# CFG_TA_USER_CRYPTO when enabled makes libutee carry out digests, HMAC and
+# AES ECB/CBC/CTR (no padding) operations in user mode with libmbedtls
+# instead of issuing system calls. Keyed operations only do so when the key
+# is a transient object with TEE_USAGE_EXTRACTABLE set; other keys stay in
+# the TEE core and their operations use system calls as usual. On arm64
+# platforms with CFG_CRYPTO_WITH_CE=y and CFG_TA_FLOAT_SUPPORT=y the ARMv8
+# Crypto Extensions are used for AES and SHA-256.
+CFG_TA_USER_CRYPTO ?= n
+
 # Not used since libmpa was removed. Force the values to catch build scripts
 # that would set = n.
 $(call force,CFG_TA_MBEDTLS_MPI,y)
@@ -782,6 +870,22 @@ $(call force,CFG_CORE_RWDATA_NOEXEC,y)
 
 # Default number of virtual guests
 CFG_VIRT_GUEST_COUNT ?= 2
+
+# Number of threads a guest may have allocated at the same time, so that a
+# busy guest can't take all of the CFG_NUM_THREADS threads. 0 means no
+# limit. Platforms can give guests different quotas by overriding
+# virt_guest_max_threads().
+CFG_VIRT_GUEST_MAX_THREADS ?= 0
+endif
+
+# CFG_DT_DRIVER_ASYNC_PROBE when enabled takes DT drivers flagged with
+# async_probe out of the boot probe sequence: they are probed once the other
+# driver initcalls are done, still before boot resources are released.
+CFG_DT_DRIVER_ASYNC_PROBE ?= n
+ifeq ($(CFG_DT_DRIVER_ASYNC_PROBE),y)
+ifneq ($(CFG_DT),y)
+$(error CFG_DT_DRIVER_ASYNC_PROBE requires CFG_DT)
+endif
 endif
 
 # Enables backwards compatible derivation of RPMB and SSK keys
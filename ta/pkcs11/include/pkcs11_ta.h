@@ -713,6 +713,87 @@ enum pkcs11_ta_cmd {
 	 * This command relates to the PKCS#11 API function C_UnwrapKey().
 	 */
 	PKCS11_CMD_UNWRAP_KEY = 52,
+
+	/*
+	 * PKCS11_CMD_CREATE_OBJECTS - Create several raw client assembled
+	 *                             objects in the session or token
+	 *
+	 * [in]  memref[0] = [
+	 *              32bit session handle,
+	 *              32bit object count,
+	 *              object count times:
+	 *              (struct pkcs11_object_head)attribs + attributes data
+	 *	 ]
+	 * [out] memref[0] = 32bit return code, enum pkcs11_rc
+	 * [out] memref[2] = object count times 32bit object handle
+	 *
+	 * This command relates to the PKCS#11 API function C_CreateObject()
+	 * called for each object. Either all objects are created or none.
+	 */
+	PKCS11_CMD_CREATE_OBJECTS = 53,
+
+	/*
+	 * PKCS11_CMD_DESTROY_OBJECTS - Destroy several objects
+	 *
+	 * [in]  memref[0] = [
+	 *              32bit session handle,
+	 *              32bit object count,
+	 *              object count times 32bit object handle
+	 *	 ]
+	 * [out] memref[0] = 32bit return code, enum pkcs11_rc
+	 *
+	 * This command relates to the PKCS#11 API function C_DestroyObject()
+	 * called for each object. No object is destroyed if any of them
+	 * cannot be destroyed.
+	 */
+	PKCS11_CMD_DESTROY_OBJECTS = 54,
+
+	/*
+	 * PKCS11_CMD_SIGN_MULTI - Compute signatures of several messages
+	 *
+	 * [in]  memref[0] = [
+	 *              32bit session handle,
+	 *              32bit key handle,
+	 *              (struct pkcs11_attribute_head)mechanism + mecha params,
+	 *              32bit message count
+	 *	 ]
+	 * [out] memref[0] = 32bit return code, enum pkcs11_rc
+	 * [in]  memref[1] = message count times:
+	 *              32bit data byte size, data to be signed
+	 * [out] memref[2] = message count times:
+	 *              32bit signature byte size, signature
+	 *
+	 * This command relates to the PKCS#11 API function C_SignInit()
+	 * followed by C_Sign() called for each message. The messages are all
+	 * checked before any is signed. If memref[2] is too small, the
+	 * command returns PKCS11_CKR_BUFFER_TOO_SMALL with the required size
+	 * in memref[2].
+	 */
+	PKCS11_CMD_SIGN_MULTI = 55,
+
+	/*
+	 * PKCS11_CMD_VERIFY_MULTI - Verify signatures of several messages
+	 *
+	 * [in]  memref[0] = [
+	 *              32bit session handle,
+	 *              32bit key handle,
+	 *              (struct pkcs11_attribute_head)mechanism + mecha params,
+	 *              32bit message count
+	 *	 ]
+	 * [out] memref[0] = 32bit return code, enum pkcs11_rc
+	 * [in]  memref[1] = message count times:
+	 *              32bit data byte size, signed data,
+	 *              32bit signature byte size, signature
+	 * [out] memref[2] = message count times 32bit return code of the
+	 *              signature verification, enum pkcs11_rc
+	 *
+	 * This command relates to the PKCS#11 API function C_VerifyInit()
+	 * followed by C_Verify() called for each message. The messages are
+	 * all checked before any is verified. The command return code
+	 * reports errors preventing the verification of the messages, the
+	 * verification result of each message is reported in memref[2].
+	 */
+	PKCS11_CMD_VERIFY_MULTI = 56,
 };
 
 /*
@@ -18,6 +18,44 @@
 #include "pkcs11_helpers.h"
 #include "serializer.h"
 
+/*
+ * Index in use by attribute lookups, if any. The index is dropped and
+ * invalidated once its serialized attributes are modified or freed, so
+ * that a later allocation reusing the same address never matches it.
+ */
+static struct obj_attrs_index *active_index;
+
+struct obj_attrs_index_entry {
+	uint32_t id;
+	uint32_t offset;
+};
+
+/*
+ * Lookup index of serialized attributes
+ *
+ * @head:	Indexed serialized attributes, NULL once invalidated
+ * @attrs_size:	Value of @head->attrs_size when indexed
+ * @attrs_count: Value of @head->attrs_count when indexed
+ * @count:	Number of entries in @entry
+ * @entry:	Attribute IDs and offset of their entry in @head->attrs,
+ *		sorted by ID then offset
+ */
+struct obj_attrs_index {
+	struct obj_attrs *head;
+	uint32_t attrs_size;
+	uint32_t attrs_count;
+	uint32_t count;
+	struct obj_attrs_index_entry entry[];
+};
+
+static void invalidate_attributes_index(struct obj_attrs *head)
+{
+	if (active_index && active_index->head == head) {
+		active_index->head = NULL;
+		active_index = NULL;
+	}
+}
+
 enum pkcs11_rc init_attributes_head(struct obj_attrs **head)
 {
 	*head = TEE_Malloc(sizeof(**head), TEE_MALLOC_FILL_ZERO);
@@ -27,34 +65,257 @@ enum pkcs11_rc init_attributes_head(struct obj_attrs **head)
 	return PKCS11_CKR_OK;
 }
 
+void release_attributes(struct obj_attrs *head)
+{
+	invalidate_attributes_index(head);
+	TEE_Free(head);
+}
+
 enum pkcs11_rc add_attribute(struct obj_attrs **head, uint32_t attribute,
 			     void *data, size_t size)
 {
 	size_t buf_len = sizeof(struct obj_attrs) + (*head)->attrs_size;
-	char **bstart = (void *)head;
-	enum pkcs11_rc rc = PKCS11_CKR_OK;
-	uint32_t data32 = 0;
-
-	data32 = attribute;
-	rc = serialize(bstart, &buf_len, &data32, sizeof(uint32_t));
-	if (rc)
-		return rc;
-
-	data32 = size;
-	rc = serialize(bstart, &buf_len, &data32, sizeof(uint32_t));
-	if (rc)
-		return rc;
+	struct pkcs11_attribute_head pkcs11_ref = {
+		.id = attribute,
+		.size = size,
+	};
+	size_t new_len = 0;
+	char *buf = NULL;
+
+	if (size > UINT32_MAX ||
+	    ADD_OVERFLOW(buf_len, sizeof(pkcs11_ref), &new_len) ||
+	    ADD_OVERFLOW(new_len, size, &new_len))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	invalidate_attributes_index(*head);
+
+	/* Single reallocation for both the entry header and its value */
+	buf = TEE_Realloc(*head, new_len);
+	if (!buf)
+		return PKCS11_CKR_DEVICE_MEMORY;
 
-	rc = serialize(bstart, &buf_len, data, size);
-	if (rc)
-		return rc;
+	TEE_MemMove(buf + buf_len, &pkcs11_ref, sizeof(pkcs11_ref));
+	if (size)
+		TEE_MemMove(buf + buf_len + sizeof(pkcs11_ref), data, size);
 
 	/* Alloced buffer is always well aligned */
-	head = (void *)bstart;
-	(*head)->attrs_size += 2 * sizeof(uint32_t) + size;
+	*head = (void *)buf;
+	(*head)->attrs_size += sizeof(pkcs11_ref) + size;
 	(*head)->attrs_count++;
 
-	return rc;
+	return PKCS11_CKR_OK;
+}
+
+enum pkcs11_rc init_attributes_builder(struct obj_attrs_builder *builder,
+				       size_t size_hint)
+{
+	builder->capacity = MAX(size_hint, sizeof(struct obj_attrs));
+	builder->head = TEE_Malloc(builder->capacity, TEE_MALLOC_FILL_ZERO);
+	if (!builder->head) {
+		builder->capacity = 0;
+		return PKCS11_CKR_DEVICE_MEMORY;
+	}
+
+	return PKCS11_CKR_OK;
+}
+
+enum pkcs11_rc builder_add_attribute(struct obj_attrs_builder *builder,
+				     uint32_t attribute, void *data,
+				     size_t size)
+{
+	size_t used = sizeof(struct obj_attrs) + builder->head->attrs_size;
+	struct pkcs11_attribute_head pkcs11_ref = {
+		.id = attribute,
+		.size = size,
+	};
+	size_t new_len = 0;
+	char *buf = NULL;
+
+	if (size > UINT32_MAX ||
+	    ADD_OVERFLOW(used, sizeof(pkcs11_ref), &new_len) ||
+	    ADD_OVERFLOW(new_len, size, &new_len))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	if (new_len > builder->capacity) {
+		size_t capacity = 0;
+
+		if (MUL_OVERFLOW(builder->capacity, 2, &capacity))
+			capacity = new_len;
+		capacity = MAX(capacity, new_len);
+
+		buf = TEE_Realloc(builder->head, capacity);
+		if (!buf)
+			return PKCS11_CKR_DEVICE_MEMORY;
+
+		builder->head = (void *)buf;
+		builder->capacity = capacity;
+	}
+
+	buf = (char *)builder->head;
+	TEE_MemMove(buf + used, &pkcs11_ref, sizeof(pkcs11_ref));
+	if (size)
+		TEE_MemMove(buf + used + sizeof(pkcs11_ref), data, size);
+
+	builder->head->attrs_size += sizeof(pkcs11_ref) + size;
+	builder->head->attrs_count++;
+
+	return PKCS11_CKR_OK;
+}
+
+struct obj_attrs *builder_get_attributes(struct obj_attrs_builder *builder)
+{
+	struct obj_attrs *head = builder->head;
+
+	builder->head = NULL;
+	builder->capacity = 0;
+
+	return head;
+}
+
+void release_attributes_builder(struct obj_attrs_builder *builder)
+{
+	TEE_Free(builder->head);
+	builder->head = NULL;
+	builder->capacity = 0;
+}
+
+static int cmp_index_entry(const void *a, const void *b)
+{
+	const struct obj_attrs_index_entry *e1 = a;
+	const struct obj_attrs_index_entry *e2 = b;
+
+	if (e1->id != e2->id)
+		return CMP_TRILEAN(e1->id, e2->id);
+
+	return CMP_TRILEAN(e1->offset, e2->offset);
+}
+
+enum pkcs11_rc init_attributes_index(struct obj_attrs *head,
+				     struct obj_attrs_index **index)
+{
+	struct obj_attrs_index *idx = NULL;
+	size_t offset = 0;
+	size_t size = 0;
+	size_t n = 0;
+
+	if (MUL_OVERFLOW(head->attrs_count, sizeof(idx->entry[0]), &size) ||
+	    ADD_OVERFLOW(size, sizeof(*idx), &size))
+		return PKCS11_CKR_DEVICE_MEMORY;
+
+	idx = TEE_Malloc(size, TEE_MALLOC_FILL_ZERO);
+	if (!idx)
+		return PKCS11_CKR_DEVICE_MEMORY;
+
+	while (offset < head->attrs_size) {
+		struct pkcs11_attribute_head pkcs11_ref = { };
+
+		if (n == head->attrs_count ||
+		    head->attrs_size - offset < sizeof(pkcs11_ref))
+			goto err;
+
+		TEE_MemMove(&pkcs11_ref, head->attrs + offset,
+			    sizeof(pkcs11_ref));
+
+		if (pkcs11_ref.size >
+		    head->attrs_size - offset - sizeof(pkcs11_ref))
+			goto err;
+
+		idx->entry[n].id = pkcs11_ref.id;
+		idx->entry[n].offset = offset;
+		n++;
+
+		offset += sizeof(pkcs11_ref) + pkcs11_ref.size;
+	}
+
+	qsort(idx->entry, n, sizeof(idx->entry[0]), cmp_index_entry);
+
+	idx->head = head;
+	idx->attrs_size = head->attrs_size;
+	idx->attrs_count = head->attrs_count;
+	idx->count = n;
+	*index = idx;
+
+	return PKCS11_CKR_OK;
+
+err:
+	DMSG("Cannot index inconsistent serialized attributes");
+	TEE_Free(idx);
+
+	return PKCS11_CKR_GENERAL_ERROR;
+}
+
+void release_attributes_index(struct obj_attrs_index *index)
+{
+	if (active_index == index)
+		active_index = NULL;
+
+	TEE_Free(index);
+}
+
+bool attributes_index_is_valid(struct obj_attrs_index *index,
+			       struct obj_attrs *head)
+{
+	/*
+	 * Only the index in use is invalidated when its serialized
+	 * attributes are modified or freed: also compare the recorded
+	 * layout so that an index left aside is not matched against other
+	 * attributes allocated at the same address.
+	 */
+	return index && head && index->head == head &&
+	       index->attrs_size == head->attrs_size &&
+	       index->attrs_count == head->attrs_count;
+}
+
+void use_attributes_index(struct obj_attrs_index *index)
+{
+	active_index = index;
+}
+
+static void get_indexed_attribute_ptrs(struct obj_attrs_index *index,
+				       uint32_t attribute, void **attr,
+				       uint32_t *attr_size, size_t *count)
+{
+	size_t max_found = *count;
+	size_t found = 0;
+	size_t lo = 0;
+	size_t hi = index->count;
+	size_t n = 0;
+
+	/* Lowest entry with a matching ID, entries are sorted by ID */
+	while (lo < hi) {
+		n = lo + (hi - lo) / 2;
+		if (index->entry[n].id < attribute)
+			lo = n + 1;
+		else
+			hi = n;
+	}
+
+	for (n = lo; n < index->count && index->entry[n].id == attribute; n++) {
+		uint8_t *cur = index->head->attrs + index->entry[n].offset;
+		struct pkcs11_attribute_head pkcs11_ref = { };
+
+		found++;
+
+		if (!max_found)
+			continue;	/* only count matching attributes */
+
+		TEE_MemMove(&pkcs11_ref, cur, sizeof(pkcs11_ref));
+
+		if (attr) {
+			if (pkcs11_ref.size)
+				*attr++ = cur + sizeof(pkcs11_ref);
+			else
+				*attr++ = NULL;
+		}
+
+		if (attr_size)
+			*attr_size++ = pkcs11_ref.size;
+
+		if (found == max_found)
+			break;
+	}
+
+	*count = found;
 }
 
 static enum pkcs11_rc _remove_attribute(struct obj_attrs **head,
@@ -80,6 +341,8 @@ static enum pkcs11_rc _remove_attribute(struct obj_attrs **head,
 		if (empty && pkcs11_ref.size)
 			return PKCS11_CKR_FUNCTION_FAILED;
 
+		invalidate_attributes_index(h);
+
 		TEE_MemMove(cur, cur + next_off, end - (cur + next_off));
 
 		h->attrs_count--;
@@ -111,6 +374,12 @@ void get_attribute_ptrs(struct obj_attrs *head, uint32_t attribute,
 	void **attr_ptr = attr;
 	uint32_t *attr_size_ptr = attr_size;
 
+	if (active_index && active_index->head == head) {
+		get_indexed_attribute_ptrs(active_index, attribute, attr,
+					   attr_size, count);
+		return;
+	}
+
 	for (; cur < end; cur += next_off) {
 		/* Structure aligned copy of the pkcs11_ref in the object */
 		struct pkcs11_attribute_head pkcs11_ref = { };
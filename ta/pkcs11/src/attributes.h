@@ -71,6 +71,16 @@ struct obj_attrs {
  */
 enum pkcs11_rc init_attributes_head(struct obj_attrs **head);
 
+/*
+ * release_attributes() - Free serialized attributes
+ * @head:	Serialized attributes to free, may be NULL
+ *
+ * Serialized attributes that may have been indexed with
+ * init_attributes_index() must be freed with this function rather than
+ * TEE_Free() so that attribute lookups stop using their index.
+ */
+void release_attributes(struct obj_attrs *head);
+
 /*
  * add_attribute() - Update serialized attributes to add an entry.
  *
@@ -85,6 +95,110 @@ enum pkcs11_rc init_attributes_head(struct obj_attrs **head);
 enum pkcs11_rc add_attribute(struct obj_attrs **head, uint32_t attribute,
 			     void *data, size_t size);
 
+/*
+ * Builder for serialized attributes
+ *
+ * @head:	Serialized attributes being built
+ * @capacity:	Byte size allocated for @head, including struct obj_attrs
+ *
+ * Unlike add_attribute() which reallocates the serialized attributes for
+ * each added entry, the builder appends entries in a buffer sized once
+ * from a hint, growing it geometrically only if the hint was too short.
+ */
+struct obj_attrs_builder {
+	struct obj_attrs *head;
+	size_t capacity;
+};
+
+/*
+ * init_attributes_builder() - Allocate an empty builder
+ * @builder:	Builder to initialize
+ * @size_hint:	Expected byte size of the serialized attributes, including
+ *		struct obj_attrs
+ *
+ * Return PKCS11_CKR_OK on success or a PKCS11 return code.
+ */
+enum pkcs11_rc init_attributes_builder(struct obj_attrs_builder *builder,
+				       size_t size_hint);
+
+/*
+ * builder_add_attribute() - Append an entry to the built attributes
+ * @builder:	Builder initialized with init_attributes_builder()
+ * @attribute:	Attribute ID to add
+ * @data:	Opaque data of attribute
+ * @size:	Size of data
+ *
+ * Return PKCS11_CKR_OK on success or a PKCS11 return code.
+ */
+enum pkcs11_rc builder_add_attribute(struct obj_attrs_builder *builder,
+				     uint32_t attribute, void *data,
+				     size_t size);
+
+/*
+ * builder_get_attributes() - Retrieve the built serialized attributes
+ * @builder:	Builder initialized with init_attributes_builder()
+ *
+ * Ownership of the serialized attributes is transferred to the caller which
+ * shall release them with TEE_Free(). The builder is left empty.
+ */
+struct obj_attrs *builder_get_attributes(struct obj_attrs_builder *builder);
+
+/*
+ * release_attributes_builder() - Free the attributes held by a builder
+ * @builder:	Builder initialized with init_attributes_builder()
+ */
+void release_attributes_builder(struct obj_attrs_builder *builder);
+
+/*
+ * Lookup index of serialized attributes: attribute IDs sorted with the
+ * offset of their entry in the serialized attributes. Serialized
+ * attributes are left untouched, the index is an in-memory helper only.
+ */
+struct obj_attrs_index;
+
+/*
+ * init_attributes_index() - Build the lookup index of serialized attributes
+ * @head:	Serialized attributes to index
+ * @index:	*@index holds the allocated index
+ *
+ * The index refers to @head which is expected to remain unmodified while
+ * the index is in use.
+ *
+ * Return PKCS11_CKR_OK on success or a PKCS11 return code.
+ */
+enum pkcs11_rc init_attributes_index(struct obj_attrs *head,
+				     struct obj_attrs_index **index);
+
+/*
+ * release_attributes_index() - Free an index from init_attributes_index()
+ * @index:	Index to release, may be NULL
+ */
+void release_attributes_index(struct obj_attrs_index *index);
+
+/*
+ * attributes_index_is_valid() - Check an index refers to serialized attributes
+ * @index:	Index or NULL
+ * @head:	Serialized attributes
+ *
+ * Return false if @index is NULL, was built for other serialized attributes
+ * or was invalidated as its serialized attributes were modified.
+ */
+bool attributes_index_is_valid(struct obj_attrs_index *index,
+			       struct obj_attrs *head);
+
+/*
+ * use_attributes_index() - Set the index used by attribute lookups
+ * @index:	Index to use or NULL to stop using the current index
+ *
+ * While set, get_attribute_ptrs() and the helpers built on it resolve the
+ * attributes of the indexed serialized attributes with a binary search in
+ * the index instead of scanning them. The TA being single threaded, only
+ * one index is in use at a time. Adding or removing attributes in the
+ * indexed serialized attributes, or freeing them with release_attributes(),
+ * invalidates the index and stops its use.
+ */
+void use_attributes_index(struct obj_attrs_index *index);
+
 /*
  * Update serialized attributes to remove an empty entry. Can relocate the
  * attribute list buffer. Only 1 instance of the entry is expected.
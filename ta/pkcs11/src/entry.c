@@ -208,6 +208,12 @@ TEE_Result TA_InvokeCommandEntryPoint(void *tee_session, uint32_t cmd,
 	case PKCS11_CMD_DESTROY_OBJECT:
 		rc = entry_destroy_object(client, ptypes, params);
 		break;
+	case PKCS11_CMD_CREATE_OBJECTS:
+		rc = entry_create_objects(client, ptypes, params);
+		break;
+	case PKCS11_CMD_DESTROY_OBJECTS:
+		rc = entry_destroy_objects(client, ptypes, params);
+		break;
 
 	case PKCS11_CMD_ENCRYPT_INIT:
 		rc = entry_processing_init(client, ptypes, params,
@@ -285,6 +291,14 @@ TEE_Result TA_InvokeCommandEntryPoint(void *tee_session, uint32_t cmd,
 					   PKCS11_FUNCTION_VERIFY,
 					   PKCS11_FUNC_STEP_FINAL);
 		break;
+	case PKCS11_CMD_SIGN_MULTI:
+		rc = entry_processing_multi(client, ptypes, params,
+					    PKCS11_FUNCTION_SIGN);
+		break;
+	case PKCS11_CMD_VERIFY_MULTI:
+		rc = entry_processing_multi(client, ptypes, params,
+					    PKCS11_FUNCTION_VERIFY);
+		break;
 	case PKCS11_CMD_GENERATE_KEY:
 		rc = entry_generate_secret(client, ptypes, params);
 		break;
@@ -62,6 +62,25 @@ uint32_t pkcs11_object2handle(struct pkcs11_object *obj,
 	return handle_lookup_handle(get_object_handle_db(session), obj);
 }
 
+void use_object_attributes_index(struct pkcs11_object *obj)
+{
+	if (!attributes_index_is_valid(obj->attrs_index, obj->attributes)) {
+		release_object_attributes_index(obj);
+
+		if (obj->attributes &&
+		    init_attributes_index(obj->attributes, &obj->attrs_index))
+			DMSG("Lookups in object attributes not indexed");
+	}
+
+	use_attributes_index(obj->attrs_index);
+}
+
+void release_object_attributes_index(struct pkcs11_object *obj)
+{
+	release_attributes_index(obj->attrs_index);
+	obj->attrs_index = NULL;
+}
+
 /* Currently handle pkcs11 sessions and tokens */
 
 static struct object_list *get_session_objects(void *session)
@@ -93,7 +112,8 @@ static void cleanup_volatile_obj_ref(struct pkcs11_object *obj)
 	if (obj->attribs_hdl != TEE_HANDLE_NULL)
 		TEE_CloseObject(obj->attribs_hdl);
 
-	TEE_Free(obj->attributes);
+	release_object_attributes_index(obj);
+	release_attributes(obj->attributes);
 	TEE_Free(obj->uuid);
 	TEE_Free(obj);
 }
@@ -162,6 +182,7 @@ void destroy_object(struct pkcs11_session *session, struct pkcs11_object *obj,
 		cleanup_persistent_object(obj, session->token);
 
 		token_invalidate_object_handles(obj);
+		maybe_compact_persistent_db(session->token);
 	} else {
 		handle_put(get_object_handle_db(session),
 			   pkcs11_object2handle(obj, session));
@@ -266,7 +287,7 @@ enum pkcs11_rc create_object(void *sess, struct obj_attrs *head,
 		}
 
 		rc = register_persistent_object(get_session_token(session),
-						obj->uuid);
+						obj);
 		if (rc)
 			goto err;
 
@@ -276,6 +297,7 @@ enum pkcs11_rc create_object(void *sess, struct obj_attrs *head,
 		/* Move object from temporary list to target token list */
 		LIST_REMOVE(obj, link);
 		LIST_INSERT_HEAD(&session->token->object_list, obj, link);
+		maybe_compact_persistent_db(session->token);
 	} else {
 		/* Move object from temporary list to target session list */
 		LIST_REMOVE(obj, link);
@@ -287,6 +309,7 @@ enum pkcs11_rc create_object(void *sess, struct obj_attrs *head,
 	return PKCS11_CKR_OK;
 err:
 	/* make sure that supplied "head" isn't freed */
+	release_object_attributes_index(obj);
 	obj->attributes = NULL;
 	handle_put(get_object_handle_db(session), obj_handle);
 	if (get_bool(head, PKCS11_CKA_TOKEN))
@@ -297,58 +320,26 @@ err:
 	return rc;
 }
 
-enum pkcs11_rc entry_create_object(struct pkcs11_client *client,
-				   uint32_t ptypes, TEE_Param *params)
+/*
+ * Create an object from a client template. On success the new object
+ * handle is returned in @obj_handle. @template is only read, the caller
+ * keeps ownership of it and frees it whatever the result.
+ */
+static enum pkcs11_rc import_object(struct pkcs11_session *session,
+				    struct pkcs11_object_head *template,
+				    uint32_t *obj_handle)
 {
-	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
-						TEE_PARAM_TYPE_NONE,
-						TEE_PARAM_TYPE_MEMREF_OUTPUT,
-						TEE_PARAM_TYPE_NONE);
 	enum pkcs11_rc rc = PKCS11_CKR_OK;
-	TEE_Param *ctrl = params;
-	TEE_Param *out = params + 2;
-	struct serialargs ctrlargs = { };
-	struct pkcs11_session *session = NULL;
 	struct obj_attrs *head = NULL;
-	struct pkcs11_object_head *template = NULL;
-	size_t template_size = 0;
-	uint32_t obj_handle = 0;
-
-	/*
-	 * Collect the arguments of the request
-	 */
-
-	if (!client || ptypes != exp_pt ||
-	    out->memref.size != sizeof(obj_handle))
-		return PKCS11_CKR_ARGUMENTS_BAD;
-
-	serialargs_init(&ctrlargs, ctrl->memref.buffer, ctrl->memref.size);
-
-	rc = serialargs_get_session_from_handle(&ctrlargs, client, &session);
-	if (rc)
-		return rc;
-
-	rc = serialargs_alloc_get_attributes(&ctrlargs, &template);
-	if (rc)
-		return rc;
-
-	if (serialargs_remaining_bytes(&ctrlargs)) {
-		rc = PKCS11_CKR_ARGUMENTS_BAD;
-		goto out;
-	}
-
-	template_size = sizeof(*template) + template->attrs_size;
+	size_t template_size = sizeof(*template) + template->attrs_size;
 
 	/*
 	 * Prepare a clean initial state for the requested object attributes.
-	 * Free temporary template once done.
 	 */
 	rc = create_attributes_from_template(&head, template, template_size,
 					     NULL, PKCS11_FUNCTION_IMPORT,
 					     PKCS11_PROCESSING_IMPORT,
 					     PKCS11_CKO_UNDEFINED_ID);
-	TEE_Free(template);
-	template = NULL;
 	if (rc)
 		goto out;
 
@@ -379,7 +370,7 @@ enum pkcs11_rc entry_create_object(struct pkcs11_client *client,
 	 * referenced in @head, including the key value and are assumed
 	 * reliable. Now need to register it and get a handle for it.
 	 */
-	rc = create_object(session, head, &obj_handle);
+	rc = create_object(session, head, obj_handle);
 	if (rc)
 		goto out;
 
@@ -392,32 +383,84 @@ enum pkcs11_rc entry_create_object(struct pkcs11_client *client,
 	 */
 	head = NULL;
 
+	DMSG("PKCS11 session %"PRIu32": import object %#"PRIx32,
+	     session->handle, *obj_handle);
+
+out:
+	TEE_Free(head);
+
+	return rc;
+}
+
+enum pkcs11_rc entry_create_object(struct pkcs11_client *client,
+				   uint32_t ptypes, TEE_Param *params)
+{
+	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_MEMREF_OUTPUT,
+						TEE_PARAM_TYPE_NONE);
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
+	TEE_Param *ctrl = params;
+	TEE_Param *out = params + 2;
+	struct serialargs ctrlargs = { };
+	struct pkcs11_session *session = NULL;
+	struct pkcs11_object_head *template = NULL;
+	uint32_t obj_handle = 0;
+
+	/*
+	 * Collect the arguments of the request
+	 */
+
+	if (!client || ptypes != exp_pt ||
+	    out->memref.size != sizeof(obj_handle))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	serialargs_init(&ctrlargs, ctrl->memref.buffer, ctrl->memref.size);
+
+	rc = serialargs_get_session_from_handle(&ctrlargs, client, &session);
+	if (rc)
+		return rc;
+
+	rc = serialargs_alloc_get_attributes(&ctrlargs, &template);
+	if (rc)
+		return rc;
+
+	if (serialargs_remaining_bytes(&ctrlargs)) {
+		rc = PKCS11_CKR_ARGUMENTS_BAD;
+		goto out;
+	}
+
+	rc = import_object(session, template, &obj_handle);
+	if (rc)
+		goto out;
+
 	TEE_MemMove(out->memref.buffer, &obj_handle, sizeof(obj_handle));
 	out->memref.size = sizeof(obj_handle);
 
-	DMSG("PKCS11 session %"PRIu32": import object %#"PRIx32,
-	     session->handle, obj_handle);
-
 out:
 	TEE_Free(template);
-	TEE_Free(head);
 
 	return rc;
 }
 
-enum pkcs11_rc entry_destroy_object(struct pkcs11_client *client,
+enum pkcs11_rc entry_create_objects(struct pkcs11_client *client,
 				    uint32_t ptypes, TEE_Param *params)
 {
 	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
 						TEE_PARAM_TYPE_NONE,
-						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_MEMREF_OUTPUT,
 						TEE_PARAM_TYPE_NONE);
 	enum pkcs11_rc rc = PKCS11_CKR_OK;
 	TEE_Param *ctrl = params;
+	TEE_Param *out = params + 2;
 	struct serialargs ctrlargs = { };
-	uint32_t object_handle = 0;
 	struct pkcs11_session *session = NULL;
-	struct pkcs11_object *object = NULL;
+	struct pkcs11_object_head *template = NULL;
+	struct pkcs11_object *obj = NULL;
+	uint32_t *handles = NULL;
+	size_t handles_size = 0;
+	uint32_t count = 0;
+	uint32_t n = 0;
 
 	if (!client || ptypes != exp_pt)
 		return PKCS11_CKR_ARGUMENTS_BAD;
@@ -428,17 +471,58 @@ enum pkcs11_rc entry_destroy_object(struct pkcs11_client *client,
 	if (rc)
 		return rc;
 
-	rc = serialargs_get_u32(&ctrlargs, &object_handle);
+	rc = serialargs_get_u32(&ctrlargs, &count);
 	if (rc)
 		return rc;
 
-	if (serialargs_remaining_bytes(&ctrlargs))
+	if (!count ||
+	    MUL_OVERFLOW(count, sizeof(*handles), &handles_size) ||
+	    out->memref.size != handles_size)
 		return PKCS11_CKR_ARGUMENTS_BAD;
 
-	object = pkcs11_handle2object(object_handle, session);
-	if (!object)
-		return PKCS11_CKR_OBJECT_HANDLE_INVALID;
+	handles = TEE_Malloc(handles_size, TEE_MALLOC_FILL_ZERO);
+	if (!handles)
+		return PKCS11_CKR_DEVICE_MEMORY;
+
+	for (n = 0; n < count; n++) {
+		rc = serialargs_alloc_get_attributes(&ctrlargs, &template);
+		if (rc)
+			goto out;
+
+		rc = import_object(session, template, handles + n);
+		TEE_Free(template);
+		template = NULL;
+		if (rc)
+			goto out;
+	}
+
+	if (serialargs_remaining_bytes(&ctrlargs)) {
+		rc = PKCS11_CKR_ARGUMENTS_BAD;
+		goto out;
+	}
+
+	TEE_MemMove(out->memref.buffer, handles, handles_size);
+	out->memref.size = handles_size;
 
+out:
+	if (rc) {
+		/* Either all objects are created or none */
+		while (n--) {
+			obj = pkcs11_handle2object(handles[n], session);
+			if (obj)
+				destroy_object(session, obj, false);
+		}
+	}
+
+	TEE_Free(handles);
+
+	return rc;
+}
+
+/* Check the client can destroy @object in the context of @session */
+static enum pkcs11_rc check_destroy_object(struct pkcs11_session *session,
+					   struct pkcs11_object *object)
+{
 	/* Only session objects can be destroyed during a read-only session */
 	if (get_bool(object->attributes, PKCS11_CKA_TOKEN) &&
 	    !pkcs11_session_is_read_write(session)) {
@@ -449,14 +533,54 @@ enum pkcs11_rc entry_destroy_object(struct pkcs11_client *client,
 	/*
 	 * Only public objects can be destroyed unless normal user is logged in
 	 */
-	rc = check_access_attrs_against_token(session, object->attributes);
-	if (rc)
+	if (check_access_attrs_against_token(session, object->attributes))
 		return PKCS11_CKR_USER_NOT_LOGGED_IN;
 
 	/* Objects with PKCS11_CKA_DESTROYABLE as false aren't destroyable */
 	if (!get_bool(object->attributes, PKCS11_CKA_DESTROYABLE))
 		return PKCS11_CKR_ACTION_PROHIBITED;
 
+	return PKCS11_CKR_OK;
+}
+
+enum pkcs11_rc entry_destroy_object(struct pkcs11_client *client,
+				    uint32_t ptypes, TEE_Param *params)
+{
+	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
+	TEE_Param *ctrl = params;
+	struct serialargs ctrlargs = { };
+	uint32_t object_handle = 0;
+	struct pkcs11_session *session = NULL;
+	struct pkcs11_object *object = NULL;
+
+	if (!client || ptypes != exp_pt)
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	serialargs_init(&ctrlargs, ctrl->memref.buffer, ctrl->memref.size);
+
+	rc = serialargs_get_session_from_handle(&ctrlargs, client, &session);
+	if (rc)
+		return rc;
+
+	rc = serialargs_get_u32(&ctrlargs, &object_handle);
+	if (rc)
+		return rc;
+
+	if (serialargs_remaining_bytes(&ctrlargs))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	object = pkcs11_handle2object(object_handle, session);
+	if (!object)
+		return PKCS11_CKR_OBJECT_HANDLE_INVALID;
+
+	rc = check_destroy_object(session, object);
+	if (rc)
+		return rc;
+
 	destroy_object(session, object, false);
 
 	DMSG("PKCS11 session %"PRIu32": destroy object %#"PRIx32,
@@ -465,6 +589,76 @@ enum pkcs11_rc entry_destroy_object(struct pkcs11_client *client,
 	return rc;
 }
 
+enum pkcs11_rc entry_destroy_objects(struct pkcs11_client *client,
+				     uint32_t ptypes, TEE_Param *params)
+{
+	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE,
+						TEE_PARAM_TYPE_NONE);
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
+	TEE_Param *ctrl = params;
+	struct serialargs ctrlargs = { };
+	struct pkcs11_session *session = NULL;
+	struct pkcs11_object *object = NULL;
+	uint32_t object_handle = 0;
+	uint32_t count = 0;
+	uint32_t n = 0;
+	void *handles = NULL;
+
+	if (!client || ptypes != exp_pt)
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	serialargs_init(&ctrlargs, ctrl->memref.buffer, ctrl->memref.size);
+
+	rc = serialargs_get_session_from_handle(&ctrlargs, client, &session);
+	if (rc)
+		return rc;
+
+	rc = serialargs_get_u32(&ctrlargs, &count);
+	if (rc)
+		return rc;
+
+	rc = serialargs_get_array(&ctrlargs, &handles, count,
+				  sizeof(object_handle));
+	if (rc)
+		return rc;
+
+	if (!count || serialargs_remaining_bytes(&ctrlargs))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	/* Check all objects before destroying any of them */
+	for (n = 0; n < count; n++) {
+		TEE_MemMove(&object_handle,
+			    (uint32_t *)handles + n, sizeof(object_handle));
+
+		object = pkcs11_handle2object(object_handle, session);
+		if (!object)
+			return PKCS11_CKR_OBJECT_HANDLE_INVALID;
+
+		rc = check_destroy_object(session, object);
+		if (rc)
+			return rc;
+	}
+
+	for (n = 0; n < count; n++) {
+		TEE_MemMove(&object_handle,
+			    (uint32_t *)handles + n, sizeof(object_handle));
+
+		/* A handle listed twice refers to an already destroyed object */
+		object = pkcs11_handle2object(object_handle, session);
+		if (!object)
+			continue;
+
+		destroy_object(session, object, false);
+
+		DMSG("PKCS11 session %"PRIu32": destroy object %#"PRIx32,
+		     session->handle, object_handle);
+	}
+
+	return PKCS11_CKR_OK;
+}
+
 static void release_find_obj_context(struct pkcs11_find_objects *find_ctx)
 {
 	if (!find_ctx)
@@ -589,6 +783,7 @@ enum pkcs11_rc entry_find_objects_init(struct pkcs11_client *client,
 			if (obj->token)
 				continue;
 
+			use_object_attributes_index(obj);
 			if (!attributes_match_reference(obj->attributes,
 							req_attrs))
 				continue;
@@ -608,6 +803,10 @@ enum pkcs11_rc entry_find_objects_init(struct pkcs11_client *client,
 		bool new_load = false;
 
 		if (!obj->attributes) {
+			/* Skip loading objects the search index excludes */
+			if (!persistent_object_may_match(obj, req_attrs))
+				continue;
+
 			rc = load_persistent_object_attributes(obj);
 			if (rc) {
 				rc = PKCS11_CKR_GENERAL_ERROR;
@@ -615,6 +814,15 @@ enum pkcs11_rc entry_find_objects_init(struct pkcs11_client *client,
 			}
 
 			new_load = true;
+
+			if (!(obj->search.flags & OBJ_SEARCH_VALID)) {
+				/* Saved with the next token db update */
+				set_persistent_object_search_attrs(obj);
+				session->token->db_search_pending++;
+			}
+		} else {
+			/* Index resident attributes, not transient loads */
+			use_object_attributes_index(obj);
 		}
 
 		if (!obj->attributes ||
@@ -649,6 +857,7 @@ enum pkcs11_rc entry_find_objects_init(struct pkcs11_client *client,
 	rc = PKCS11_CKR_OK;
 
 out:
+	use_attributes_index(NULL);
 	TEE_Free(req_attrs);
 	TEE_Free(template);
 	release_find_obj_context(find_ctx);
@@ -828,6 +1037,8 @@ enum pkcs11_rc entry_get_attribute_value(struct pkcs11_client *client,
 	cur = (char *)template + sizeof(struct pkcs11_object_head);
 	end = cur + template->attrs_size;
 
+	use_object_attributes_index(obj);
+
 	for (; cur < end; cur += len) {
 		struct pkcs11_attribute_head *cli_ref = (void *)cur;
 		struct pkcs11_attribute_head cli_head = { };
@@ -918,6 +1129,7 @@ enum pkcs11_rc entry_get_attribute_value(struct pkcs11_client *client,
 	     session->handle, object_handle);
 
 out:
+	use_attributes_index(NULL);
 	TEE_Free(template);
 
 	return rc;
@@ -1087,6 +1299,7 @@ enum pkcs11_rc entry_set_attribute_value(struct pkcs11_client *client,
 		goto out;
 
 	/* Update the object */
+	release_object_attributes_index(obj);
 	head_old = obj->attributes;
 	obj->attributes = head_new;
 	head_new = NULL;
@@ -1094,13 +1307,14 @@ enum pkcs11_rc entry_set_attribute_value(struct pkcs11_client *client,
 	if (get_bool(obj->attributes, PKCS11_CKA_TOKEN)) {
 		rc = update_persistent_object_attributes(obj);
 		if (rc) {
-			TEE_Free(obj->attributes);
+			release_object_attributes_index(obj);
+			release_attributes(obj->attributes);
 			obj->attributes = head_old;
 			goto out;
 		}
 	}
 
-	TEE_Free(head_old);
+	release_attributes(head_old);
 
 	DMSG("PKCS11 session %"PRIu32": set attributes %#"PRIx32,
 	     session->handle, object_handle);
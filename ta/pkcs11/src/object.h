@@ -9,29 +9,60 @@
 #include <pkcs11_ta.h>
 #include <sys/queue.h>
 #include <tee_internal_api.h>
+#include <util.h>
 
 struct ck_token;
 struct obj_attrs;
+struct obj_attrs_index;
 struct pkcs11_client;
 struct pkcs11_session;
 
+/*
+ * Searchable attributes of a token object, persisted in the token search
+ * index so that object lookups can skip loading the attributes of objects
+ * that cannot match.
+ *
+ * @flags - OBJ_SEARCH_* bit flags
+ * @class - CKA_CLASS value if OBJ_SEARCH_CLASS is set
+ * @key_type - CKA_KEY_TYPE value if OBJ_SEARCH_KEY_TYPE is set
+ * @id_hash - Hash of CKA_ID value if OBJ_SEARCH_ID is set
+ * @label_hash - Hash of CKA_LABEL value if OBJ_SEARCH_LABEL is set
+ */
+struct obj_search_attrs {
+	uint32_t flags;
+	uint32_t class;
+	uint32_t key_type;
+	uint32_t id_hash;
+	uint32_t label_hash;
+};
+
+#define OBJ_SEARCH_VALID	BIT(0)
+#define OBJ_SEARCH_CLASS	BIT(1)
+#define OBJ_SEARCH_KEY_TYPE	BIT(2)
+#define OBJ_SEARCH_ID		BIT(3)
+#define OBJ_SEARCH_LABEL	BIT(4)
+
 /*
  * link: objects are referenced in a double-linked list
  * attributes: pointer to the serialized object attributes
+ * attrs_index: lookup index of @attributes built on first use, or NULL
  * key_handle: GPD TEE object handle if used in an operation
  * key_type: GPD TEE key type (shortcut used for processing)
  * token: associated token for the object
  * uuid: object UUID in the persistent database if a persistent object, or NULL
  * attribs_hdl: GPD TEE attributes handles if persistent object
+ * search: searchable attributes if a persistent object
  */
 struct pkcs11_object {
 	LIST_ENTRY(pkcs11_object) link;
 	struct obj_attrs *attributes;
+	struct obj_attrs_index *attrs_index;
 	TEE_ObjectHandle key_handle;
 	uint32_t key_type;
 	struct ck_token *token;
 	TEE_UUID *uuid;
 	TEE_ObjectHandle attribs_hdl;
+	struct obj_search_attrs search;
 };
 
 LIST_HEAD(object_list, pkcs11_object);
@@ -42,6 +73,19 @@ struct pkcs11_object *pkcs11_handle2object(uint32_t client_handle,
 uint32_t pkcs11_object2handle(struct pkcs11_object *obj,
 			      struct pkcs11_session *session);
 
+/*
+ * use_object_attributes_index() - Index lookups in object attributes
+ * @obj:	Object which attributes are loaded
+ *
+ * Build the lookup index of the object attributes if not already done and
+ * make attribute lookups use it until use_attributes_index(NULL) is called.
+ * Lookups fall back to scanning the attributes if the index cannot be built.
+ */
+void use_object_attributes_index(struct pkcs11_object *obj);
+
+/* Release the lookup index of the object attributes, if any */
+void release_object_attributes_index(struct pkcs11_object *obj);
+
 struct pkcs11_object *create_token_object(struct obj_attrs *head,
 					  TEE_UUID *uuid,
 					  struct ck_token *token);
@@ -61,9 +105,15 @@ void destroy_object(struct pkcs11_session *session,
 enum pkcs11_rc entry_create_object(struct pkcs11_client *client,
 				   uint32_t ptypes, TEE_Param *params);
 
+enum pkcs11_rc entry_create_objects(struct pkcs11_client *client,
+				    uint32_t ptypes, TEE_Param *params);
+
 enum pkcs11_rc entry_destroy_object(struct pkcs11_client *client,
 				    uint32_t ptypes, TEE_Param *params);
 
+enum pkcs11_rc entry_destroy_objects(struct pkcs11_client *client,
+				     uint32_t ptypes, TEE_Param *params);
+
 enum pkcs11_rc entry_find_objects_init(struct pkcs11_client *client,
 				       uint32_t ptypes, TEE_Param *params);
 
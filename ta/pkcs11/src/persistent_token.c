@@ -5,6 +5,7 @@
 
 #include <assert.h>
 #include <pkcs11_ta.h>
+#include <stdlib.h>
 #include <string.h>
 #include <string_ext.h>
 #include <tee_internal_api_extensions.h>
@@ -51,6 +52,28 @@ static TEE_Result open_db_file(struct ck_token *token,
 					out_hdl);
 }
 
+static TEE_Result get_search_file_name(struct ck_token *token,
+				       char *name, size_t size)
+{
+	int n = snprintf(name, size, "token.search.%u", get_token_id(token));
+
+	if (n < 0 || (size_t)n >= size)
+		return TEE_ERROR_SECURITY;
+	else
+		return TEE_SUCCESS;
+}
+
+static TEE_Result get_journal_file_name(struct ck_token *token,
+					char *name, size_t size)
+{
+	int n = snprintf(name, size, "token.journal.%u", get_token_id(token));
+
+	if (n < 0 || (size_t)n >= size)
+		return TEE_ERROR_SECURITY;
+	else
+		return TEE_SUCCESS;
+}
+
 void update_persistent_db(struct ck_token *token)
 {
 	TEE_Result res = TEE_ERROR_GENERIC;
@@ -283,28 +306,26 @@ enum pkcs11_rc verify_identity_auth(struct ck_token *token,
 }
 #endif /* CFG_PKCS11_TA_AUTH_TEE_IDENTITY */
 
-/*
- * Release resources relate to persistent database
- */
-void close_persistent_db(struct ck_token *token __unused)
-{
-}
-
-static int get_persistent_obj_idx(struct ck_token *token, TEE_UUID *uuid)
+static int find_obj_uuid_idx(struct token_persistent_objs *db_objs,
+			     TEE_UUID *uuid)
 {
 	size_t i = 0;
 
 	if (!uuid)
 		return -1;
 
-	for (i = 0; i < token->db_objs->count; i++)
-		if (!TEE_MemCompare(token->db_objs->uuids + i,
-				    uuid, sizeof(TEE_UUID)))
+	for (i = 0; i < db_objs->count; i++)
+		if (!TEE_MemCompare(db_objs->uuids + i, uuid, sizeof(TEE_UUID)))
 			return i;
 
 	return -1;
 }
 
+static int get_persistent_obj_idx(struct ck_token *token, TEE_UUID *uuid)
+{
+	return find_obj_uuid_idx(token->db_objs, uuid);
+}
+
 /* UUID for persistent object */
 enum pkcs11_rc create_object_uuid(struct ck_token *token,
 				  struct pkcs11_object *obj)
@@ -350,12 +371,547 @@ enum pkcs11_rc get_persistent_objects_list(struct ck_token *token,
 	return PKCS11_CKR_OK;
 }
 
+/* FNV-1a hash of searchable attribute values */
+static uint32_t search_hash(const void *data, size_t size)
+{
+	const uint8_t *p = data;
+	uint32_t hash = 0x811c9dc5;
+	size_t n = 0;
+
+	for (n = 0; n < size; n++)
+		hash = (hash ^ p[n]) * 0x01000193;
+
+	return hash;
+}
+
+static void get_search_attrs(struct obj_search_attrs *search,
+			     struct obj_attrs *head)
+{
+	uint32_t size = 0;
+	void *data = NULL;
+
+	TEE_MemFill(search, 0, sizeof(*search));
+	search->flags = OBJ_SEARCH_VALID;
+
+	if (!get_u32_attribute(head, PKCS11_CKA_CLASS, &search->class))
+		search->flags |= OBJ_SEARCH_CLASS;
+
+	if (!get_u32_attribute(head, PKCS11_CKA_KEY_TYPE, &search->key_type))
+		search->flags |= OBJ_SEARCH_KEY_TYPE;
+
+	if (!get_attribute_ptr(head, PKCS11_CKA_ID, &data, &size)) {
+		search->id_hash = search_hash(data, size);
+		search->flags |= OBJ_SEARCH_ID;
+	}
+
+	if (!get_attribute_ptr(head, PKCS11_CKA_LABEL, &data, &size)) {
+		search->label_hash = search_hash(data, size);
+		search->flags |= OBJ_SEARCH_LABEL;
+	}
+}
+
+void set_persistent_object_search_attrs(struct pkcs11_object *obj)
+{
+	assert(obj->attributes);
+
+	get_search_attrs(&obj->search, obj->attributes);
+}
+
+/*
+ * Return false if the reference holds a single instance of @attr_id which
+ * cannot match the searchable attribute found (@found) with value @value
+ * or hashed value @value (@hashed) in a candidate object.
+ */
+static bool search_attr_may_match(struct obj_attrs *ref, uint32_t attr_id,
+				  bool found, uint32_t value, bool hashed)
+{
+	uint32_t ref_value = 0;
+	uint32_t size = 0;
+	void *data = NULL;
+
+	if (get_attribute_ptr(ref, attr_id, &data, &size))
+		return true;
+
+	if (!found)
+		return false;
+
+	if (hashed)
+		return search_hash(data, size) == value;
+
+	if (size != sizeof(ref_value))
+		return false;
+
+	TEE_MemMove(&ref_value, data, sizeof(ref_value));
+
+	return ref_value == value;
+}
+
+bool persistent_object_may_match(struct pkcs11_object *obj,
+				 struct obj_attrs *ref)
+{
+	struct obj_search_attrs *search = &obj->search;
+
+	if (!(search->flags & OBJ_SEARCH_VALID))
+		return true;
+
+	return search_attr_may_match(ref, PKCS11_CKA_CLASS,
+				     search->flags & OBJ_SEARCH_CLASS,
+				     search->class, false) &&
+	       search_attr_may_match(ref, PKCS11_CKA_KEY_TYPE,
+				     search->flags & OBJ_SEARCH_KEY_TYPE,
+				     search->key_type, false) &&
+	       search_attr_may_match(ref, PKCS11_CKA_ID,
+				     search->flags & OBJ_SEARCH_ID,
+				     search->id_hash, true) &&
+	       search_attr_may_match(ref, PKCS11_CKA_LABEL,
+				     search->flags & OBJ_SEARCH_LABEL,
+				     search->label_hash, true);
+}
+
+/*
+ * Save the searchable attributes of the token objects that have them. The
+ * search index file is replaced atomically.
+ */
+static enum pkcs11_rc save_persistent_search_index(struct ck_token *token)
+{
+	char file[PERSISTENT_OBJECT_ID_LEN] = { };
+	struct token_persistent_search *db = NULL;
+	TEE_ObjectHandle hdl = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+	struct pkcs11_object *obj = NULL;
+	size_t count = 0;
+	size_t size = 0;
+
+	res = get_search_file_name(token, file, sizeof(file));
+	if (res)
+		return tee2pkcs_error(res);
+
+	LIST_FOREACH(obj, &token->object_list, link)
+		if (obj->uuid && obj->search.flags & OBJ_SEARCH_VALID)
+			count++;
+
+	size = sizeof(*db) + count * sizeof(db->entry[0]);
+	db = TEE_Malloc(size, TEE_MALLOC_FILL_ZERO);
+	if (!db)
+		return PKCS11_CKR_DEVICE_MEMORY;
+
+	db->version = PKCS11_TOKEN_SEARCH_VERSION;
+
+	LIST_FOREACH(obj, &token->object_list, link) {
+		if (!obj->uuid || !(obj->search.flags & OBJ_SEARCH_VALID))
+			continue;
+
+		db->entry[db->count].uuid = *obj->uuid;
+		db->entry[db->count].attrs = obj->search;
+		db->count++;
+	}
+
+	res = TEE_CreatePersistentObject(TEE_STORAGE_PRIVATE,
+					 file, sizeof(file),
+					 TEE_DATA_FLAG_ACCESS_WRITE |
+					 TEE_DATA_FLAG_OVERWRITE,
+					 TEE_HANDLE_NULL, db, size, &hdl);
+	TEE_Free(db);
+	if (res) {
+		EMSG("Failed to save token search index: %#"PRIx32, res);
+		return tee2pkcs_error(res);
+	}
+
+	TEE_CloseObject(hdl);
+
+	token->db_search_pending = 0;
+
+	return PKCS11_CKR_OK;
+}
+
+static int cmp_search_entry_uuid(const void *a, const void *b)
+{
+	return TEE_MemCompare(a, b, sizeof(TEE_UUID));
+}
+
+/* Binary search of @uuid in the entries sorted by cmp_search_entry_uuid() */
+static struct obj_search_attrs *
+find_search_attrs(struct token_persistent_search *db, TEE_UUID *uuid)
+{
+	size_t lo = 0;
+	size_t hi = db->count;
+	size_t n = 0;
+	int cmp = 0;
+
+	while (lo < hi) {
+		n = lo + (hi - lo) / 2;
+		cmp = cmp_search_entry_uuid(uuid, &db->entry[n].uuid);
+		if (!cmp)
+			return &db->entry[n].attrs;
+		if (cmp < 0)
+			hi = n;
+		else
+			lo = n + 1;
+	}
+
+	return NULL;
+}
+
+/*
+ * Restore the searchable attributes of the token objects from the search
+ * index file if found. Objects without an entry have no searchable
+ * attributes and are loaded when searched.
+ */
+static void load_persistent_search_index(struct ck_token *token)
+{
+	char file[PERSISTENT_OBJECT_ID_LEN] = { };
+	struct token_persistent_search *db = NULL;
+	TEE_ObjectHandle hdl = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+	struct pkcs11_object *obj = NULL;
+	TEE_ObjectInfo info = { };
+	size_t size = 0;
+
+	res = get_search_file_name(token, file, sizeof(file));
+	if (res)
+		return;
+
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, file, sizeof(file),
+				       TEE_DATA_FLAG_ACCESS_READ, &hdl);
+	if (res) {
+		if (res != TEE_ERROR_ITEM_NOT_FOUND)
+			EMSG("Failed to open token search index: %#"PRIx32,
+			     res);
+		return;
+	}
+
+	res = TEE_GetObjectInfo1(hdl, &info);
+	if (res || info.dataSize < sizeof(*db))
+		goto out;
+
+	db = TEE_Malloc(info.dataSize, TEE_USER_MEM_HINT_NO_FILL_ZERO);
+	if (!db)
+		goto out;
+
+	res = TEE_ReadObjectData(hdl, db, info.dataSize, &size);
+	if (res || size != info.dataSize ||
+	    db->version != PKCS11_TOKEN_SEARCH_VERSION ||
+	    db->count > (size - sizeof(*db)) / sizeof(db->entry[0])) {
+		DMSG("Ignore inconsistent token search index");
+		goto out;
+	}
+
+	/* Entries start with the object UUID */
+	qsort(db->entry, db->count, sizeof(db->entry[0]),
+	      cmp_search_entry_uuid);
+
+	LIST_FOREACH(obj, &token->object_list, link) {
+		struct obj_search_attrs *search = NULL;
+
+		if (!obj->uuid)
+			continue;
+
+		search = find_search_attrs(db, obj->uuid);
+		if (search && search->flags & OBJ_SEARCH_VALID)
+			obj->search = *search;
+	}
+
+out:
+	TEE_Free(db);
+	TEE_CloseObject(hdl);
+}
+
+/*
+ * Token persistent database journal
+ *
+ * Registering or unregistering a persistent object, or changing its
+ * searchable attributes, appends a record to the token journal file
+ * rather than rewriting the object database and the search index. The
+ * journal is replayed over the database and the search index when the
+ * token is loaded. Replaying a record already applied has no effect.
+ *
+ * Once the journal holds more records than the token has objects (and at
+ * least PKCS11_TOKEN_JOURNAL_MIN_RECORDS), the database and the search
+ * index are rewritten from their volatile copies and the journal is
+ * emptied, keeping the storage cost of object creation and destruction
+ * constant on average. As the search index is rebuilt from the token
+ * object list, maybe_compact_persistent_db() is only called once the
+ * object list reflects the journaled changes.
+ *
+ * Searchable attributes of objects missing from the search index, either
+ * computed when the objects are first loaded by a search or changed by an
+ * object update, are not journaled: they are only saved with the next
+ * compaction and count as journal records towards triggering it. Searches
+ * therefore do not write to the storage and an object update appends at
+ * most one journal record.
+ */
+#define PKCS11_TOKEN_JOURNAL_MIN_RECORDS	64
+
+static enum pkcs11_rc reset_journal(struct ck_token *token)
+{
+	char file[PERSISTENT_OBJECT_ID_LEN] = { };
+	TEE_ObjectHandle hdl = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+
+	res = get_journal_file_name(token, file, sizeof(file));
+	if (res)
+		return tee2pkcs_error(res);
+
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, file, sizeof(file),
+				       TEE_DATA_FLAG_ACCESS_WRITE, &hdl);
+	if (res == TEE_ERROR_ITEM_NOT_FOUND) {
+		res = TEE_SUCCESS;
+	} else if (!res) {
+		res = TEE_TruncateObjectData(hdl, 0);
+		TEE_CloseObject(hdl);
+	}
+
+	if (res) {
+		EMSG("Failed to reset token journal: %#"PRIx32, res);
+		return tee2pkcs_error(res);
+	}
+
+	token->db_journal_count = 0;
+
+	return PKCS11_CKR_OK;
+}
+
+static enum pkcs11_rc compact_persistent_db(struct ck_token *token)
+{
+	size_t objs_size = sizeof(*token->db_objs) +
+			   token->db_objs->count * sizeof(TEE_UUID);
+	TEE_ObjectHandle db_hdl = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
+
+	res = open_db_file(token, &db_hdl);
+	if (res)
+		return tee2pkcs_error(res);
+
+	res = TEE_WriteObjectData(db_hdl, token->db_main,
+				  sizeof(*token->db_main));
+	if (!res)
+		res = TEE_WriteObjectData(db_hdl, token->db_objs, objs_size);
+	if (!res)
+		res = TEE_TruncateObjectData(db_hdl, sizeof(*token->db_main) +
+					     objs_size);
+
+	TEE_CloseObject(db_hdl);
+
+	if (res) {
+		EMSG("Failed to write token persistent db: %#"PRIx32, res);
+		return tee2pkcs_error(res);
+	}
+
+	rc = save_persistent_search_index(token);
+	if (rc)
+		return rc;
+
+	return reset_journal(token);
+}
+
+static enum pkcs11_rc append_journal(struct ck_token *token,
+				     enum token_journal_op op, TEE_UUID *uuid,
+				     struct obj_search_attrs *search)
+{
+	struct token_persistent_journal rec = { .op = op };
+	char file[PERSISTENT_OBJECT_ID_LEN] = { };
+	TEE_ObjectHandle hdl = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+	TEE_ObjectInfo info = { };
+
+	TEE_MemMove(&rec.uuid, uuid, sizeof(rec.uuid));
+	if (search)
+		rec.search = *search;
+
+	res = get_journal_file_name(token, file, sizeof(file));
+	if (res)
+		return tee2pkcs_error(res);
+
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, file, sizeof(file),
+				       TEE_DATA_FLAG_ACCESS_WRITE, &hdl);
+	if (res == TEE_ERROR_ITEM_NOT_FOUND) {
+		res = TEE_CreatePersistentObject(TEE_STORAGE_PRIVATE,
+						 file, sizeof(file),
+						 TEE_DATA_FLAG_ACCESS_WRITE,
+						 TEE_HANDLE_NULL,
+						 &rec, sizeof(rec), &hdl);
+	} else if (!res) {
+		/* Drop a partial trailing record to keep records aligned */
+		res = TEE_GetObjectInfo1(hdl, &info);
+		if (!res && info.dataSize % sizeof(rec))
+			res = TEE_TruncateObjectData(hdl,
+						     ROUNDDOWN(info.dataSize,
+							       sizeof(rec)));
+		if (!res)
+			res = TEE_SeekObjectData(hdl, 0, TEE_DATA_SEEK_END);
+		if (!res)
+			res = TEE_WriteObjectData(hdl, &rec, sizeof(rec));
+	}
+
+	if (hdl != TEE_HANDLE_NULL)
+		TEE_CloseObject(hdl);
+
+	if (res) {
+		EMSG("Failed to update token journal: %#"PRIx32, res);
+		return tee2pkcs_error(res);
+	}
+
+	token->db_journal_count++;
+
+	return PKCS11_CKR_OK;
+}
+
+void maybe_compact_persistent_db(struct ck_token *token)
+{
+	if (token->db_journal_count + token->db_search_pending >
+	    MAX(PKCS11_TOKEN_JOURNAL_MIN_RECORDS, token->db_objs->count) &&
+	    compact_persistent_db(token))
+		DMSG("Token db compaction failed, journal is kept");
+}
+
+/*
+ * Release resources relate to persistent database
+ */
+void close_persistent_db(struct ck_token *token)
+{
+	/* Save searchable attributes not yet in the search index */
+	if (token->db_objs && token->db_search_pending &&
+	    compact_persistent_db(token))
+		DMSG("Token db compaction failed, search index not updated");
+}
+
+/*
+ * Load the records of the token journal. *@journal is NULL if there is no
+ * journal to replay.
+ */
+static enum pkcs11_rc load_journal(struct ck_token *token,
+				   struct token_persistent_journal **journal,
+				   size_t *count)
+{
+	char file[PERSISTENT_OBJECT_ID_LEN] = { };
+	TEE_ObjectHandle hdl = TEE_HANDLE_NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
+	TEE_ObjectInfo info = { };
+	size_t read_size = 0;
+	size_t size = 0;
+
+	*journal = NULL;
+	*count = 0;
+
+	res = get_journal_file_name(token, file, sizeof(file));
+	if (res)
+		return tee2pkcs_error(res);
+
+	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, file, sizeof(file),
+				       TEE_DATA_FLAG_ACCESS_READ, &hdl);
+	if (res == TEE_ERROR_ITEM_NOT_FOUND)
+		return PKCS11_CKR_OK;
+	if (res)
+		return tee2pkcs_error(res);
+
+	res = TEE_GetObjectInfo1(hdl, &info);
+	if (res) {
+		rc = tee2pkcs_error(res);
+		goto out;
+	}
+
+	/* A partial trailing record was never committed, ignore it */
+	size = ROUNDDOWN(info.dataSize, sizeof(**journal));
+	if (!size)
+		goto out;
+
+	*journal = TEE_Malloc(size, TEE_USER_MEM_HINT_NO_FILL_ZERO);
+	if (!*journal) {
+		rc = PKCS11_CKR_DEVICE_MEMORY;
+		goto out;
+	}
+
+	read_size = size;
+	res = TEE_ReadObjectData(hdl, *journal, size, &read_size);
+	if (res || read_size != size)
+		TEE_Panic(0);
+
+	*count = size / sizeof(**journal);
+
+out:
+	TEE_CloseObject(hdl);
+
+	return rc;
+}
+
+/* Replay journal object registration and unregistration over @db_objs */
+static enum pkcs11_rc
+replay_journal_objects(struct token_persistent_objs **db_objs,
+		       struct token_persistent_journal *journal, size_t count)
+{
+	struct token_persistent_objs *objs = *db_objs;
+	size_t n = 0;
+	int idx = 0;
+
+	for (n = 0; n < count; n++) {
+		idx = find_obj_uuid_idx(objs, &journal[n].uuid);
+
+		switch (journal[n].op) {
+		case TOKEN_JOURNAL_ADD:
+			if (idx >= 0)
+				break;
+
+			objs = TEE_Realloc(objs, sizeof(*objs) +
+					   (objs->count + 1) *
+					   sizeof(TEE_UUID));
+			if (!objs)
+				return PKCS11_CKR_DEVICE_MEMORY;
+
+			*db_objs = objs;
+			objs->uuids[objs->count] = journal[n].uuid;
+			objs->count++;
+			break;
+		case TOKEN_JOURNAL_DEL:
+			if (idx < 0)
+				break;
+
+			objs->count--;
+			TEE_MemMove(objs->uuids + idx, objs->uuids + idx + 1,
+				    (objs->count - idx) * sizeof(TEE_UUID));
+			break;
+		case TOKEN_JOURNAL_SEARCH:
+			break;
+		default:
+			DMSG("Ignore unknown journal record %#"PRIx32,
+			     journal[n].op);
+			break;
+		}
+	}
+
+	return PKCS11_CKR_OK;
+}
+
+/* Replay journal searchable attributes over the token objects */
+static void replay_journal_search(struct ck_token *token,
+				  struct token_persistent_journal *journal,
+				  size_t count)
+{
+	struct pkcs11_object *obj = NULL;
+	size_t n = 0;
+
+	for (n = 0; n < count; n++) {
+		if (journal[n].op != TOKEN_JOURNAL_ADD &&
+		    journal[n].op != TOKEN_JOURNAL_SEARCH)
+			continue;
+
+		LIST_FOREACH(obj, &token->object_list, link) {
+			if (!TEE_MemCompare(obj->uuid, &journal[n].uuid,
+					    sizeof(TEE_UUID))) {
+				obj->search = journal[n].search;
+				break;
+			}
+		}
+	}
+}
+
 enum pkcs11_rc unregister_persistent_object(struct ck_token *token,
 					    TEE_UUID *uuid)
 {
-	TEE_ObjectHandle db_hdl = TEE_HANDLE_NULL;
+	struct token_persistent_objs *old = token->db_objs;
 	struct token_persistent_objs *ptr = NULL;
-	TEE_Result res = TEE_ERROR_GENERIC;
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
 	int count = 0;
 	int idx = 0;
 
@@ -369,59 +925,43 @@ enum pkcs11_rc unregister_persistent_object(struct ck_token *token,
 	}
 
 	ptr = TEE_Malloc(sizeof(struct token_persistent_objs) +
-			 ((token->db_objs->count - 1) * sizeof(TEE_UUID)),
+			 ((old->count - 1) * sizeof(TEE_UUID)),
 			 TEE_USER_MEM_HINT_NO_FILL_ZERO);
 	if (!ptr)
 		return PKCS11_CKR_DEVICE_MEMORY;
 
-	res = open_db_file(token, &db_hdl);
-	if (res)
-		goto out;
-
-	res = TEE_SeekObjectData(db_hdl, sizeof(struct token_persistent_main),
-				 TEE_DATA_SEEK_SET);
-	if (res) {
-		DMSG("Failed to read database");
-		goto out;
-	}
-
-	TEE_MemMove(ptr, token->db_objs,
+	TEE_MemMove(ptr, old,
 		    sizeof(struct token_persistent_objs) +
 		    idx * sizeof(TEE_UUID));
 
 	ptr->count--;
 	count = ptr->count - idx;
 
-	TEE_MemMove(&ptr->uuids[idx],
-		    &token->db_objs->uuids[idx + 1],
+	TEE_MemMove(&ptr->uuids[idx], &old->uuids[idx + 1],
 		    count * sizeof(TEE_UUID));
 
-	res = TEE_WriteObjectData(db_hdl, ptr,
-				  sizeof(struct token_persistent_objs) +
-				  ptr->count * sizeof(TEE_UUID));
-	if (res)
-		DMSG("Failed to update database");
-	TEE_Free(token->db_objs);
 	token->db_objs = ptr;
-	ptr = NULL;
 
-out:
-	TEE_CloseObject(db_hdl);
-	TEE_Free(ptr);
+	rc = append_journal(token, TOKEN_JOURNAL_DEL, uuid, NULL);
+	if (rc) {
+		token->db_objs = old;
+		TEE_Free(ptr);
+		return rc;
+	}
 
-	return tee2pkcs_error(res);
+	TEE_Free(old);
+
+	return PKCS11_CKR_OK;
 }
 
 enum pkcs11_rc register_persistent_object(struct ck_token *token,
-					  TEE_UUID *uuid)
+					  struct pkcs11_object *obj)
 {
-	TEE_ObjectHandle db_hdl = TEE_HANDLE_NULL;
-	TEE_Result res = TEE_ERROR_GENERIC;
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
 	void *ptr = NULL;
-	size_t size = 0;
 	int count = 0;
 
-	if (get_persistent_obj_idx(token, uuid) >= 0)
+	if (get_persistent_obj_idx(token, obj->uuid) >= 0)
 		TEE_Panic(0);
 
 	count = token->db_objs->count;
@@ -432,37 +972,17 @@ enum pkcs11_rc register_persistent_object(struct ck_token *token,
 		return PKCS11_CKR_DEVICE_MEMORY;
 
 	token->db_objs = ptr;
-	TEE_MemMove(token->db_objs->uuids + count, uuid, sizeof(TEE_UUID));
-
-	size = sizeof(struct token_persistent_main) +
-	       sizeof(struct token_persistent_objs) +
-	       count * sizeof(TEE_UUID);
-
-	res = open_db_file(token, &db_hdl);
-	if (res)
-		goto out;
-
-	res = TEE_TruncateObjectData(db_hdl, size + sizeof(TEE_UUID));
-	if (res)
-		goto out;
-
-	res = TEE_SeekObjectData(db_hdl, sizeof(struct token_persistent_main),
-				 TEE_DATA_SEEK_SET);
-	if (res)
-		goto out;
-
+	TEE_MemMove(token->db_objs->uuids + count, obj->uuid,
+		    sizeof(TEE_UUID));
 	token->db_objs->count++;
 
-	res = TEE_WriteObjectData(db_hdl, token->db_objs,
-				  sizeof(struct token_persistent_objs) +
-				  token->db_objs->count * sizeof(TEE_UUID));
-	if (res)
-		token->db_objs->count--;
+	set_persistent_object_search_attrs(obj);
 
-out:
-	TEE_CloseObject(db_hdl);
+	rc = append_journal(token, TOKEN_JOURNAL_ADD, obj->uuid, &obj->search);
+	if (rc)
+		token->db_objs->count--;
 
-	return tee2pkcs_error(res);
+	return rc;
 }
 
 enum pkcs11_rc load_persistent_object_attributes(struct pkcs11_object *obj)
@@ -521,6 +1041,7 @@ enum pkcs11_rc load_persistent_object_attributes(struct pkcs11_object *obj)
 		goto out;
 	}
 
+	release_object_attributes_index(obj);
 	obj->attributes = attr;
 	attr = NULL;
 
@@ -537,7 +1058,8 @@ out:
 
 void release_persistent_object_attributes(struct pkcs11_object *obj)
 {
-	TEE_Free(obj->attributes);
+	release_object_attributes_index(obj);
+	release_attributes(obj->attributes);
 	obj->attributes = NULL;
 }
 
@@ -546,10 +1068,33 @@ enum pkcs11_rc update_persistent_object_attributes(struct pkcs11_object *obj)
 	TEE_Result res = TEE_ERROR_GENERIC;
 	TEE_ObjectHandle hdl = TEE_HANDLE_NULL;
 	uint32_t tee_obj_flags = TEE_DATA_FLAG_ACCESS_WRITE;
+	struct obj_search_attrs search = { };
+	bool search_changed = false;
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
 	size_t size = 0;
 
 	assert(obj && obj->attributes);
 
+	/*
+	 * If searchable attributes change, drop the object from the search
+	 * index before updating its attributes: a stale index entry would
+	 * hide the object from searches. The new searchable attributes are
+	 * only saved with the next compaction.
+	 */
+	get_search_attrs(&search, obj->attributes);
+	if (TEE_MemCompare(&search, &obj->search, sizeof(search))) {
+		search_changed = true;
+
+		if (obj->search.flags & OBJ_SEARCH_VALID) {
+			obj->search.flags = 0;
+
+			rc = append_journal(obj->token, TOKEN_JOURNAL_SEARCH,
+					    obj->uuid, &obj->search);
+			if (rc)
+				return rc;
+		}
+	}
+
 	res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE,
 				       obj->uuid, sizeof(*obj->uuid),
 				       tee_obj_flags, &hdl);
@@ -565,9 +1110,17 @@ enum pkcs11_rc update_persistent_object_attributes(struct pkcs11_object *obj)
 		goto out;
 
 	res = TEE_TruncateObjectData(hdl, size);
+	if (res)
+		goto out;
+
+	if (search_changed) {
+		obj->search = search;
+		obj->token->db_search_pending++;
+	}
 
 out:
 	TEE_CloseObject(hdl);
+	maybe_compact_persistent_db(obj->token);
 	return tee2pkcs_error(res);
 }
 
@@ -583,6 +1136,8 @@ struct ck_token *init_persistent_db(unsigned int token_id)
 	/* Copy persistent database: main db and object db */
 	struct token_persistent_main *db_main = NULL;
 	struct token_persistent_objs *db_objs = NULL;
+	struct token_persistent_journal *journal = NULL;
+	size_t journal_count = 0;
 	void *ptr = NULL;
 	void *initial_data = NULL;
 	uint32_t initial_data_size = 0;
@@ -629,6 +1184,10 @@ struct ck_token *init_persistent_db(unsigned int token_id)
 				TEE_Panic(0);
 		}
 
+		if (load_journal(token, &journal, &journal_count) ||
+		    replay_journal_objects(&db_objs, journal, journal_count))
+			goto error;
+
 		for (idx = 0; idx < db_objs->count; idx++) {
 			/* Create an empty object instance */
 			struct pkcs11_object *obj = NULL;
@@ -648,6 +1207,12 @@ struct ck_token *init_persistent_db(unsigned int token_id)
 			LIST_INSERT_HEAD(&token->object_list, obj, link);
 		}
 
+		load_persistent_search_index(token);
+		replay_journal_search(token, journal, journal_count);
+		token->db_journal_count = journal_count;
+		TEE_Free(journal);
+		journal = NULL;
+
 	} else if (res == TEE_ERROR_ITEM_NOT_FOUND) {
 		char file[PERSISTENT_OBJECT_ID_LEN] = { };
 
@@ -696,6 +1261,10 @@ struct ck_token *init_persistent_db(unsigned int token_id)
 			goto error;
 		}
 
+		/* Drop any journal left over from a former database */
+		if (reset_journal(token))
+			goto error;
+
 	} else {
 		goto error;
 	}
@@ -707,6 +1276,7 @@ struct ck_token *init_persistent_db(unsigned int token_id)
 	return token;
 
 error:
+	TEE_Free(journal);
 	TEE_Free(db_main);
 	TEE_Free(db_objs);
 	if (db_hdl != TEE_HANDLE_NULL)
@@ -1182,6 +1182,7 @@ create_attributes_from_template(struct obj_attrs **out, void *template,
 				enum pkcs11_mechanism_id mecha,
 				enum pkcs11_class_id template_class)
 {
+	struct obj_attrs_index *temp_index = NULL;
 	struct obj_attrs *temp = NULL;
 	struct obj_attrs *attrs = NULL;
 	enum pkcs11_rc rc = PKCS11_CKR_OK;
@@ -1356,6 +1357,20 @@ create_attributes_from_template(struct obj_attrs **out, void *template,
 	 * failure and an error code be returned.
 	 */
 
+	if (get_class(temp) == PKCS11_CKO_SECRET_KEY) {
+		rc = sanitize_symm_key_attributes(&temp, function);
+		if (rc)
+			goto out;
+	}
+
+	/*
+	 * temp is not modified from here while its attributes are looked up
+	 * many times to build the object attributes: index it.
+	 */
+	if (init_attributes_index(temp, &temp_index))
+		DMSG("Lookups in template attributes not indexed");
+	use_attributes_index(temp_index);
+
 	switch (get_class(temp)) {
 	case PKCS11_CKO_DATA:
 		rc = create_data_attributes(&attrs, temp);
@@ -1364,9 +1379,6 @@ create_attributes_from_template(struct obj_attrs **out, void *template,
 		rc = create_certificate_attributes(&attrs, temp);
 		break;
 	case PKCS11_CKO_SECRET_KEY:
-		rc = sanitize_symm_key_attributes(&temp, function);
-		if (rc)
-			goto out;
 		rc = create_symm_key_attributes(&attrs, temp);
 		break;
 	case PKCS11_CKO_PUBLIC_KEY:
@@ -1501,7 +1513,8 @@ create_attributes_from_template(struct obj_attrs **out, void *template,
 #endif
 
 out:
-	TEE_Free(temp);
+	release_attributes_index(temp_index);
+	release_attributes(temp);
 	if (rc)
 		TEE_Free(attrs);
 
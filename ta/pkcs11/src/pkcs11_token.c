@@ -964,6 +964,8 @@ inited:
 		cleanup_persistent_object(obj, token);
 	}
 
+	maybe_compact_persistent_db(token);
+
 	IMSG("PKCS11 token %"PRIu32": initialized", token_id);
 
 	return PKCS11_CKR_OK;
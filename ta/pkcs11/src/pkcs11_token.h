@@ -86,6 +86,46 @@ struct token_persistent_objs {
 	TEE_UUID uuids[];
 };
 
+/*
+ * Persistent search index of the token objects, stored aside the token
+ * persistent database
+ *
+ * @version - PKCS11_TOKEN_SEARCH_VERSION
+ * @count - number of entries
+ * @entry - searchable attributes of the objects (@count items), an
+ *	    object without an entry is always loaded when searched
+ */
+#define PKCS11_TOKEN_SEARCH_VERSION	1
+
+struct token_persistent_search {
+	uint32_t version;
+	uint32_t count;
+	struct {
+		TEE_UUID uuid;
+		struct obj_search_attrs attrs;
+	} entry[];
+};
+
+/*
+ * Record of the token persistent database journal
+ *
+ * @op - TOKEN_JOURNAL_* operation
+ * @uuid - UUID of the persistent object
+ * @search - searchable attributes of the object for TOKEN_JOURNAL_ADD and
+ *	     TOKEN_JOURNAL_SEARCH
+ */
+enum token_journal_op {
+	TOKEN_JOURNAL_ADD = 1,
+	TOKEN_JOURNAL_DEL = 2,
+	TOKEN_JOURNAL_SEARCH = 3,
+};
+
+struct token_persistent_journal {
+	uint32_t op;
+	TEE_UUID uuid;
+	struct obj_search_attrs search;
+};
+
 /*
  * Runtime state of the token, complies with pkcs11
  *
@@ -95,6 +135,9 @@ struct token_persistent_objs {
  * @object_list - List of the objects owned by the token
  * @db_main - Volatile copy of the persistent main database
  * @db_objs - Volatile copy of the persistent object database
+ * @db_journal_count - Number of records in the persistent database journal
+ * @db_search_pending - Number of objects whose searchable attributes are not
+ *	saved in the persistent search index nor in the journal
  */
 struct ck_token {
 	enum pkcs11_token_state state;
@@ -104,6 +147,8 @@ struct ck_token {
 	/* Copy in RAM of the persistent database */
 	struct token_persistent_main *db_main;
 	struct token_persistent_objs *db_objs;
+	uint32_t db_journal_count;
+	uint32_t db_search_pending;
 };
 
 /*
@@ -207,6 +252,7 @@ struct handle_db *get_object_handle_db(struct pkcs11_session *session);
 /* Access to persistent database */
 struct ck_token *init_persistent_db(unsigned int token_id);
 void update_persistent_db(struct ck_token *token);
+void maybe_compact_persistent_db(struct ck_token *token);
 void close_persistent_db(struct ck_token *token);
 
 /* Load and release persistent object attributes in memory */
@@ -214,6 +260,11 @@ enum pkcs11_rc load_persistent_object_attributes(struct pkcs11_object *obj);
 void release_persistent_object_attributes(struct pkcs11_object *obj);
 enum pkcs11_rc update_persistent_object_attributes(struct pkcs11_object *obj);
 
+/* Searchable attributes of persistent objects */
+void set_persistent_object_search_attrs(struct pkcs11_object *obj);
+bool persistent_object_may_match(struct pkcs11_object *obj,
+				 struct obj_attrs *ref);
+
 enum pkcs11_rc hash_pin(enum pkcs11_user_type user, const uint8_t *pin,
 			size_t pin_size, uint32_t *salt,
 			uint8_t hash[TEE_MAX_HASH_SIZE]);
@@ -260,7 +311,7 @@ void destroy_object_uuid(struct ck_token *token, struct pkcs11_object *obj);
 enum pkcs11_rc unregister_persistent_object(struct ck_token *token,
 					    TEE_UUID *uuid);
 enum pkcs11_rc register_persistent_object(struct ck_token *token,
-					  TEE_UUID *uuid);
+					  struct pkcs11_object *obj);
 enum pkcs11_rc get_persistent_objects_list(struct ck_token *token,
 					   TEE_UUID *array, size_t *size);
 
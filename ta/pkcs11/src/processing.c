@@ -806,6 +806,264 @@ out:
 	return rc;
 }
 
+/* Get the next message, and signature when verifying, of a batch */
+static enum pkcs11_rc get_multi_message(struct serialargs *args,
+					enum processing_func function,
+					void **data, uint32_t *data_size,
+					void **sig, uint32_t *sig_size)
+{
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
+
+	rc = serialargs_get_u32(args, data_size);
+	if (rc)
+		return rc;
+
+	rc = serialargs_get_ptr(args, data, *data_size);
+	if (rc)
+		return rc;
+
+	if (function != PKCS11_FUNCTION_VERIFY)
+		return PKCS11_CKR_OK;
+
+	rc = serialargs_get_u32(args, sig_size);
+	if (rc)
+		return rc;
+
+	return serialargs_get_ptr(args, sig, *sig_size);
+}
+
+/* Restart the active sign or verify operation for the next message */
+static void restart_active_processing(struct pkcs11_session *session)
+{
+	struct active_processing *proc = session->processing;
+
+	if (proc->tee_op_handle2 != TEE_HANDLE_NULL)
+		TEE_ResetOperation(proc->tee_op_handle2);
+
+	/* Symmetric sign and verify mechanisms are all MACs */
+	if (processing_is_tee_symm(proc->mecha_type)) {
+		TEE_ResetOperation(proc->tee_op_handle);
+		TEE_MACInit(proc->tee_op_handle, NULL, 0);
+	}
+}
+
+/*
+ * entry_processing_multi - Sign or verify several messages with one key
+ *
+ * @client = client reference
+ * @ptype = Invocation parameter types
+ * @params = Invocation parameters reference
+ * @function - sign or verify
+ *
+ * The messages are all checked before any is processed. The operation is
+ * initialized once as by C_SignInit() or C_VerifyInit(), with the same
+ * checks, then restarted for each message processed as by C_Sign() or
+ * C_Verify().
+ */
+enum pkcs11_rc entry_processing_multi(struct pkcs11_client *client,
+				      uint32_t ptypes, TEE_Param *params,
+				      enum processing_func function)
+{
+	const uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+						TEE_PARAM_TYPE_MEMREF_INPUT,
+						TEE_PARAM_TYPE_MEMREF_OUTPUT,
+						TEE_PARAM_TYPE_NONE);
+	const uint32_t init_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+						 TEE_PARAM_TYPE_NONE,
+						 TEE_PARAM_TYPE_NONE,
+						 TEE_PARAM_TYPE_NONE);
+	uint32_t step_pt = 0;
+	TEE_Param *ctrl = params;
+	TEE_Param *in = params + 1;
+	TEE_Param *out = params + 2;
+	TEE_Param init_params[TEE_NUM_PARAMS] = { };
+	TEE_Param step_params[TEE_NUM_PARAMS] = { };
+	enum pkcs11_rc rc = PKCS11_CKR_OK;
+	struct serialargs ctrlargs = { };
+	struct serialargs inargs = { };
+	struct pkcs11_session *session = NULL;
+	struct pkcs11_attribute_head mecha = { };
+	enum pkcs11_mechanism_id mecha_type = PKCS11_CKM_UNDEFINED_ID;
+	uint8_t *out_buf = out->memref.buffer;
+	size_t out_size = out->memref.size;
+	size_t out_offset = 0;
+	size_t init_size = 0;
+	bool short_buffer = false;
+	uint32_t key_handle = 0;
+	uint32_t count = 0;
+	uint32_t data_size = 0;
+	uint32_t sig_size = 0;
+	uint32_t msg_rc = 0;
+	void *mecha_params = NULL;
+	void *data = NULL;
+	void *sig = NULL;
+	uint32_t n = 0;
+
+	if (!client || ptypes != exp_pt ||
+	    (function != PKCS11_FUNCTION_SIGN &&
+	     function != PKCS11_FUNCTION_VERIFY))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	serialargs_init(&ctrlargs, ctrl->memref.buffer, ctrl->memref.size);
+
+	rc = serialargs_get_session_from_handle(&ctrlargs, client, &session);
+	if (rc)
+		return rc;
+
+	rc = serialargs_get_u32(&ctrlargs, &key_handle);
+	if (rc)
+		return rc;
+
+	rc = serialargs_get(&ctrlargs, &mecha, sizeof(mecha));
+	if (rc)
+		return rc;
+
+	rc = serialargs_get_ptr(&ctrlargs, &mecha_params, mecha.size);
+	if (rc)
+		return rc;
+
+	/* Init arguments are the control arguments up to the message count */
+	init_size = ctrlargs.next - ctrlargs.start;
+
+	rc = serialargs_get_u32(&ctrlargs, &count);
+	if (rc)
+		return rc;
+
+	if (!count || serialargs_remaining_bytes(&ctrlargs))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	if (function == PKCS11_FUNCTION_VERIFY &&
+	    (MUL_OVERFLOW(count, sizeof(uint32_t), &out_offset) ||
+	     out_size != out_offset))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	out_offset = 0;
+
+	/* Check all messages before processing any of them */
+	serialargs_init(&inargs, in->memref.buffer, in->memref.size);
+
+	for (n = 0; n < count; n++) {
+		rc = get_multi_message(&inargs, function, &data, &data_size,
+				       &sig, &sig_size);
+		if (rc)
+			return rc;
+	}
+
+	if (serialargs_remaining_bytes(&inargs))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	init_params[0].memref.buffer = ctrl->memref.buffer;
+	init_params[0].memref.size = init_size;
+
+	rc = entry_processing_init(client, init_pt, init_params, function);
+	if (rc)
+		return rc;
+
+	mecha_type = session->processing->mecha_type;
+	rc = check_mechanism_against_processing(session, mecha_type, function,
+						PKCS11_FUNC_STEP_ONESHOT);
+	if (rc)
+		goto out;
+
+	if (function == PKCS11_FUNCTION_SIGN)
+		step_pt = exp_pt;
+	else
+		step_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INOUT,
+					  TEE_PARAM_TYPE_MEMREF_INPUT,
+					  TEE_PARAM_TYPE_MEMREF_INPUT,
+					  TEE_PARAM_TYPE_NONE);
+
+	serialargs_init(&inargs, in->memref.buffer, in->memref.size);
+
+	for (n = 0; n < count; n++) {
+		rc = get_multi_message(&inargs, function, &data, &data_size,
+				       &sig, &sig_size);
+		if (rc)
+			goto out;
+
+		if (n)
+			restart_active_processing(session);
+
+		step_params[1].memref.buffer = data;
+		step_params[1].memref.size = data_size;
+
+		if (function == PKCS11_FUNCTION_VERIFY) {
+			step_params[2].memref.buffer = sig;
+			step_params[2].memref.size = sig_size;
+		} else if (!short_buffer &&
+			   out_offset + sizeof(uint32_t) <= out_size) {
+			/* Signature is stored after its 32bit byte size */
+			step_params[2].memref.buffer = out_buf + out_offset +
+						       sizeof(uint32_t);
+			step_params[2].memref.size = out_size - out_offset -
+						     sizeof(uint32_t);
+		} else {
+			short_buffer = true;
+			step_params[2].memref.buffer = NULL;
+			step_params[2].memref.size = 0;
+		}
+
+		if (processing_is_tee_symm(mecha_type))
+			rc = step_symm_operation(session, function,
+						 PKCS11_FUNC_STEP_ONESHOT,
+						 step_pt, step_params);
+		else
+			rc = step_asymm_operation(session, function,
+						  PKCS11_FUNC_STEP_ONESHOT,
+						  step_pt, step_params);
+
+		if (function == PKCS11_FUNCTION_VERIFY) {
+			if (rc != PKCS11_CKR_OK &&
+			    rc != PKCS11_CKR_SIGNATURE_INVALID &&
+			    rc != PKCS11_CKR_SIGNATURE_LEN_RANGE)
+				goto out;
+
+			/* Per message verification status */
+			msg_rc = rc;
+			TEE_MemMove(out_buf + n * sizeof(msg_rc), &msg_rc,
+				    sizeof(msg_rc));
+			continue;
+		}
+
+		if (rc == PKCS11_CKR_BUFFER_TOO_SMALL) {
+			/* Keep on computing the overall output size */
+			short_buffer = true;
+		} else if (rc) {
+			goto out;
+		} else if (!short_buffer) {
+			sig_size = step_params[2].memref.size;
+			TEE_MemMove(out_buf + out_offset, &sig_size,
+				    sizeof(sig_size));
+		}
+
+		if (ADD_OVERFLOW(out_offset, sizeof(uint32_t), &out_offset) ||
+		    ADD_OVERFLOW(out_offset, step_params[2].memref.size,
+				 &out_offset)) {
+			rc = PKCS11_CKR_ARGUMENTS_BAD;
+			goto out;
+		}
+	}
+
+	if (function == PKCS11_FUNCTION_SIGN) {
+		out->memref.size = out_offset;
+
+		if (short_buffer) {
+			rc = PKCS11_CKR_BUFFER_TOO_SMALL;
+			goto out;
+		}
+	}
+
+	rc = PKCS11_CKR_OK;
+
+	DMSG("PKCS11 session %"PRIu32": %s %"PRIu32" messages",
+	     session->handle, id2str_function(function), count);
+
+out:
+	release_active_processing(session);
+
+	return rc;
+}
+
 enum pkcs11_rc entry_processing_key(struct pkcs11_client *client,
 				    uint32_t ptypes, TEE_Param *params,
 				    enum processing_func function)
@@ -96,6 +96,10 @@ enum pkcs11_rc entry_processing_step(struct pkcs11_client *client,
 				     enum processing_func function,
 				     enum processing_step step);
 
+enum pkcs11_rc entry_processing_multi(struct pkcs11_client *client,
+				      uint32_t ptypes, TEE_Param *params,
+				      enum processing_func function);
+
 enum pkcs11_rc entry_processing_key(struct pkcs11_client *client,
 				    uint32_t ptypes, TEE_Param *params,
 				    enum processing_func function);
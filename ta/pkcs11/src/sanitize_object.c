@@ -68,8 +68,8 @@ static enum pkcs11_rc read_attr_advance(void *buf, size_t blen, size_t *pos,
 }
 
 /* Sanitize class/type in a client attribute list */
-static enum pkcs11_rc sanitize_class_and_type(struct obj_attrs **dst, void *src,
-					      size_t src_size,
+static enum pkcs11_rc sanitize_class_and_type(struct obj_attrs_builder *dst,
+					      void *src, size_t src_size,
 					      uint32_t class_hint,
 					      uint32_t type_hint)
 {
@@ -129,28 +129,30 @@ static enum pkcs11_rc sanitize_class_and_type(struct obj_attrs **dst, void *src,
 	}
 
 	if (class_found != PKCS11_CKO_UNDEFINED_ID) {
-		rc = add_attribute(dst, PKCS11_CKA_CLASS,
-				   &class_found, sizeof(class_found));
+		rc = builder_add_attribute(dst, PKCS11_CKA_CLASS,
+					   &class_found, sizeof(class_found));
 		if (rc)
 			return rc;
 	} else {
 		if (class_hint != PKCS11_CKO_UNDEFINED_ID) {
-			rc = add_attribute(dst, PKCS11_CKA_CLASS,
-					   &class_hint, sizeof(class_hint));
+			rc = builder_add_attribute(dst, PKCS11_CKA_CLASS,
+						   &class_hint,
+						   sizeof(class_hint));
 			if (rc)
 				return rc;
 		}
 	}
 
 	if (type_found != PKCS11_UNDEFINED_ID) {
-		rc = add_attribute(dst, PKCS11_CKA_KEY_TYPE,
-				   &type_found, sizeof(type_found));
+		rc = builder_add_attribute(dst, PKCS11_CKA_KEY_TYPE,
+					   &type_found, sizeof(type_found));
 		if (rc)
 			return rc;
 	} else {
 		if (type_hint != PKCS11_UNDEFINED_ID) {
-			rc = add_attribute(dst, PKCS11_CKA_KEY_TYPE,
-					   &type_hint, sizeof(type_hint));
+			rc = builder_add_attribute(dst, PKCS11_CKA_KEY_TYPE,
+						   &type_hint,
+						   sizeof(type_hint));
 			if (rc)
 				return rc;
 		}
@@ -164,8 +166,8 @@ err:
 	return rc;
 }
 
-static enum pkcs11_rc sanitize_boolprops(struct obj_attrs **dst, void *src,
-					 size_t src_size)
+static enum pkcs11_rc sanitize_boolprops(struct obj_attrs_builder *dst,
+					 void *src, size_t src_size)
 {
 	bitstr_t bit_decl(seen_attrs, PKCS11_BOOLPROPS_MAX_COUNT) = { 0 };
 	bitstr_t bit_decl(boolprops, PKCS11_BOOLPROPS_MAX_COUNT) = { 0 };
@@ -211,8 +213,9 @@ static enum pkcs11_rc sanitize_boolprops(struct obj_attrs **dst, void *src,
 		if (!bit_test(seen_attrs, idx)) {
 			uint8_t pkcs11_bool = value;
 
-			rc = add_attribute(dst, cli_ref.id, &pkcs11_bool,
-					   sizeof(pkcs11_bool));
+			rc = builder_add_attribute(dst, cli_ref.id,
+						   &pkcs11_bool,
+						   sizeof(pkcs11_bool));
 			if (rc)
 				return rc;
 		}
@@ -222,7 +225,7 @@ static enum pkcs11_rc sanitize_boolprops(struct obj_attrs **dst, void *src,
 	return PKCS11_CKR_OK;
 }
 
-static uint32_t sanitize_indirect_attr(struct obj_attrs **dst,
+static uint32_t sanitize_indirect_attr(struct obj_attrs_builder *dst,
 				       struct pkcs11_attribute_head *cli_ref,
 				       char *data)
 {
@@ -238,8 +241,8 @@ static uint32_t sanitize_indirect_attr(struct obj_attrs **dst,
 	if (rc)
 		goto out;
 
-	rc = add_attribute(dst, cli_ref->id, obj2,
-			   sizeof(*obj2) + obj2->attrs_size);
+	rc = builder_add_attribute(dst, cli_ref->id, obj2,
+				   sizeof(*obj2) + obj2->attrs_size);
 out:
 	TEE_Free(obj2);
 	return rc;
@@ -249,6 +252,7 @@ enum pkcs11_rc sanitize_client_object(struct obj_attrs **dst, void *src,
 				      size_t size, uint32_t class_hint,
 				      uint32_t type_hint)
 {
+	struct obj_attrs_builder builder = { };
 	struct pkcs11_attribute_head cli_ref = { };
 	struct pkcs11_object_head head = { };
 	enum pkcs11_rc rc = PKCS11_CKR_OK;
@@ -256,6 +260,8 @@ enum pkcs11_rc sanitize_client_object(struct obj_attrs **dst, void *src,
 	size_t sz_from_hdr = 0;
 	void *data = NULL;
 
+	*dst = NULL;
+
 	if (size < sizeof(head))
 		return PKCS11_CKR_ARGUMENTS_BAD;
 
@@ -265,23 +271,29 @@ enum pkcs11_rc sanitize_client_object(struct obj_attrs **dst, void *src,
 	    size < sz_from_hdr)
 		return PKCS11_CKR_ARGUMENTS_BAD;
 
-	rc = init_attributes_head(dst);
+	/*
+	 * Sanitized attributes are at most the client attributes plus the
+	 * class and type hints: allocate this once rather than reallocating
+	 * the serialized attributes for each added entry.
+	 */
+	rc = init_attributes_builder(&builder, sz_from_hdr +
+				     2 * (sizeof(cli_ref) + sizeof(uint32_t)));
 	if (rc)
 		return rc;
 
-	rc = sanitize_class_and_type(dst, src, sz_from_hdr, class_hint,
+	rc = sanitize_class_and_type(&builder, src, sz_from_hdr, class_hint,
 				     type_hint);
 	if (rc)
-		return rc;
+		goto err;
 
-	rc = sanitize_boolprops(dst, src, sz_from_hdr);
+	rc = sanitize_boolprops(&builder, src, sz_from_hdr);
 	if (rc)
-		return rc;
+		goto err;
 
 	while (pos != sz_from_hdr) {
 		rc = read_attr_advance(src, sz_from_hdr, &pos, &cli_ref, &data);
 		if (rc)
-			return rc;
+			goto err;
 
 		if (cli_ref.id == PKCS11_CKA_CLASS ||
 		    pkcs11_attr_is_type(cli_ref.id) ||
@@ -289,23 +301,32 @@ enum pkcs11_rc sanitize_client_object(struct obj_attrs **dst, void *src,
 			continue;
 
 		if (pkcs11_attr_has_indirect_attributes(cli_ref.id)) {
-			rc = sanitize_indirect_attr(dst, &cli_ref, data);
+			rc = sanitize_indirect_attr(&builder, &cli_ref, data);
 			if (rc)
-				return rc;
+				goto err;
 
 			continue;
 		}
 
 		if (!valid_pkcs11_attribute_id(cli_ref.id, cli_ref.size)) {
 			EMSG("Invalid attribute id %#"PRIx32, cli_ref.id);
-			return PKCS11_CKR_TEMPLATE_INCONSISTENT;
+			rc = PKCS11_CKR_TEMPLATE_INCONSISTENT;
+			goto err;
 		}
 
-		rc = add_attribute(dst, cli_ref.id, data, cli_ref.size);
+		rc = builder_add_attribute(&builder, cli_ref.id, data,
+					   cli_ref.size);
 		if (rc)
-			return rc;
+			goto err;
 	}
 
+	*dst = builder_get_attributes(&builder);
+
+	return PKCS11_CKR_OK;
+
+err:
+	release_attributes_builder(&builder);
+
 	return rc;
 }
 
@@ -103,6 +103,17 @@ enum pkcs11_rc serialargs_get_ptr(struct serialargs *args, void **out,
 	return PKCS11_CKR_OK;
 }
 
+enum pkcs11_rc serialargs_get_array(struct serialargs *args, void **out,
+				    size_t count, size_t item_size)
+{
+	size_t size = 0;
+
+	if (MUL_OVERFLOW(count, item_size, &size))
+		return PKCS11_CKR_ARGUMENTS_BAD;
+
+	return serialargs_get_ptr(args, out, size);
+}
+
 enum pkcs11_rc
 serialargs_alloc_get_one_attribute(struct serialargs *args,
 				   struct pkcs11_attribute_head **out)
@@ -67,6 +67,18 @@ static inline enum pkcs11_rc serialargs_get_u32(struct serialargs *args,
 enum pkcs11_rc serialargs_get_ptr(struct serialargs *args, void **out,
 				  size_t size);
 
+/*
+ * serialargs_get_array() - get a pointer to an array of items and advance
+ * @args:	serializing state
+ * @out:	Pointer to the first item retrieved in *@out
+ * @count:	Number of items in the array
+ * @item_size:	Byte size of an item
+ *
+ * Returns PKCS11_CKR_OK on success or PKCS11_CKR_ARGUMENTS_BAD on failure.
+ */
+enum pkcs11_rc serialargs_get_array(struct serialargs *args, void **out,
+				    size_t count, size_t item_size);
+
 /*
  * serialargs_alloc_get_one_attribute() - allocate and extract one attribute
  * @args:	serializing state